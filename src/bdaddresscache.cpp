@@ -0,0 +1,67 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "bdaddresscache.h"
+
+#include <string.h>
+
+BDAddressCache::BDAddressCache(Preferences *preferences, const char *key)
+    : preferences_(preferences), key_(key) {}
+
+/**
+ * @brief Read the address from the preferences
+ */
+void BDAddressCache::load() {
+  valid_ = preferences_->getBytes(key_, address_, sizeof(address_)) ==
+           BD_ADDRESS_SIZE;
+}
+
+/**
+ * @brief Returns the cached address
+ *
+ * @return string e.g. "00:07:80:12:34:56", empty if unknown
+ */
+string BDAddressCache::get() {
+  if (!valid_) {
+    return "";
+  }
+  return PeerList::unpackAddress(address_);
+}
+
+/**
+ * @brief Compare the cache with the address read from the module. The
+ * preferences are only written if the address changed, e.g. on first boot
+ *
+ * @param bd_address Address read from the module
+ * @return true if the cache was updated
+ */
+bool BDAddressCache::update(string bd_address) {
+  uint8_t address[BD_ADDRESS_SIZE];
+  if (PeerList::packAddress(bd_address, address) != kSuccess) {
+    return false;
+  }
+  if (valid_ && memcmp(address, address_, BD_ADDRESS_SIZE) == 0) {
+    return false;
+  }
+  memcpy(address_, address, BD_ADDRESS_SIZE);
+  valid_ = true;
+  preferences_->putBytes(key_, address_, sizeof(address_));
+  return true;
+}
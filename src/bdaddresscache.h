@@ -0,0 +1,50 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#include "peerlist.h"
+#include "resulttype.h"
+
+#include <stdint.h>
+#include <string>
+using namespace std;
+
+#define BD_ADDRESS_CACHE_KEY "bt_bdaddr"
+
+/**
+ * @brief BD address of the WT32i module, persisted as packed address in the
+ * preferences so it is known without asking the module. Also used for the
+ * last connected BLE button, stored under another key
+ */
+class BDAddressCache {
+public:
+  BDAddressCache(Preferences *, const char * = BD_ADDRESS_CACHE_KEY);
+
+  void load();
+  string get();
+  bool update(string);
+
+private:
+  Preferences *preferences_;
+  const char *key_;
+  uint8_t address_[BD_ADDRESS_SIZE] = {};
+  bool valid_ = false;
+};
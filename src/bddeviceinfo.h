@@ -23,7 +23,13 @@ Contact: bt-trx.com, mail@bt-trx.com
 #include <string>
 using namespace std;
 
+/**
+ * @brief State of an HFP-AG link to a remote device
+ */
+enum LinkState { kLinkUnused, kLinkConnected, kLinkCallRunning };
+
 typedef struct {
   string bd_address = "";
   string bd_friendly_name = "";
+  LinkState link_state = kLinkUnused;
 } BDDeviceInfo;
\ No newline at end of file
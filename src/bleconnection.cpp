@@ -0,0 +1,111 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "bleconnection.h"
+
+/**
+ * @brief Begin a connection attempt, called by the main loop before the
+ * connecting task gets triggered
+ *
+ * @param now Current time in ms
+ * @return false if a connection is already set up or established
+ */
+bool BLEConnection::start(ulong now) {
+  if (state_ != kBLEIdle) {
+    return false;
+  }
+  // Events of an earlier attempt are stale
+  BLEEvent event;
+  while (events_.pop(&event)) {
+  }
+  disconnected_ = false;
+  start_time_ = now;
+  state_ = kBLEConnecting;
+  return true;
+}
+
+/**
+ * @brief Report a step of the connection setup, called by the connecting
+ * task only
+ *
+ * @param type
+ * @param time Time of the step in ms
+ */
+void BLEConnection::post(BLEEventType type, ulong time) {
+  events_.push({type, time});
+}
+
+/**
+ * @brief Report the loss of the connection, may be called from any task
+ */
+void BLEConnection::postDisconnect() { disconnected_ = true; }
+
+/**
+ * @brief Apply the reported steps, called by the main loop
+ *
+ * @return true if the state changed
+ */
+bool BLEConnection::update() {
+  BLEConnectionState previous = state_;
+  BLEEvent event;
+  while (events_.pop(&event)) {
+    switch (event.type) {
+    case kBLELinkUp:
+      if (state_ == kBLEConnecting) {
+        link_up_time_ = event.time;
+        connect_time_ = event.time - start_time_;
+        state_ = kBLEDiscovering;
+      }
+      break;
+    case kBLESubscribed:
+      if (state_ == kBLEDiscovering) {
+        discovery_time_ = event.time - link_up_time_;
+        connects_++;
+        state_ = kBLEConnected;
+      }
+      break;
+    case kBLEFailed:
+      if (state_ == kBLEConnecting || state_ == kBLEDiscovering) {
+        failures_++;
+        state_ = kBLEIdle;
+      }
+      break;
+    }
+  }
+  if (disconnected_.exchange(false) && state_ == kBLEConnected) {
+    state_ = kBLEIdle;
+  }
+  return state_ != previous;
+}
+
+/**
+ * @brief Summary for the web interface
+ *
+ * @return string e.g. "2 connects, 1 failed, connect 420 ms, discovery 180 ms"
+ */
+string BLEConnection::getStats() {
+  string stats = to_string(connects_) + " connects, " + to_string(failures_) +
+                 " failed";
+  if (connects_ > 0) {
+    stats += ", connect " + to_string(connect_time_) + " ms, discovery " +
+             to_string(discovery_time_) + " ms";
+  }
+  return stats;
+}
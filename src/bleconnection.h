@@ -0,0 +1,84 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+#include "arduino-mock/Arduino.h"
+#endif
+
+#include "settings.h"
+#include "spscqueue.h"
+
+#include <atomic>
+#include <string>
+using namespace std;
+
+enum BLEConnectionState {
+  kBLEIdle,
+  kBLEConnecting,  // Link layer connection being set up
+  kBLEDiscovering, // Service and characteristic lookup, subscription
+  kBLEConnected
+};
+
+enum BLEEventType { kBLELinkUp, kBLESubscribed, kBLEFailed };
+
+typedef struct {
+  BLEEventType type;
+  ulong time;
+} BLEEvent;
+
+/**
+ * @brief Progress of the connection to a BLE PTT button. The blocking calls
+ * of the BLE stack run in their own task, which reports each step through a
+ * lock-free queue. The main loop only polls update(), it never waits.
+ */
+class BLEConnection {
+public:
+  BLEConnection() {}
+
+  bool start(ulong);
+  void post(BLEEventType, ulong);
+  void postDisconnect();
+  bool update();
+
+  BLEConnectionState getState() { return state_; };
+  bool isConnected() { return state_ == kBLEConnected; };
+  bool isIdle() { return state_ == kBLEIdle; };
+  ulong getConnectTime() { return connect_time_; };
+  ulong getDiscoveryTime() { return discovery_time_; };
+  uint32_t getConnects() { return connects_; };
+  uint32_t getFailures() { return failures_; };
+  string getStats();
+
+private:
+  BLEConnectionState state_ = kBLEIdle;
+  SPSCQueue<BLEEvent, BLE_EVENT_QUEUE_SIZE + 1> events_;
+  std::atomic<bool> disconnected_{false}; // Set by the BLE stack
+
+  ulong start_time_ = 0;
+  ulong link_up_time_ = 0;
+  ulong connect_time_ = 0;   // ms, start to link layer connection
+  ulong discovery_time_ = 0; // ms, link layer connection to subscription
+  uint32_t connects_ = 0;
+  uint32_t failures_ = 0;
+};
@@ -0,0 +1,126 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "blereconnectpolicy.h"
+
+/**
+ * @brief Set whether the address of a button without connection is known
+ *
+ * @param known
+ */
+void BLEReconnectPolicy::setKnownDevice(bool known) { known_device_ = known; }
+
+/**
+ * @brief Set whether a slot has no button yet, i.e. new buttons are searched
+ *
+ * @param free
+ */
+void BLEReconnectPolicy::setFreeSlot(bool free) { free_slot_ = free; }
+
+/**
+ * @brief Set whether a button is connected in another slot
+ *
+ * @param connected
+ */
+void BLEReconnectPolicy::setButtonConnected(bool connected) {
+  button_connected_ = connected;
+}
+
+/**
+ * @brief Set whether the radio is busy with HFP
+ *
+ * @param busy
+ */
+void BLEReconnectPolicy::setBusy(bool busy) { busy_ = busy; }
+
+/**
+ * @brief Set whether the web interface is serving requests, WiFi and BLE
+ * share the antenna
+ *
+ * @param busy
+ */
+void BLEReconnectPolicy::setWebBusy(bool busy) { web_busy_ = busy; }
+
+/**
+ * @brief Time the controller listens per scan cycle
+ *
+ * @return uint16_t ms
+ */
+uint16_t BLEReconnectPolicy::getScanWindow() {
+  return isBusy() ? BLE_SCAN_WINDOW_BUSY : BLE_SCAN_WINDOW_IDLE;
+}
+
+/**
+ * @brief Scan cycle (scan interval of the controller)
+ *
+ * @return uint16_t ms
+ */
+uint16_t BLEReconnectPolicy::getScanCycle() {
+  return isBusy() ? BLE_SCAN_CYCLE_BUSY : BLE_SCAN_CYCLE_IDLE;
+}
+
+/**
+ * @brief Called periodically while a slot is idle and no button is
+ * connecting
+ *
+ * @param now Current time since boot in ms
+ * @return BLEAction to take now
+ */
+BLEAction BLEReconnectPolicy::next(ulong now) {
+  if (now < next_action_) {
+    return kBLEWait;
+  }
+  // Next to a connected button, new ones are only searched after boot
+  bool search = free_slot_ && (!button_connected_ ||
+                               now < BLE_NEW_BUTTON_WINDOW * 1000UL);
+  if (!known_device_ && !search) {
+    return kBLEWait;
+  }
+  if (!known_device_ || failures_ >= BLE_RECONNECT_SCAN_AFTER ||
+      (search && now >= next_scan_)) {
+    failures_ = 0;
+    scans_++;
+    scan_time_ += BLE_SCAN_DURATION * 1000;
+    next_scan_ = now + BLE_SCAN_INTERVAL * 1000 *
+                           (isBusy() ? BLE_SCAN_BUSY_BACKOFF : 1);
+    if (known_device_) {
+      next_action_ = now + BLE_SCAN_DURATION * 1000;
+    } else {
+      next_action_ = next_scan_;
+    }
+    return kBLEScan;
+  }
+  direct_attempts_++;
+  next_action_ = now + BLE_RECONNECT_INTERVAL;
+  return kBLEConnectDirect;
+}
+
+/**
+ * @brief The button got connected, reconnect right away once it is lost
+ */
+void BLEReconnectPolicy::connected() {
+  failures_ = 0;
+  next_action_ = 0;
+}
+
+/**
+ * @brief A direct connection try failed
+ */
+void BLEReconnectPolicy::failed() { failures_++; }
@@ -0,0 +1,79 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+#include "arduino-mock/Arduino.h"
+#endif
+
+#include "settings.h"
+
+#include <stdint.h>
+
+enum BLEAction { kBLEWait, kBLEScan, kBLEConnectDirect };
+
+/**
+ * @brief Decides how to find the BLE PTT button while it is not connected.
+ * Without a known button, the radio scans every BLE_SCAN_INTERVAL. A known
+ * button is connected directly by its address, a scan is only done now and
+ * then to find a replacement button. While a slot has no button yet and no
+ * button is connected, the scans every BLE_SCAN_INTERVAL continue in between.
+ * Next to a connected button, new ones are only searched during
+ * BLE_NEW_BUTTON_WINDOW after boot. While an HFP link or the web interface is
+ * busy, scans are rarer and listen for a smaller part of the time
+ */
+class BLEReconnectPolicy {
+public:
+  BLEReconnectPolicy() {}
+
+  void setKnownDevice(bool);
+  void setFreeSlot(bool);
+  void setButtonConnected(bool);
+  void setBusy(bool);
+  void setWebBusy(bool);
+  BLEAction next(ulong);
+  void connected();
+  void failed();
+
+  uint16_t getScanWindow();
+  uint16_t getScanCycle();
+
+  uint32_t getScans() { return scans_; };
+  uint32_t getDirectAttempts() { return direct_attempts_; };
+  ulong getScanTime() { return scan_time_; };
+
+private:
+  bool known_device_ = false;
+  bool free_slot_ = true;
+  bool button_connected_ = false;
+  bool busy_ = false;
+  bool web_busy_ = false;
+  bool isBusy() { return busy_ || web_busy_; };
+  ulong next_action_ = 0;
+  ulong next_scan_ = 0; // For a free slot next to a known button
+  uint16_t failures_ = 0; // Direct tries failed in a row
+
+  uint32_t scans_ = 0;
+  uint32_t direct_attempts_ = 0;
+  ulong scan_time_ = 0; // ms, sum of all scan durations
+};
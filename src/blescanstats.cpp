@@ -0,0 +1,63 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "blescanstats.h"
+
+/**
+ * @brief Count an advertisement, called by the task of the BLE stack only
+ *
+ * @param matched The advertiser is a PTT button
+ * @param cpu_time Time spent in the callback in us
+ */
+void BLEScanStats::countResult(bool matched, uint32_t cpu_time) {
+  results_++;
+  if (matched) {
+    matches_++;
+  }
+  cpu_time_ += cpu_time;
+}
+
+/**
+ * @brief Sum up the advertisements since the previous scan, called by the
+ * main loop once a scan ended
+ */
+void BLEScanStats::finishScan() {
+  uint32_t results = results_;
+  uint32_t matches = matches_;
+  uint32_t cpu_time = cpu_time_;
+  last_results_ = results - results_seen_;
+  last_matches_ = matches - matches_seen_;
+  last_cpu_time_ = cpu_time - cpu_time_seen_;
+  results_seen_ = results;
+  matches_seen_ = matches;
+  cpu_time_seen_ = cpu_time;
+  scans_++;
+}
+
+/**
+ * @brief Summary of the last scan
+ *
+ * @return string e.g. "last scan: 12 results, 1 matched, 840 us"
+ */
+string BLEScanStats::getStats() {
+  return "last scan: " + to_string(last_results_) + " results, " +
+         to_string(last_matches_) + " matched, " + to_string(last_cpu_time_) +
+         " us";
+}
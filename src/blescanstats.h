@@ -0,0 +1,62 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+#include "arduino-mock/Arduino.h"
+#endif
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+using namespace std;
+
+/**
+ * @brief Counts the advertisements reported by BLE scans and the CPU time
+ * spent on them. Results are counted on the task of the BLE stack, each scan
+ * is summed up by the main loop
+ */
+class BLEScanStats {
+public:
+  void countResult(bool, uint32_t);
+  void finishScan();
+
+  uint32_t getScans() { return scans_; };
+  uint32_t getLastResults() { return last_results_; };
+  uint32_t getLastMatches() { return last_matches_; };
+  uint32_t getLastCPUTime() { return last_cpu_time_; };
+  string getStats();
+
+private:
+  std::atomic<uint32_t> results_{0};
+  std::atomic<uint32_t> matches_{0};
+  std::atomic<uint32_t> cpu_time_{0}; // us
+
+  uint32_t scans_ = 0;
+  uint32_t results_seen_ = 0;
+  uint32_t matches_seen_ = 0;
+  uint32_t cpu_time_seen_ = 0;
+  uint32_t last_results_ = 0;
+  uint32_t last_matches_ = 0;
+  uint32_t last_cpu_time_ = 0; // us
+};
@@ -23,9 +23,23 @@ Contact: bt-trx.com, mail@bt-trx.com
 #include "bttrx_ble.h"
 
 #include "Arduino.h"
+#include "esp_bt.h"
+#include "esp_coexist.h"
+#include "logger.h"
 #include "settings.h"
 
+#include <string.h>
+
 extern BTTRX_BLE bttrx_ble;
+extern Preferences preferences;
+
+// Preferences keys of the button slots, the first one is kept from the
+// single button version
+static const char *kButtonAddressKeys[] = {BLE_BUTTON_ADDRESS_KEY,
+                                           BLE_BUTTON_ADDRESS_KEY "1",
+                                           BLE_BUTTON_ADDRESS_KEY "2",
+                                           BLE_BUTTON_ADDRESS_KEY "3"};
+static_assert(BLE_MAX_BUTTONS <= 4, "Add preferences keys for more buttons");
 
 /**
  * Scan for BLE servers and find the first one that advertises the service we
@@ -33,12 +47,18 @@ extern BTTRX_BLE bttrx_ble;
  */
 class MyAdvertisedDeviceCallbacks : public BLEAdvertisedDeviceCallbacks {
   /**
-   * Called for each advertising BLE server.
+   * Called for each advertising BLE server. Runs on the BLE stack task, kept
+   * short: the OUI is compared on the raw address
    */
   void onResult(BLEAdvertisedDevice advertisedDevice) {
-    if (!advertisedDevice.getAddress().toString().compare(
-            0, 8, BD_ADDR_OUI_ANYTONE)) {
+    ulong start = micros();
+    BLEAddress address = advertisedDevice.getAddress();
+    bool matched = bttrx_ble.isButtonAddress(address);
+    bttrx_ble.getScanStats()->countResult(matched, micros() - start);
+    if (matched) {
+      // stop() doesn't call scanComplete(), finish the scan here
       BLEDevice::getScan()->stop();
+      bttrx_ble.markScanDone();
       bttrx_ble.doConnect(&advertisedDevice);
     }
   }
@@ -47,112 +67,373 @@ class MyAdvertisedDeviceCallbacks : public BLEAdvertisedDeviceCallbacks {
 class MyClientCallback : public BLEClientCallbacks {
   void onConnect(BLEClient *pclient) {}
 
-  void onDisconnect(BLEClient *pclient) {
-    bttrx_ble.setConnectionState(false);
-    SERIAL_DBG.println("BLE disconnect");
-  }
+  void onDisconnect(BLEClient *pclient) { bttrx_ble.postDisconnect(pclient); }
 };
 
 void BTTRX_BLE::notifyCallback(
     BLERemoteCharacteristic *pBLERemoteCharacteristic, uint8_t *pData,
     size_t length, bool isNotify) {
-  // SERIAL_DBG.print("BLE data: ");
-  // SERIAL_DBG.println((char *)pData);
-
-  ButtonBLE *button = bttrx_ble.getButton();
-  if (button == nullptr) {
+  ButtonBLEGroup *buttons = bttrx_ble.getButtons();
+  if (buttons == nullptr) {
+    return;
+  }
+  int slot = bttrx_ble.findSlot(
+      pBLERemoteCharacteristic->getRemoteService()->getClient());
+  if (slot < 0) {
     return;
   }
-  String data = (char *)pData;
-  if (data.compareTo("ELET1") == 0) {
-    button->setPressed();
-  } else if (data.compareTo("ELET2") == 0) {
-    button->setReleased();
+  // Runs on the task of the BLE stack: no logging, no allocations
+  buttons->getButton(slot)->handleNotification(pData, length, millis());
+}
+
+BTTRX_BLE::BTTRX_BLE() : is_started(false) {}
+
+/**
+ * @brief Find the slot a client belongs to, may be called from any task
+ *
+ * @return int -1 if unknown
+ */
+int BTTRX_BLE::findSlot(BLEClient *client) {
+  for (int i = 0; i < BLE_MAX_BUTTONS; i++) {
+    if (slots_[i].client == client) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief Called by the BLE stack task if a button got disconnected
+ */
+void BTTRX_BLE::postDisconnect(BLEClient *client) {
+  int slot = findSlot(client);
+  if (slot >= 0) {
+    slots_[slot].connection.postDisconnect();
   }
-  // "BATTx" message not handled
 }
 
-BTTRX_BLE::BTTRX_BLE()
-    : is_started(false), do_scan(true), do_connect(false), is_connected(false) {
+/**
+ * @brief Check the OUI of an advertiser without building strings
+ */
+bool BTTRX_BLE::isButtonAddress(BLEAddress &address) {
+  return memcmp(*address.getNative(), button_oui_, sizeof(button_oui_)) == 0;
+}
+
+/**
+ * @brief Called by the BLE stack task once a scan ended
+ */
+void BTTRX_BLE::scanComplete(BLEScanResults results) {
+  bttrx_ble.markScanDone();
 }
 
-void BTTRX_BLE::setupBLE(ButtonBLE *ptr) {
+/**
+ * @brief Connect to a button found by the scan, called by the BLE stack task
+ */
+void BTTRX_BLE::doConnect(BLEAdvertisedDevice *device) {
+  if (do_connect) {
+    return; // The main loop has not taken the previous one yet
+  }
+  strncpy(found_address_, device->getAddress().toString().c_str(),
+          sizeof(found_address_) - 1);
+  do_connect = true;
+}
+
+void BTTRX_BLE::setupBLE(ButtonBLEGroup *buttons,
+                         BTTRX_CONTROL *bttrx_control) {
+  // Classic Bluetooth is done by the WT32i, leave its controller memory to
+  // WiFi. Only possible before the controller is started
+  esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT);
   BLEDevice::init("");
+  // Share the antenna evenly, neither web pages nor button notifications
+  // must starve
+  esp_coex_preference_set(ESP_COEX_PREFER_BALANCE);
+  sscanf(BD_ADDR_OUI_ANYTONE, "%hhx:%hhx:%hhx", &button_oui_[0],
+         &button_oui_[1], &button_oui_[2]);
   // Retrieve a Scanner and set the callback we want to use to be informed when
   // we have detected a new device.
   BLEScan *pBLEScan = BLEDevice::getScan();
-  pBLEScan->setAdvertisedDeviceCallbacks(new MyAdvertisedDeviceCallbacks());
+  // No duplicates: the library reports each advertiser once per scan, the
+  // controller still passes every advertisement to the host.
+  // Passive: no scan requests, no scan responses to process
+  pBLEScan->setAdvertisedDeviceCallbacks(new MyAdvertisedDeviceCallbacks(),
+                                         false);
+  pBLEScan->setActiveScan(false);
+
+  MyClientCallback *client_callback = new MyClientCallback();
+  for (int i = 0; i < BLE_MAX_BUTTONS; i++) {
+    BLEButtonSlot &slot = slots_[i];
+    // Known buttons are connected directly, without a scan
+    slot.address = new BDAddressCache(&preferences, kButtonAddressKeys[i]);
+    slot.address->load();
+    slot.client = BLEDevice::createClient();
+    slot.client->setClientCallbacks(client_callback);
+  }
+  xTaskCreate(connectTask, "ble_connect", BLE_TASK_STACK_SIZE, this,
+              BLE_TASK_PRIORITY, &connect_task_);
 
-  ble_button_ = ptr;
-  SERIAL_DBG.println("BLE: setup done");
+  ble_buttons_ = buttons;
+  bttrx_control_ = bttrx_control;
+  LOG_INFO("BLE: setup done");
   is_started = true;
 }
 
+/**
+ * @brief Has to be called in the main loop. Never waits for the BLE stack:
+ * connections are set up by connectTask(), scans run in the background
+ */
 void BTTRX_BLE::run() {
   if (!is_started) {
     return;
   }
 
+  for (int i = 0; i < BLE_MAX_BUTTONS; i++) {
+    BLEConnectionState previous_state = slots_[i].connection.getState();
+    if (slots_[i].connection.update()) {
+      handleConnectionChange(i, previous_state);
+    }
+  }
+
+  if (scan_done_.exchange(false)) {
+    scan_stats_.finishScan();
+    BLEDevice::getScan()->clearResults();
+    LOG_DEBUG("BLE: %s", scan_stats_.getStats().c_str());
+    updateStats();
+  }
+
   if (do_connect) {
-    if (connectToDevice()) {
-      SERIAL_DBG.println("BLE: Connected to device!");
-    } else {
-      SERIAL_DBG.println("BLE: Connection failed");
+    string address = found_address_;
+    int slot = selectSlot(address);
+    if (slot >= 0 && !isConnecting()) {
+      startConnection(slot, address);
     }
     do_connect = false;
-  } else if (!is_connected && do_scan) {
-    // No connection, scan for BLE devices
-    static ulong lastscan = 0;
-    if (lastscan + (BLE_SCAN_INTERVAL * 1000) < millis()) {
-      // start(duration, is_continue) is blocking,
-      // start(duration, callback, is_continue) is non-blocking!
-      BLEDevice::getScan()->start(BLE_SCAN_DURATION, nullptr, false);
-      lastscan = millis();
+  } else if (!isConnecting()) {
+    // Anything to do if at least one slot is free. Idle slots with a button
+    // are connected directly, slots without one are filled by scans
+    int idle_slots = 0;
+    bool known_device = false;
+    bool free_slot = false;
+    bool button_connected = false;
+    for (int i = 0; i < BLE_MAX_BUTTONS; i++) {
+      if (!slots_[i].connection.isIdle()) {
+        button_connected |= slots_[i].connection.isConnected();
+        continue;
+      }
+      idle_slots++;
+      if (slots_[i].address->get().empty()) {
+        free_slot = true;
+      } else {
+        known_device = true;
+      }
+    }
+    if (idle_slots > 0) {
+      reconnect_policy_.setKnownDevice(known_device);
+      reconnect_policy_.setFreeSlot(free_slot);
+      reconnect_policy_.setButtonConnected(button_connected);
+      switch (reconnect_policy_.next(millis())) {
+      case kBLEScan:
+        startScan();
+        break;
+      case kBLEConnectDirect:
+        // Known buttons take turns
+        for (int i = 0; i < BLE_MAX_BUTTONS; i++) {
+          int slot = (next_direct_slot_ + i) % BLE_MAX_BUTTONS;
+          if (slots_[slot].connection.isIdle() &&
+              !slots_[slot].address->get().empty()) {
+            startConnection(slot, slots_[slot].address->get());
+            next_direct_slot_ = (slot + 1) % BLE_MAX_BUTTONS;
+            break;
+          }
+        }
+        break;
+      default:
+        break;
+      }
+    }
+  }
+
+  if (ble_buttons_ == nullptr) {
+    return;
+  }
+  for (int i = 0; i < BLE_MAX_BUTTONS; i++) {
+    ble_buttons_->getButton(i)->setConnected(
+        slots_[i].connection.isConnected());
+  }
+  if (bttrx_control_ != nullptr &&
+      ble_buttons_->getRevision() != buttons_revision_) {
+    buttons_revision_ = ble_buttons_->getRevision();
+    bttrx_control_->storeSetting(kBLEButtons, ble_buttons_->getStats());
+  }
+}
+
+/**
+ * @brief Log a step of a button connection and update the reconnection
+ * policy
+ *
+ * @param index Slot of the button
+ * @param previous_state State before the change
+ */
+void BTTRX_BLE::handleConnectionChange(int index,
+                                       BLEConnectionState previous_state) {
+  BLEButtonSlot &slot = slots_[index];
+  switch (slot.connection.getState()) {
+  case kBLEDiscovering:
+    LOG_INFO("BLE %d: link up after %lu ms", index + 1,
+             slot.connection.getConnectTime());
+    break;
+  case kBLEConnected:
+    LOG_INFO("BLE %d: Connected to device, discovery %lu ms", index + 1,
+             slot.connection.getDiscoveryTime());
+    reconnect_policy_.connected();
+    if (slot.address->update(slot.target_address)) {
+      // Reconnected directly from now on
+      LOG_INFO("BLE %d: button %s stored", index + 1,
+               slot.target_address.c_str());
+    }
+    break;
+  default:
+    if (previous_state == kBLEConnected) {
+      LOG_INFO("BLE %d: disconnected", index + 1);
+    } else {
+      LOG_INFO("BLE %d: Connection failed", index + 1);
+      reconnect_policy_.failed();
+    }
+    break;
+  }
+  updateStats();
+}
+
+/**
+ * @brief Check if the connecting task is busy
+ */
+bool BTTRX_BLE::isConnecting() {
+  for (int i = 0; i < BLE_MAX_BUTTONS; i++) {
+    BLEConnectionState state = slots_[i].connection.getState();
+    if (state == kBLEConnecting || state == kBLEDiscovering) {
+      return true;
     }
   }
+  return false;
+}
+
+/**
+ * @brief Choose the slot for a button found by a scan. A known button gets
+ * its own slot, a new one a slot without a button, or replaces a lost one
+ *
+ * @param address e.g. "00:1b:10:aa:bb:cc"
+ * @return int -1 if there is no free slot
+ */
+int BTTRX_BLE::selectSlot(string address) {
+  for (int i = 0; i < BLE_MAX_BUTTONS; i++) {
+    if (slots_[i].address->get() == address) {
+      return slots_[i].connection.isIdle() ? i : -1;
+    }
+  }
+  for (int i = 0; i < BLE_MAX_BUTTONS; i++) {
+    if (slots_[i].connection.isIdle() && slots_[i].address->get().empty()) {
+      return i;
+    }
+  }
+  for (int i = 0; i < BLE_MAX_BUTTONS; i++) {
+    if (slots_[i].connection.isIdle()) {
+      return i;
+    }
+  }
+  return -1;
+}
 
-  ButtonBLE *button = bttrx_ble.getButton();
-  if (button == nullptr) {
+/**
+ * @brief Start a scan in the background with the window of the current
+ * radio load
+ */
+void BTTRX_BLE::startScan() {
+  BLEScan *scan = BLEDevice::getScan();
+  scan->setInterval(reconnect_policy_.getScanCycle());
+  scan->setWindow(reconnect_policy_.getScanWindow());
+  // start(duration, is_continue) is blocking,
+  // start(duration, callback, is_continue) is non-blocking!
+  scan->start(BLE_SCAN_DURATION, scanComplete, false);
+}
+
+/**
+ * @brief Let the connecting task connect to a button
+ *
+ * @param index Slot of the button
+ * @param address e.g. "00:1b:10:aa:bb:cc"
+ */
+void BTTRX_BLE::startConnection(int index, string address) {
+  if (!slots_[index].connection.start(millis())) {
     return;
   }
-  button->setConnected(is_connected);
+  LOG_INFO("BLE %d: Connecting to %s", index + 1, address.c_str());
+  slots_[index].target_address = address;
+  connecting_slot_ = index;
+  xTaskNotifyGive(connect_task_);
 }
 
-bool BTTRX_BLE::connectToDevice() {
-  SERIAL_DBG.print("BLE: Connecting to ");
-  SERIAL_DBG.println(ble_device->getAddress().toString().c_str());
+void BTTRX_BLE::updateStats() {
+  if (bttrx_control_ == nullptr) {
+    return;
+  }
+  string stats;
+  for (int i = 0; i < BLE_MAX_BUTTONS; i++) {
+    stats += to_string(i + 1) + ": " + slots_[i].connection.getStats() + "; ";
+  }
+  stats += to_string(reconnect_policy_.getScans()) + " scans (" +
+           to_string(reconnect_policy_.getScanTime()) + " ms), " +
+           scan_stats_.getStats();
+  bttrx_control_->storeSetting(kBLEStats, stats);
+}
 
-  BLEClient *pClient = BLEDevice::createClient();
-  pClient->setClientCallbacks(new MyClientCallback());
-  pClient->connect(ble_device);
+/**
+ * @brief Task running the blocking connection setup whenever run() asks for
+ * it. The results are posted to the connection of the slot
+ */
+void BTTRX_BLE::connectTask(void *parameter) {
+  BTTRX_BLE *self = static_cast<BTTRX_BLE *>(parameter);
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    int slot = self->connecting_slot_;
+    if (slot >= 0) {
+      self->connectToDevice(&self->slots_[slot]);
+    }
+  }
+}
+
+/**
+ * @brief Connect, look up the button characteristic and subscribe to it.
+ * Each step is reported to the connection of the slot
+ */
+void BTTRX_BLE::connectToDevice(BLEButtonSlot *slot) {
+  BLEClient *client = slot->client;
+  if (!client->connect(BLEAddress(slot->target_address))) {
+    slot->connection.post(kBLEFailed, millis());
+    return;
+  }
+  slot->connection.post(kBLELinkUp, millis());
 
   // Obtain a reference to the service we are after in the remote BLE server.
-  BLERemoteService *pRemoteService = pClient->getService(serviceUUID);
+  BLERemoteService *pRemoteService = client->getService(serviceUUID);
   if (pRemoteService == nullptr) {
-    SERIAL_DBG.print("BLE: Failed to find our service UUID");
-    pClient->disconnect();
-    return false;
+    client->disconnect();
+    slot->connection.post(kBLEFailed, millis());
+    return;
   }
 
   // Obtain a reference to the characteristic in the service of the remote BLE
   // server.
   BLERemoteCharacteristic *pRemoteCharacteristic =
       pRemoteService->getCharacteristic(charUUID);
-  if (pRemoteCharacteristic == nullptr) {
-    SERIAL_DBG.print("BLE: Failed to find our characteristic UUID");
-    pClient->disconnect();
-    return false;
+  if (pRemoteCharacteristic == nullptr ||
+      !pRemoteCharacteristic->canNotify()) {
+    client->disconnect();
+    slot->connection.post(kBLEFailed, millis());
+    return;
   }
 
   // Subscribe to the notifications for this characteristic
-  if (!pRemoteCharacteristic->canNotify()) {
-    SERIAL_DBG.print("BLE: Cant register notifications");
-    return false;
-  }
-
   pRemoteCharacteristic->registerForNotify(notifyCallback);
-  is_connected = true;
-  return true;
+  slot->connection.post(kBLESubscribed, millis());
 }
 
 #endif // ARDUINO
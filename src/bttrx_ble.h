@@ -23,7 +23,15 @@ Contact: bt-trx.com, mail@bt-trx.com
 #ifdef ARDUINO
 
 #include "BLEDevice.h"
-#include "button_ble.h"
+#include "Preferences.h"
+#include "bdaddresscache.h"
+#include "bleconnection.h"
+#include "blereconnectpolicy.h"
+#include "blescanstats.h"
+#include "bttrx_control.h"
+#include "button_ble_group.h"
+
+#include <atomic>
 
 #if !defined(CONFIG_BT_ENABLED) || !defined(CONFIG_BLUEDROID_ENABLED)
 #error Bluetooth is not enabled! Please run `make menuconfig` to and enable it
@@ -34,31 +42,61 @@ static BLEUUID serviceUUID("ff01"); // Button
 // The characteristic of the remote service we are interested in.
 static BLEUUID charUUID("ff02");
 
+/**
+ * @brief Connection to one BLE PTT button
+ */
+typedef struct {
+  BLEClient *client;
+  BLEConnection connection;
+  BDAddressCache *address; // Last button connected in this slot
+  string target_address;   // Button the connecting task connects to
+} BLEButtonSlot;
+
 class BTTRX_BLE {
 public:
   BTTRX_BLE();
-  void setupBLE(ButtonBLE *);
-  ButtonBLE *getButton() { return ble_button_; };
+  void setupBLE(ButtonBLEGroup *, BTTRX_CONTROL *);
+  ButtonBLEGroup *getButtons() { return ble_buttons_; };
   void run();
-  void doConnect(BLEAdvertisedDevice *device) {
-    ble_device = new BLEAdvertisedDevice(*device);
-    do_connect = true;
-  }
-  void setConnectionState(bool state) { is_connected = state; }
-  bool getConnectionState() { return is_connected; }
+  void doConnect(BLEAdvertisedDevice *);
+  void setHFPBusy(bool busy) { reconnect_policy_.setBusy(busy); }
+  void setWebBusy(bool busy) { reconnect_policy_.setWebBusy(busy); }
+  bool isButtonAddress(BLEAddress &);
+  BLEScanStats *getScanStats() { return &scan_stats_; }
+  int findSlot(BLEClient *);
 
   static void notifyCallback(BLERemoteCharacteristic *, uint8_t *, size_t,
                              bool);
+  static void scanComplete(BLEScanResults);
+  void markScanDone() { scan_done_ = true; }
+  void postDisconnect(BLEClient *);
 
 private:
-  BLEAdvertisedDevice *ble_device;
-  ButtonBLE *ble_button_ = nullptr;
+  ButtonBLEGroup *ble_buttons_ = nullptr;
+  BTTRX_CONTROL *bttrx_control_ = nullptr;
+  BLEButtonSlot slots_[BLE_MAX_BUTTONS];
+  BLEReconnectPolicy reconnect_policy_;
+  BLEScanStats scan_stats_;
+  uint8_t button_oui_[3] = {};
+  std::atomic<bool> scan_done_{false};
+  void startScan();
+  TaskHandle_t connect_task_ = NULL;
   bool is_started;
-  bool do_scan;
-  bool do_connect;
-  bool is_connected;
+  int next_direct_slot_ = 0;
+  uint32_t buttons_revision_ = 0;
+
+  // Button found by the scan, written by the BLE stack task
+  char found_address_[18] = "";
+  std::atomic<bool> do_connect{false};
 
-  bool connectToDevice();
+  std::atomic<int> connecting_slot_{-1}; // Slot of the connecting task
+  bool isConnecting();
+  int selectSlot(string);
+  void handleConnectionChange(int, BLEConnectionState);
+  void startConnection(int, string);
+  void updateStats();
+  void connectToDevice(BLEButtonSlot *);
+  static void connectTask(void *);
 };
 
-#endif // ARDUINO
\ No newline at end of file
+#endif // ARDUINO
@@ -19,6 +19,8 @@ Contact: bt-trx.com, mail@bt-trx.com
 */
 
 #include "bttrx_control.h"
+#include "logger.h"
+#include "tonedetector.h"
 
 extern Preferences preferences;
 
@@ -60,10 +62,31 @@ ResultType BTTRX_CONTROL::set(string name, string value) {
   case kPTTHangTime:
     result = handleSetPTTHangTime(value);
     break;
+  case kVoxThreshold:
+    result = handleSetVoxThreshold(value);
+    break;
+  case kVoxHangTime:
+    result = handleSetVoxHangTime(value);
+    break;
+  case kCTCSSTone:
+    result = handleSetCTCSSTone(value);
+    break;
+  case kInquiryDutyCycle:
+    result = handleSetInquiryDutyCycle(value);
+    break;
+  case kInquiryMaxInterval:
+    result = handleSetInquiryMaxInterval(value);
+    break;
+  case kRecoveryWindow:
+    result = handleSetRecoveryWindow(value);
+    break;
   default:
     return kError;
     break;
   }
+  if (result == kSuccess) {
+    settings_revision_++;
+  }
   return result;
 }
 
@@ -82,13 +105,15 @@ ResultType BTTRX_CONTROL::get(string name, string *value) {
 
 /**
  * @brief Evalute GET command (e.g. from Webserver)
- * Parameters may be stored as "Parameter" in Flash or read from WT32i
+ * Parameters may be stored as "Parameter" in Flash or read from WT32i.
+ * Safe to call from another task than storeSetting()
  *
  * @param name Parameter name as ParameterType
  * @param value output: Parameter value as string
  * @return ResultType
  */
 ResultType BTTRX_CONTROL::get(ParameterType parameter, string *value) {
+  std::lock_guard<std::mutex> lock(values_mutex_);
   // Reply with value / call handler method
   switch (parameter) {
   case kStatusmessage:
@@ -119,6 +144,62 @@ ResultType BTTRX_CONTROL::get(ParameterType parameter, string *value) {
     *value = to_string(
         preferences.getUShort(ParameterTypeToString(kPTTHangTime).c_str(), 0));
     break;
+  case kVoxThreshold:
+    *value = to_string(
+        preferences.getUShort(ParameterTypeToString(kVoxThreshold).c_str(),
+                              VOX_DEFAULT_THRESHOLD));
+    break;
+  case kVoxHangTime:
+    *value = to_string(
+        preferences.getUShort(ParameterTypeToString(kVoxHangTime).c_str(),
+                              VOX_DEFAULT_HANG_TIME));
+    break;
+  case kCTCSSTone:
+    *value = to_string(
+        preferences.getUShort(ParameterTypeToString(kCTCSSTone).c_str(), 0));
+    break;
+  case kInquiryDutyCycle:
+    *value = to_string(
+        preferences.getUShort(ParameterTypeToString(kInquiryDutyCycle).c_str(),
+                              INQUIRY_DEFAULT_DUTY_CYCLE));
+    break;
+  case kInquiryMaxInterval:
+    *value = to_string(preferences.getUShort(
+        ParameterTypeToString(kInquiryMaxInterval).c_str(),
+        INQUIRY_DEFAULT_MAX_INTERVAL));
+    break;
+  case kRecoveryWindow:
+    *value = to_string(
+        preferences.getUShort(ParameterTypeToString(kRecoveryWindow).c_str(),
+                              RECOVERY_DEFAULT_WINDOW));
+    break;
+  case kRecoveryStats:
+    *value = recovery_stats_;
+    break;
+  case kBTFirmware:
+    *value = bt_firmware_;
+    break;
+  case kBTLink:
+    *value = bt_link_;
+    break;
+  case kUARTStats:
+    *value = uart_stats_;
+    break;
+  case kBLEStats:
+    *value = ble_stats_;
+    break;
+  case kBLEButtons:
+    *value = ble_buttons_;
+    break;
+  case kCoexStats:
+    *value = coex_stats_;
+    break;
+  case kAudioLevel:
+    *value = audio_level_;
+    break;
+  case kGainCalibration:
+    *value = gain_calibration_.getResult();
+    break;
   default:
     return kError;
     break;
@@ -145,17 +226,70 @@ ResultType BTTRX_CONTROL::action(string name) {
     wt32i_->resetBTPairings();
     return kSuccess;
   }
+  if (name == "calibrateGain") {
+    std::lock_guard<std::mutex> lock(values_mutex_);
+    if (gain_calibration_.isRunning()) {
+      return kError;
+    }
+    LOG_INFO("Gain calibration started");
+    dac_gain_before_calibration_ = dac_gain_;
+    gain_calibration_.start();
+    return kSuccess;
+  }
   return kError;
 }
 
+/**
+ * @brief Step the DAC gain while a calibration runs, has to be called in the
+ * main loop. The gain found is set on the WT32i, which stores it. Without a
+ * usable signal the previous gain is restored
+ *
+ * @param now Current time in ms
+ * @param peak Highest audio level since the previous call in ADC counts
+ */
+void BTTRX_CONTROL::runGainCalibration(ulong now, uint16_t peak) {
+  std::unique_lock<std::mutex> lock(values_mutex_);
+  if (!gain_calibration_.isRunning()) {
+    return;
+  }
+  int gain = gain_calibration_.update(now, peak);
+  bool changed = gain >= 0;
+  if (changed) {
+    dac_gain_ = GainCalibration::toGainString(gain);
+  }
+  if (gain_calibration_.getState() == kGainCalibrationFailed) {
+    dac_gain_ = dac_gain_before_calibration_;
+    changed = true;
+  }
+  if (!gain_calibration_.isRunning()) {
+    LOG_INFO("Gain calibration: %s", gain_calibration_.getResult().c_str());
+  }
+  string adc_gain = adc_gain_;
+  string dac_gain = dac_gain_;
+  lock.unlock();
+  if (changed) {
+    wt32i_->setAudioGain(adc_gain, dac_gain);
+  }
+}
+
+/**
+ * @brief Check if a gain calibration runs, e.g. to sample the audio level
+ */
+bool BTTRX_CONTROL::isCalibratingGain() {
+  std::lock_guard<std::mutex> lock(values_mutex_);
+  return gain_calibration_.isRunning();
+}
+
 /**
  * @brief Store current value of a parameter in member variable
- * Used during startup to store values read from WT32i to this object
+ * Used during startup to store values read from WT32i to this object and by
+ * the main loop to publish statistics
  *
  * @param type
  * @param value
  */
 void BTTRX_CONTROL::storeSetting(ParameterType type, string value) {
+  std::lock_guard<std::mutex> lock(values_mutex_);
   switch (type) {
   case kADCGain:
     adc_gain_ = value;
@@ -169,6 +303,30 @@ void BTTRX_CONTROL::storeSetting(ParameterType type, string value) {
   case kStatusmessage:
     status_message_ = value;
     break;
+  case kRecoveryStats:
+    recovery_stats_ = value;
+    break;
+  case kBTFirmware:
+    bt_firmware_ = value;
+    break;
+  case kBTLink:
+    bt_link_ = value;
+    break;
+  case kUARTStats:
+    uart_stats_ = value;
+    break;
+  case kBLEStats:
+    ble_stats_ = value;
+    break;
+  case kBLEButtons:
+    ble_buttons_ = value;
+    break;
+  case kCoexStats:
+    coex_stats_ = value;
+    break;
+  case kAudioLevel:
+    audio_level_ = value;
+    break;
   default:
     break;
   }
@@ -218,6 +376,72 @@ uint16_t BTTRX_CONTROL::getPTTHangTime() {
   return stoi(value);
 }
 
+/**
+ * @brief Getter method for the VOX threshold
+ *
+ * @return uint16_t in ADC counts
+ */
+uint16_t BTTRX_CONTROL::getVoxThreshold() {
+  string value = "";
+  get(kVoxThreshold, &value);
+  return stoi(value);
+}
+
+/**
+ * @brief Getter method for the VOX hang time
+ *
+ * @return uint16_t in ms
+ */
+uint16_t BTTRX_CONTROL::getVoxHangTime() {
+  string value = "";
+  get(kVoxHangTime, &value);
+  return stoi(value);
+}
+
+/**
+ * @brief Getter method for the CTCSS tone VOX waits for
+ *
+ * @return uint16_t in 0.1 Hz, 0 = off
+ */
+uint16_t BTTRX_CONTROL::getCTCSSTone() {
+  string value = "";
+  get(kCTCSSTone, &value);
+  return stoi(value);
+}
+
+/**
+ * @brief Getter method for the radio duty cycle budget of inquiries
+ *
+ * @return uint16_t in percent
+ */
+uint16_t BTTRX_CONTROL::getInquiryDutyCycle() {
+  string value = "";
+  get(kInquiryDutyCycle, &value);
+  return stoi(value);
+}
+
+/**
+ * @brief Getter method for the maximum interval between inquiries
+ *
+ * @return uint16_t in seconds
+ */
+uint16_t BTTRX_CONTROL::getInquiryMaxInterval() {
+  string value = "";
+  get(kInquiryMaxInterval, &value);
+  return stoi(value);
+}
+
+/**
+ * @brief Getter method for the time to try to reconnect a lost device
+ *
+ * @return uint16_t in seconds
+ */
+uint16_t BTTRX_CONTROL::getRecoveryWindow() {
+  string value = "";
+  get(kRecoveryWindow, &value);
+  return stoi(value);
+}
+
 /**
  * @brief Convert parameter string to parameter Type
  *
@@ -249,6 +473,51 @@ ParameterType BTTRX_CONTROL::stringToParameterType(string name) {
   if (name == "ptt_hang_time") {
     return kPTTHangTime;
   }
+  if (name == "vox_threshold") {
+    return kVoxThreshold;
+  }
+  if (name == "vox_hang_time") {
+    return kVoxHangTime;
+  }
+  if (name == "ctcss_tone") {
+    return kCTCSSTone;
+  }
+  if (name == "inquiry_duty_cycle") {
+    return kInquiryDutyCycle;
+  }
+  if (name == "inquiry_max_interval") {
+    return kInquiryMaxInterval;
+  }
+  if (name == "recovery_window") {
+    return kRecoveryWindow;
+  }
+  if (name == "recovery_stats") {
+    return kRecoveryStats;
+  }
+  if (name == "bt_firmware") {
+    return kBTFirmware;
+  }
+  if (name == "bt_link") {
+    return kBTLink;
+  }
+  if (name == "uart_stats") {
+    return kUARTStats;
+  }
+  if (name == "ble_stats") {
+    return kBLEStats;
+  }
+  if (name == "ble_buttons") {
+    return kBLEButtons;
+  }
+  if (name == "coex_stats") {
+    return kCoexStats;
+  }
+  if (name == "audio_level") {
+    return kAudioLevel;
+  }
+  if (name == "gain_calibration") {
+    return kGainCalibration;
+  }
   return kUnkownParameter;
 }
 
@@ -285,6 +554,51 @@ string BTTRX_CONTROL::ParameterTypeToString(ParameterType parameter_type) {
   case kPTTHangTime:
     return_value = "ptt_hang_time";
     break;
+  case kVoxThreshold:
+    return_value = "vox_threshold";
+    break;
+  case kVoxHangTime:
+    return_value = "vox_hang_time";
+    break;
+  case kCTCSSTone:
+    return_value = "ctcss_tone";
+    break;
+  case kInquiryDutyCycle:
+    return_value = "inquiry_duty_cycle";
+    break;
+  case kInquiryMaxInterval:
+    return_value = "inquiry_max_interval";
+    break;
+  case kRecoveryWindow:
+    return_value = "recovery_window";
+    break;
+  case kRecoveryStats:
+    return_value = "recovery_stats";
+    break;
+  case kBTFirmware:
+    return_value = "bt_firmware";
+    break;
+  case kBTLink:
+    return_value = "bt_link";
+    break;
+  case kUARTStats:
+    return_value = "uart_stats";
+    break;
+  case kBLEStats:
+    return_value = "ble_stats";
+    break;
+  case kBLEButtons:
+    return_value = "ble_buttons";
+    break;
+  case kCoexStats:
+    return_value = "coex_stats";
+    break;
+  case kAudioLevel:
+    return_value = "audio_level";
+    break;
+  case kGainCalibration:
+    return_value = "gain_calibration";
+    break;
   default:
     break;
   }
@@ -299,14 +613,14 @@ string BTTRX_CONTROL::ParameterTypeToString(ParameterType parameter_type) {
  */
 ResultType BTTRX_CONTROL::handleSetCallsign(string callsign) {
   if (callsign.length() > CALLSIGN_LENGTH) {
-    serial_->dbg_println("Callsign exceed maximum length. Max. length is: " +
-                         CALLSIGN_LENGTH);
+    LOG_WARNING("Callsign exceed maximum length. Max. length is: %d",
+                CALLSIGN_LENGTH);
     return kError;
   } else {
     if (!callsign.empty()) {
-      serial_->dbg_println("Set Callsign to: " + callsign);
+      LOG_INFO("Set Callsign to: %s", callsign.c_str());
     } else {
-      serial_->dbg_println("Callsign deleted");
+      LOG_INFO("Callsign deleted");
     }
   }
 
@@ -322,13 +636,18 @@ ResultType BTTRX_CONTROL::handleSetCallsign(string callsign) {
  * @return ResultType
  */
 ResultType BTTRX_CONTROL::handleSetADCGain(string adc_gain) {
-  serial_->dbg_println("Set ADC Gain to: " + adc_gain);
+  LOG_INFO("Set ADC Gain to: %s", adc_gain.c_str());
 
   // TODO Check value range
 
-  adc_gain_ = adc_gain;
+  string dac_gain;
+  {
+    std::lock_guard<std::mutex> lock(values_mutex_);
+    adc_gain_ = adc_gain;
+    dac_gain = dac_gain_;
+  }
   // Set on wt32i
-  return wt32i_->setAudioGain(adc_gain_, dac_gain_);
+  return wt32i_->setAudioGain(adc_gain, dac_gain);
 }
 
 /**
@@ -338,13 +657,18 @@ ResultType BTTRX_CONTROL::handleSetADCGain(string adc_gain) {
  * @return ResultType
  */
 ResultType BTTRX_CONTROL::handleSetDACGain(string dac_gain) {
-  serial_->dbg_println("Set DAC Gain to: " + dac_gain);
+  LOG_INFO("Set DAC Gain to: %s", dac_gain.c_str());
 
   // TODO Check value range
 
-  dac_gain_ = dac_gain;
+  string adc_gain;
+  {
+    std::lock_guard<std::mutex> lock(values_mutex_);
+    dac_gain_ = dac_gain;
+    adc_gain = adc_gain_;
+  }
   // Set on wt32i
-  return wt32i_->setAudioGain(adc_gain_, dac_gain_);
+  return wt32i_->setAudioGain(adc_gain, dac_gain);
 }
 
 /**
@@ -354,16 +678,19 @@ ResultType BTTRX_CONTROL::handleSetDACGain(string dac_gain) {
  * @return ResultType
  */
 ResultType BTTRX_CONTROL::handleSetPinCode(string pin_code) {
-  serial_->dbg_println("Set PIN to: " + pin_code);
+  LOG_INFO("Set PIN to: %s", pin_code.c_str());
 
   // TODO Check value range
   if (pin_code.length() != 4) {
     return kError;
   }
 
-  pin_code_ = pin_code;
+  {
+    std::lock_guard<std::mutex> lock(values_mutex_);
+    pin_code_ = pin_code;
+  }
   // Set on wt32i
-  return wt32i_->setPinCode(pin_code_);
+  return wt32i_->setPinCode(pin_code);
 }
 
 /**
@@ -374,7 +701,7 @@ ResultType BTTRX_CONTROL::handleSetPinCode(string pin_code) {
  */
 ResultType BTTRX_CONTROL::handleSetPTTMode(string ptt_mode) {
   uint16_t value = stoi(ptt_mode);
-  if (value < 4) {
+  if (value < 5) {
     preferences.putUShort(ParameterTypeToString(kPTTMode).c_str(), value);
     return kSuccess;
   }
@@ -410,3 +737,98 @@ ResultType BTTRX_CONTROL::handleSetPTTHangTime(string hang_time) {
   }
   return kError;
 }
+
+/**
+ * @brief Set the envelope level above which VOX keys PTT
+ *
+ * @param threshold in ADC counts (1-2047)
+ * @return ResultType
+ */
+ResultType BTTRX_CONTROL::handleSetVoxThreshold(string threshold) {
+  uint16_t value = stoi(threshold);
+  if (value >= 1 && value <= 2047) {
+    preferences.putUShort(ParameterTypeToString(kVoxThreshold).c_str(),
+                          value);
+    return kSuccess;
+  }
+  return kError;
+}
+
+/**
+ * @brief Set the time VOX keeps PTT after the audio went quiet
+ *
+ * @param hang_time in ms (0-5000)
+ * @return ResultType
+ */
+ResultType BTTRX_CONTROL::handleSetVoxHangTime(string hang_time) {
+  uint16_t value = stoi(hang_time);
+  if (value <= 5000) {
+    preferences.putUShort(ParameterTypeToString(kVoxHangTime).c_str(), value);
+    return kSuccess;
+  }
+  return kError;
+}
+
+/**
+ * @brief Set the CTCSS tone that has to be present for VOX to key PTT
+ *
+ * @param tone in 0.1 Hz, one of the EIA tones (e.g. 885), 0 = off
+ * @return ResultType
+ */
+ResultType BTTRX_CONTROL::handleSetCTCSSTone(string tone) {
+  uint16_t value = stoi(tone);
+  if (value == 0 || ToneDetector::isCTCSSTone(value)) {
+    preferences.putUShort(ParameterTypeToString(kCTCSSTone).c_str(), value);
+    return kSuccess;
+  }
+  return kError;
+}
+
+/**
+ * @brief Set the radio duty cycle budget of inquiries
+ *
+ * @param duty_cycle in percent (1-100)
+ * @return ResultType
+ */
+ResultType BTTRX_CONTROL::handleSetInquiryDutyCycle(string duty_cycle) {
+  uint16_t value = stoi(duty_cycle);
+  if (value >= 1 && value <= 100) {
+    preferences.putUShort(ParameterTypeToString(kInquiryDutyCycle).c_str(),
+                          value);
+    return kSuccess;
+  }
+  return kError;
+}
+
+/**
+ * @brief Set the maximum interval between inquiries
+ *
+ * @param max_interval in seconds (10-3600)
+ * @return ResultType
+ */
+ResultType BTTRX_CONTROL::handleSetInquiryMaxInterval(string max_interval) {
+  uint16_t value = stoi(max_interval);
+  if (value >= 10 && value <= 3600) {
+    preferences.putUShort(ParameterTypeToString(kInquiryMaxInterval).c_str(),
+                          value);
+    return kSuccess;
+  }
+  return kError;
+}
+
+/**
+ * @brief Set the time to try to reconnect a lost device before falling back
+ * to inquiry
+ *
+ * @param window in seconds (0-600, 0 = off)
+ * @return ResultType
+ */
+ResultType BTTRX_CONTROL::handleSetRecoveryWindow(string window) {
+  uint16_t value = stoi(window);
+  if (value <= 600) {
+    preferences.putUShort(ParameterTypeToString(kRecoveryWindow).c_str(),
+                          value);
+    return kSuccess;
+  }
+  return kError;
+}
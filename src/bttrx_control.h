@@ -20,6 +20,7 @@ Contact: bt-trx.com, mail@bt-trx.com
 
 #pragma once
 
+#include "gaincalibration.h"
 #include "resulttype.h"
 #include "serialwrapper.h"
 #include "wt32i.h"
@@ -30,6 +31,8 @@ Contact: bt-trx.com, mail@bt-trx.com
 #include "../test/esp32_mock/Preferences.h"
 #endif
 
+#include <atomic>
+#include <mutex>
 #include <string>
 using namespace std;
 
@@ -42,10 +45,25 @@ enum ParameterType {
   kPinCode,
   kPTTMode,
   kPTTTimeout,
-  kPTTHangTime
+  kPTTHangTime,
+  kVoxThreshold,
+  kVoxHangTime,
+  kCTCSSTone,
+  kInquiryDutyCycle,
+  kInquiryMaxInterval,
+  kRecoveryWindow,
+  kRecoveryStats,
+  kBTFirmware,
+  kBTLink,
+  kUARTStats,
+  kBLEStats,
+  kBLEButtons,
+  kCoexStats,
+  kAudioLevel,
+  kGainCalibration
 };
 
-enum PTTMode { kUnkownPTTMode, kDirect, kToggle, kWillimode };
+enum PTTMode { kUnkownPTTMode, kDirect, kToggle, kWillimode, kVox };
 
 class BTTRX_CONTROL {
 public:
@@ -56,11 +74,20 @@ public:
   ResultType get(ParameterType, bool *);
   ResultType action(string);
   void storeSetting(ParameterType, string);
+  void runGainCalibration(ulong, uint16_t);
+  bool isCalibratingGain();
+  uint32_t getSettingsRevision() { return settings_revision_; };
 
   string getCallsign();
   PTTMode getPTTMode();
   uint16_t getPTTTimeout();
   uint16_t getPTTHangTime();
+  uint16_t getVoxThreshold();
+  uint16_t getVoxHangTime();
+  uint16_t getCTCSSTone();
+  uint16_t getInquiryDutyCycle();
+  uint16_t getInquiryMaxInterval();
+  uint16_t getRecoveryWindow();
 
 private:
   SerialWrapperInterface *serial_;
@@ -76,9 +103,32 @@ private:
   ResultType handleSetPTTMode(string);
   ResultType handleSetPTTTimeout(string);
   ResultType handleSetPTTHangTime(string);
+  ResultType handleSetVoxThreshold(string);
+  ResultType handleSetVoxHangTime(string);
+  ResultType handleSetCTCSSTone(string);
+  ResultType handleSetInquiryDutyCycle(string);
+  ResultType handleSetInquiryMaxInterval(string);
+  ResultType handleSetRecoveryWindow(string);
+
+  // Counts the settings changed by set(), for callers caching them
+  std::atomic<uint32_t> settings_revision_{0};
+
+  // The values below are written by the main loop and read by the web
+  // server task
+  std::mutex values_mutex_;
+  GainCalibration gain_calibration_;
+  string dac_gain_before_calibration_;
 
   string adc_gain_ = "0";
   string dac_gain_ = "0";
   string pin_code_ = "0000";
   string status_message_ = "";
+  string recovery_stats_ = "";
+  string bt_firmware_ = "";
+  string bt_link_ = "";
+  string uart_stats_ = "";
+  string ble_stats_ = "";
+  string ble_buttons_ = "";
+  string coex_stats_ = "";
+  string audio_level_ = "";
 };
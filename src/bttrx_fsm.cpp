@@ -19,14 +19,24 @@ Contact: bt-trx.com, mail@bt-trx.com
 */
 
 #include "bttrx_fsm.h"
+#include "logger.h"
 #include "resulttype.h"
 #include "splitstring.h"
 
+extern Preferences preferences;
+
 BTTRX_FSM::BTTRX_FSM()
     : bttrx_control_(&serial_, &wt32i_), current_state_(STATE_INIT),
       led_connected_(PIN_LED_BLUE), led_busy_(PIN_LED_GREEN),
       helper_button_(PIN_BTN_0), ptt_button_(PIN_PTT_IN),
-      ptt_output_(PIN_PTT_OUT, PIN_PTT_LED) {}
+      ptt_output_(PIN_PTT_OUT, PIN_PTT_LED), peer_list_(&preferences),
+      bd_address_cache_(&preferences) {
+  // There is no real network behind the HFP-AG, always report full service
+  hfp_indicators_.set(kHFPService, 1);
+  hfp_indicators_.set(kHFPSignal, 5);
+  vox_.setToneDetector(&tones_);
+  vox_.setLevelMeter(&level_meter_);
+}
 
 BTTRX_FSM::BTTRX_FSM(Stream *serial_bt, Stream *serial_dbg) : BTTRX_FSM() {
   setSerial(serial_bt, serial_dbg);
@@ -37,6 +47,26 @@ void BTTRX_FSM::setSerial(Stream *serial_bt, Stream *serial_dbg) {
   wt32i_.setSerialWrapper(&serial_);
 }
 
+/**
+ * @brief Allow switching the UART to the fast rate after boot. Without a
+ * callback the module stays at SERIAL_BT_RATE
+ *
+ * @param callback reopens the UART with the given rate
+ * @param fast_rate rate negotiated after boot, 0: switch the module back to
+ * SERIAL_BT_RATE if it still runs with a rate stored before
+ */
+void BTTRX_FSM::setBaudRateCallback(BaudRateCallback callback,
+                                    uint32_t fast_rate) {
+  baud_rate_callback_ = callback;
+  fast_rate_ = fast_rate;
+}
+
+/**
+ * @brief Start sampling the audio to the TRX before the first call, e.g. for
+ * the level meter of the web interface
+ */
+void BTTRX_FSM::startAudio() { vox_.begin(); }
+
 /**
  * @brief Run the State Machine, has to be called in the main loop
  *
@@ -45,7 +75,17 @@ void BTTRX_FSM::run() {
   // Read button states
   ptt_button_.update();
   helper_button_.update();
-  ble_button_.update();
+  ble_buttons_.update();
+  vox_.update();
+  if ((ble_buttons_.isPressedEdge() || ble_buttons_.isReleasedEdge()) &&
+      ble_buttons_.getEdgeSource() >= 0) {
+    LOG_DEBUG("BLE PTT %d %s %lu ms ago", ble_buttons_.getEdgeSource() + 1,
+              ble_buttons_.isPressed() ? "pressed" : "released",
+              millis() - ble_buttons_.getEdgeTime());
+  }
+  if (helper_button_.isPressedEdge()) {
+    helper_press_start_ = millis();
+  }
 
   // Run State Machine
   switch (current_state_) {
@@ -55,6 +95,9 @@ void BTTRX_FSM::run() {
   case STATE_CONFIGURE:
     handleStateConfigure();
     break;
+  case STATE_PAGING:
+    handleStatePaging();
+    break;
   case STATE_INQUIRY:
     handleStateInquiry();
     break;
@@ -67,19 +110,59 @@ void BTTRX_FSM::run() {
   case STATE_CALL_RUNNING:
     handleStateCallRunning();
     break;
+  case STATE_RECOVERING:
+    handleStateRecovering();
+    break;
   default:
-    serial_.dbg_println("ERROR: TRYING TO REACH UNKOWN STATE");
+    LOG_ERROR("ERROR: TRYING TO REACH UNKOWN STATE");
     while (true)
       ;
     break;
   }
+
+  // Indicators changed during this run are sent in one batch
+  if (getConnectedLinkCount() > 0 && hfp_indicators_.pending()) {
+    hfp_indicators_.flush(&wt32i_);
+  }
+  updateAudioLevel();
+}
+
+/**
+ * @brief Hand the audio level to a running gain calibration and publish it
+ * every LEVEL_METER_INTERVAL, the web interface reads it without touching
+ * the sampling task
+ */
+void BTTRX_FSM::updateAudioLevel() {
+  uint16_t peak = level_meter_.readPeak();
+  if (bttrx_control_.isCalibratingGain()) {
+    vox_.begin();
+    bttrx_control_.runGainCalibration(millis(), peak);
+  }
+  if (peak > audio_peak_) {
+    audio_peak_ = peak;
+  }
+
+  if (millis() - level_meter_time_ < LEVEL_METER_INTERVAL) {
+    return;
+  }
+  level_meter_time_ = millis();
+  bttrx_control_.storeSetting(
+      kAudioLevel, LevelMeter::formatLevel(audio_peak_, level_meter_.getRMS()));
+  audio_peak_ = 0;
 }
 
 void BTTRX_FSM::updateStatusmessage() {
   string message = "";
-  string device_name = remote_device_info_.bd_address;
-  if (!remote_device_info_.bd_friendly_name.empty()) {
-    device_name = remote_device_info_.bd_friendly_name;
+  string device_name = "";
+  if (isTrackedLink(active_link_)) {
+    device_name = remote_devices_[active_link_].bd_address;
+    if (!remote_devices_[active_link_].bd_friendly_name.empty()) {
+      device_name = remote_devices_[active_link_].bd_friendly_name;
+    }
+  }
+  int other_links = getConnectedLinkCount() - 1;
+  if (other_links > 0) {
+    device_name += " (+" + to_string(other_links) + ")";
   }
 
   switch (current_state_) {
@@ -89,11 +172,14 @@ void BTTRX_FSM::updateStatusmessage() {
   case STATE_CONFIGURE:
     message = "Configuring...";
     break;
+  case STATE_PAGING:
+    message = "Reconnecting to " + pending_address_;
+    break;
   case STATE_INQUIRY:
     message = "Looking for Bluetooth devices...";
     break;
   case STATE_CONNECTING:
-    message = "Connecting to " + remote_device_info_.bd_address;
+    message = "Connecting to " + pending_address_;
     break;
   case STATE_CONNECTED:
     message = "Connected to " + device_name;
@@ -101,6 +187,9 @@ void BTTRX_FSM::updateStatusmessage() {
   case STATE_CALL_RUNNING:
     message = "Call running";
     break;
+  case STATE_RECOVERING:
+    message = "Connection lost, reconnecting to " + recovery_address_;
+    break;
   default:
     break;
   }
@@ -111,25 +200,156 @@ void BTTRX_FSM::updateStatusmessage() {
 }
 
 /**
- * @brief StateInit: Try to reach the Bluetooth module
- * If the Bluetooth module is available, advance to next state
+ * @brief StateInit: Reset the Bluetooth module and wait for it to boot
+ * PIN_BT_RESET gets pulsed, the module is ready once the boot banner ends
+ * with "READY.". Without a banner, "AT" is used to reach the module.
+ * Without an answer the other rate is tried, even if the fast rate is
+ * disabled, since the module keeps a stored rate. Afterwards the UART is
+ * switched to the target rate and confirmed with "AT", falling back to the
+ * rate the module answered with if it doesn't answer.
  */
 void BTTRX_FSM::handleStateInit() {
   led_busy_.off();
   led_connected_.off();
   ptt_output_.off();
 
-  // Try to reach Bt Module
-  if (wt32i_.available() == ResultType::kSuccess) {
-    setState(STATE_CONFIGURE);
+  ulong now = millis();
+  switch (init_step_) {
+  case kInitReset:
+    digitalWrite(PIN_BT_RESET, LOW); // Active low
+    init_start_ = now;
+    init_step_ = kInitRelease;
+    break;
+  case kInitRelease:
+    if (now - init_start_ < BT_RESET_PULSE) {
+      break;
+    }
+    digitalWrite(PIN_BT_RESET, HIGH);
+    init_start_ = now;
+    bt_ready_ = false;
+    init_step_ = kInitWaitReady;
+    break;
+  case kInitWaitReady:
+    handleIncomingMessage();
+    if (bt_ready_) {
+      boot_time_ = now - init_start_;
+      startBaudRateSwitch();
+    } else if (now - init_start_ >= BT_READY_TIMEOUT) {
+      LOG_WARNING("WARNING: no boot banner from WT32i module");
+      wt32i_.probe();
+      init_step_ = kInitProbe;
+    }
+    break;
+  case kInitProbe:
+    handleIncomingMessage();
+    if (bt_ready_) {
+      boot_time_ = now - init_start_;
+      startBaudRateSwitch();
+    } else if (now - init_start_ >= BT_READY_TIMEOUT + BT_PROBE_TIMEOUT) {
+      LOG_ERROR("ERROR: can't reach WT32i module");
+      // The module keeps its rate over a reset, try the other one next time
+      if (baud_rate_callback_ != NULL) {
+        uint32_t other_rate =
+            fast_rate_ != 0 ? fast_rate_ : SERIAL_BT_PROBE_RATE;
+        changeBaudRate(baud_rate_ == SERIAL_BT_RATE ? other_rate
+                                                    : SERIAL_BT_RATE);
+      }
+      init_step_ = kInitReset;
+    }
+    break;
+  case kInitBaudConfirm:
+    handleIncomingMessage();
+    if (bt_ready_) {
+      finishInit();
+    } else if (now - init_start_ >= BT_PROBE_TIMEOUT) {
+      LOG_WARNING("WARNING: no answer at %u baud, falling back to %u baud",
+                  (unsigned)baud_rate_, (unsigned)found_rate_);
+      changeBaudRate(found_rate_);
+      baud_rate_fallback_ = true;
+      bt_ready_ = false;
+      wt32i_.probe();
+      init_start_ = now;
+      init_step_ = kInitBaudFallback;
+    }
+    break;
+  case kInitBaudFallback:
+    handleIncomingMessage();
+    if (bt_ready_) {
+      finishInit();
+    } else if (now - init_start_ >= BT_PROBE_TIMEOUT) {
+      LOG_ERROR("ERROR: can't reach WT32i module after changing baud rate");
+      init_step_ = kInitReset;
+    }
+    break;
+  }
+}
+
+/**
+ * @brief Reopen the UART to the module, pending output is sent with the old
+ * rate
+ */
+void BTTRX_FSM::changeBaudRate(uint32_t baud_rate) {
+  baud_rate_ = baud_rate;
+  if (baud_rate_callback_ != NULL) {
+    baud_rate_callback_(baud_rate);
+  }
+}
+
+/**
+ * @brief Rate the module should run with: the fast rate, SERIAL_BT_RATE if
+ * it is disabled or failed before
+ */
+uint32_t BTTRX_FSM::targetBaudRate() const {
+  return fast_rate_ != 0 && !baud_rate_fallback_ ? fast_rate_
+                                                 : SERIAL_BT_RATE;
+}
+
+/**
+ * @brief Switch module and UART to the target rate and confirm the link
+ * with "AT". The rate is stored by the module, nothing to do if the module
+ * already came up with it
+ */
+void BTTRX_FSM::startBaudRateSwitch() {
+  uint32_t target = targetBaudRate();
+  if (baud_rate_callback_ == NULL || baud_rate_fallback_ ||
+      baud_rate_ == target) {
+    finishInit();
+    return;
+  }
+  found_rate_ = baud_rate_;
+  wt32i_.setBaudRate(target);
+  changeBaudRate(target);
+  bt_ready_ = false;
+  wt32i_.probe();
+  init_start_ = millis();
+  init_step_ = kInitBaudConfirm;
+}
+
+/**
+ * @brief Leave StateInit, report firmware version and boot time
+ */
+void BTTRX_FSM::finishInit() {
+  string firmware = wt32i_.getFirmwareVersion();
+  if (firmware.empty()) {
+    firmware = "unknown";
   } else {
-    serial_.dbg_println("ERROR: can't reach WT32i module");
+    firmware += " build " + to_string(wt32i_.getFirmwareBuild());
   }
+  firmware += ", ready after " + to_string(boot_time_) + " ms";
+  bttrx_control_.storeSetting(kBTFirmware, firmware);
+  LOG_INFO("WT32i: iWrap %s", firmware.c_str());
+
+  init_step_ = kInitReset;
+  configure_step_ = kConfigureStart;
+  setState(STATE_CONFIGURE);
 }
 
 /**
  * @brief StateConfigure: Check and correct the configuration of the
  * Bluetooth module
+ * The current configuration is read back first ("SET" dump), only differing
+ * settings are written, pipelined without waiting for each answer. A second
+ * read back verifies the result.
  */
 void BTTRX_FSM::handleStateConfigure() {
   led_busy_.on();
@@ -141,44 +361,159 @@ void BTTRX_FSM::handleStateConfigure() {
     return;
   }
 
-  // Enforce configuration
-  string friendly_name = "bt-trx_";
-  string callsign = bttrx_control_.getCallsign();
-  if (!callsign.empty()) {
-    wt32i_.set("BT", "NAME", friendly_name + callsign);
-  } else {
-    wt32i_.set("BT", "NAME", friendly_name + wt32i_.getBDAddressSuffix());
+  string callsign;
+  string bd_address;
+  switch (configure_step_) {
+  case kConfigureStart:
+    configure_begin_ = millis();
+    bd_address_cache_.load();
+    setDesiredConfiguration();
+    readConfiguration();
+    configure_step_ = kConfigureRead;
+    break;
+  case kConfigureRead:
+    if (!config_dump_complete_ &&
+        millis() - configure_start_ < CONFIG_READ_TIMEOUT) {
+      break;
+    }
+    // The name depends on the BD address. The cached one is used if the dump
+    // is incomplete, the one read back replaces it if the module changed
+    callsign = bttrx_control_.getCallsign();
+    bd_address = config_.getCurrent("BT BDADDR");
+    if (bd_address.empty()) {
+      bd_address = bd_address_cache_.get();
+    } else if (bd_address_cache_.update(bd_address)) {
+      LOG_INFO("BD address cached: %s", bd_address.c_str());
+    }
+    if (!callsign.empty()) {
+      config_.setDesired("BT NAME", "bt-trx_" + callsign);
+    } else if (!bd_address.empty()) {
+      config_.setDesired("BT NAME",
+                         "bt-trx_" + WT32i::stripBDAddress(bd_address));
+    }
+    if (config_.writeDifferences(&wt32i_) == 0) {
+      finishConfiguration();
+      break;
+    }
+    readConfiguration();
+    configure_step_ = kConfigureVerify;
+    break;
+  case kConfigureVerify:
+    if (!config_dump_complete_ &&
+        millis() - configure_start_ < CONFIG_READ_TIMEOUT) {
+      break;
+    }
+    if (config_.countDifferences() > 0) {
+      LOG_WARNING("WARNING: CONFIGURATION MISMATCH: %s",
+                  config_.getDifferences().c_str());
+    }
+    finishConfiguration();
+    break;
   }
+}
 
-  wt32i_.set("PROFILE", "HFP-AG", "ON");
-  wt32i_.set("BT", "CLASS", "400204"); // HFP-AG
-  wt32i_.set("BT", "SSP",
-             "1 0"); // Display yes/no button, MITM not mandatory
+/**
+ * @brief Set up the configuration the Bluetooth module has to run with
+ */
+void BTTRX_FSM::setDesiredConfiguration() {
+  config_.clear();
+  config_.setDesired("PROFILE HFP-AG", "ON");
+  config_.setDesired("BT CLASS", "400204"); // HFP-AG
+  // Display yes/no button, MITM not mandatory
+  config_.setDesired("BT SSP", "1 0");
 
   // Service Class: Audio, Major Device Class: Audio/Video
-  wt32i_.set("BT", "FILTER", "200400 200400");
+  config_.setDesired("BT FILTER", "200400 200400");
   // Set PIN to 0000 as fallback if no SSP is available
-  wt32i_.set("BT", "AUTH *", "0000");
+  config_.setDesired("BT AUTH *", "0000");
 
   // Configuration: KLUDGE REMOVE_PAIR NO_AUTO_DATAMODE HFP_ERROR_BYPASS
-  // MITM_DISCARD_L4_KEY
-  wt32i_.set("CONTROL", "CONFIG", "0001 0000 00A0 1100");
-  wt32i_.set("CONTROL", "ECHO", "5"); // Do not echo issued commands
+  // MITM_DISCARD_L4_KEY RSSI_IN_INQUIRY
+  config_.setDesired("CONTROL CONFIG", "0001 0000 00A0 1101");
+  config_.setDesired("CONTROL ECHO", "5"); // Do not echo issued commands
 
-  // Future (needs iWrap 6.2)
-  // wt32i_.set("CONTROL", "HFPINIT", "SERVICE 1 SIGNAL 5");
+  if (wt32i_.isFirmwareAtLeast(6, 2)) {
+    config_.setDesired("CONTROL HFPINIT", "SERVICE 1 SIGNAL 5");
+  }
+
+  // The name is derived from the BD address once it has been read back
+  config_.watch("BT NAME");
+  config_.watch("BT BDADDR");
+}
 
-  // Read wt32i configuration to get current values of ADC/DAC Gain and PIN
+/**
+ * @brief Request a dump of all settings, non-blocking. Also yields the current
+ * values of ADC/DAC Gain and PIN
+ */
+void BTTRX_FSM::readConfiguration() {
+  config_.resetReadBack();
+  config_dump_complete_ = false;
+  configure_start_ = millis();
   wt32i_.set();
+}
+
+/**
+ * @brief Leave StateConfigure, try the recently used devices first, inquiry
+ * takes several seconds
+ */
+void BTTRX_FSM::finishConfiguration() {
+  configure_step_ = kConfigureStart;
+  string link = to_string(baud_rate_) + " baud, boot " +
+                to_string(boot_time_) + " ms, config " +
+                to_string(millis() - configure_begin_) + " ms";
+  bttrx_control_.storeSetting(kBTLink, link);
+  LOG_INFO("WT32i: %s", link.c_str());
   wt32i_.list();
 
-  setState(STATE_INQUIRY);
+  peer_list_.load();
+  page_index_ = 0;
+  pageNextPeer();
+}
+
+/**
+ * @brief StatePaging: Connect to the recently used devices one after another.
+ * Fall back to inquiry if none of them answers
+ */
+void BTTRX_FSM::handleStatePaging() {
+  led_busy_.off();
+  led_connected_.blink(250);
+  ptt_output_.off();
+
+  handleIncomingMessage();
+  if (current_state_ != STATE_PAGING) {
+    return;
+  }
+
+  if (millis() - page_start_ > PAGE_TIMEOUT) {
+    abandonPage();
+    pageNextPeer();
+  }
+}
+
+/**
+ * @brief Page the next device of the peer list, or start the inquiry if all
+ * of them have been tried
+ */
+void BTTRX_FSM::pageNextPeer() {
+  pending_link_ = -1;
+  if (page_index_ >= peer_list_.size()) {
+    pending_address_ = "";
+    setState(STATE_INQUIRY);
+    return;
+  }
+
+  pageDevice(peer_list_.at(page_index_++));
+  if (current_state_ != STATE_PAGING) {
+    setState(STATE_PAGING);
+  } else {
+    updateStatusmessage();
+  }
 }
 
 /**
  * @brief StateInquiry: Wait for connections (automatically
  * reestablished by already known partners). If no active connections appear,
- * make an inquiry for nearby devices regularly
+ * make an inquiry for nearby devices as scheduled by the InquiryScheduler
  */
 void BTTRX_FSM::handleStateInquiry() {
   led_busy_.off();
@@ -192,11 +527,71 @@ void BTTRX_FSM::handleStateInquiry() {
 
   ulong now = millis();
 
-  static ulong last_start_inquiry = -10000;
-  if (last_start_inquiry + 10000 < now && !wt32i_.inquiryRunning()) {
-    last_start_inquiry = now;
-    wt32i_.startInquiry();
+  // A button press indicates that the user is waiting for a connection
+  if (ptt_button_.isPressedEdge() || ble_buttons_.isPressedEdge() ||
+      helper_button_.isPressedEdge()) {
+    inquiry_scheduler_.reset(now);
+  }
+
+  if (wt32i_.inquiryRunning() && (long)(now - inquiry_deadline_) >= 0) {
+    // End or results of the inquiry got lost, use what has been found
+    LOG_WARNING("WARNING: inquiry timed out");
+    wt32i_.abortInquiry();
+    connectToBestInquiryResult();
+    return;
+  }
+
+  if (!wt32i_.inquiryRunning() && inquiry_scheduler_.isDue(now)) {
+    inquiry_scheduler_.setPolicy(bttrx_control_.getInquiryDutyCycle(),
+                                 bttrx_control_.getInquiryMaxInterval());
+    uint8_t duration = inquiry_scheduler_.start(now);
+    inquiry_start_ = now;
+    inquiry_deadline_ = now + duration * INQUIRY_UNIT + INQUIRY_TIMEOUT_MARGIN;
+    wt32i_.startInquiry(duration);
+  }
+}
+
+/**
+ * @brief Connect to the best device found by the last inquiry
+ */
+void BTTRX_FSM::connectToBestInquiryResult() {
+  string address = inquiry_cache_.selectBest(inquiry_start_, &peer_list_);
+  if (address.empty()) {
+    return;
+  }
+  pageDevice(address);
+  setState(STATE_CONNECTING);
+}
+
+/**
+ * @brief Start an outgoing HFP-AG connection, its link id is known once the
+ * CALL reply arrives
+ *
+ * @param bd_address
+ */
+void BTTRX_FSM::pageDevice(string bd_address) {
+  pending_address_ = bd_address;
+  pending_link_ = -1;
+  page_start_ = millis();
+  if (abandoned_address_ == bd_address) {
+    abandoned_address_ = "";
   }
+  wt32i_.connectHFPAG(bd_address);
+}
+
+/**
+ * @brief Give up the outgoing connection. Without a CALL reply, the link id
+ * is unknown yet: the connection gets closed once LIST reports it
+ */
+void BTTRX_FSM::abandonPage() {
+  if (pending_link_ >= 0) {
+    wt32i_.close(to_string(pending_link_));
+  } else if (!pending_address_.empty()) {
+    abandoned_address_ = pending_address_;
+    wt32i_.list();
+  }
+  pending_address_ = "";
+  pending_link_ = -1;
 }
 
 /**
@@ -227,31 +622,39 @@ void BTTRX_FSM::handleStateConnected() {
   }
 
   // If either the PTT button or the helper button is pressed, start a
-  // phone call
-  if (ptt_button_.isPressedEdge() || ble_button_.isPressedEdge() ||
-      helper_button_.isPressedEdge()) {
-    wt32i_.dial();
+  // phone call on the active link. A long press of the helper button
+  // switches the active link instead
+  if (ptt_button_.isPressedEdge() || ble_buttons_.isPressedEdge() ||
+      isHelperButtonShortPress()) {
+    wt32i_.dial(toCommandLink(active_link_));
   }
 
-  // Experimental: Workaround for iWrap 6.1.0, as AT+COPS message does not
-  // get exposed to us we have to send +COPS message on our own
   ulong now = millis();
-  ulong COPS_INTERVAL = 10000;
-  static ulong last_cops_sent = -COPS_INTERVAL;
-  if (last_cops_sent + COPS_INTERVAL < now) {
-    last_cops_sent = now;
-    serial_.println("+COPS: 0,0,\"BTTRX\"");
-    serial_.println("OK");
+
+  // Experimental: Workaround for iWrap before 6.2, as AT+COPS message does
+  // not get exposed to us we have to send +COPS message on our own
+  if (!wt32i_.isFirmwareAtLeast(6, 2) &&
+      now - cops_time_ >= HFP_COPS_INTERVAL) {
+    cops_time_ = now;
+    for (link_id_t link_id = 0; link_id < BT_MAX_LINKS; link_id++) {
+      if (isTrackedLink(link_id)) {
+        hfp_indicators_.requestOperator(link_id);
+      }
+    }
   }
 
-  // If not known yet, request the friendly name of the remote device
-  if (!remote_device_info_.bd_address.empty() &&
-      remote_device_info_.bd_friendly_name.empty()) {
-    ulong now = millis();
-    static ulong last_start_inquiry = -10000;
-    if (last_start_inquiry + 10000 < now) {
-      last_start_inquiry = now;
-      wt32i_.name(remote_device_info_.bd_address);
+  // If not known yet, request the friendly name of the remote devices, one
+  // at a time
+  static ulong last_name_request = -10000;
+  if (last_name_request + 10000 < now) {
+    for (link_id_t link_id = 0; link_id < BT_MAX_LINKS; link_id++) {
+      BDDeviceInfo *device = &remote_devices_[link_id];
+      if (device->link_state != kLinkUnused && !device->bd_address.empty() &&
+          device->bd_friendly_name.empty()) {
+        last_name_request = now;
+        wt32i_.name(device->bd_address);
+        break;
+      }
     }
   }
 }
@@ -268,22 +671,203 @@ void BTTRX_FSM::handleStateCallRunning() {
     return;
   }
 
+  // Audio is sampled from the first call on, for VOX and DTMF commands
+  vox_.begin();
   handlePTTDuringCall();
+  handleDTMFCommands();
 
   // If the button is pressed, send the "HANGUP" message.
   // State change back to STATE_CONNECTED happens when HFP device indicates
-  // end of call
-  if (helper_button_.isPressedEdge()) {
-    wt32i_.hangup();
+  // end of call. A long press moves the call to the next link instead
+  if (isHelperButtonShortPress()) {
+    wt32i_.hangup(toCommandLink(getCallLink()));
+  }
+}
+
+/**
+ * @brief Evaluate the helper button. With a single link, a press acts on the
+ * press edge. With several links, a long press switches the active link, so
+ * a short press is only known on release
+ *
+ * @return bool True if the press dials or hangs up
+ */
+bool BTTRX_FSM::isHelperButtonShortPress() {
+  if (getConnectedLinkCount() <= 1) {
+    return helper_button_.isPressedEdge();
+  }
+  if (!helper_button_.isReleasedEdge()) {
+    return false;
+  }
+  if (isHelperButtonLongPress()) {
+    selectNextLink();
+    return false;
   }
+  return true;
+}
+
+/**
+ * @brief Check if the helper button was held long enough to switch links
+ *
+ * @return bool True if the press lasted at least LINK_SWITCH_PRESS_DURATION
+ */
+bool BTTRX_FSM::isHelperButtonLongPress() {
+  return millis() - helper_press_start_ >= LINK_SWITCH_PRESS_DURATION;
 }
 
 /**
- * @brief Reads serial messages from the bluetooth module and handles them
+ * @brief STATE_RECOVERING: Connection to the last device was lost. Page it
+ * again and again until it answers or the recovery window has passed
+ */
+void BTTRX_FSM::handleStateRecovering() {
+  led_connected_.blink(250);
+  led_busy_.off();
+  ptt_output_.off();
+
+  handleIncomingMessage();
+  if (current_state_ != STATE_RECOVERING) {
+    return;
+  }
+
+  ulong now = millis();
+  if (now - recovery_start_ > recovery_window_) {
+    abandonPage();
+    finishRecovery(false);
+    inquiry_scheduler_.reset(now);
+    setState(STATE_INQUIRY);
+    return;
+  }
+
+  if (!pending_address_.empty() && now - page_start_ > PAGE_TIMEOUT) {
+    // No answer to the page, close it and try again
+    abandonPage();
+    next_recovery_page_ = now + RECOVERY_RETRY_INTERVAL;
+  }
+
+  if (pending_address_.empty() && (long)(now - next_recovery_page_) >= 0) {
+    pageDevice(recovery_address_);
+  }
+}
+
+/**
+ * @brief Start to reconnect a lost device
+ *
+ * @param bd_address
+ * @param window Time to keep paging in s
+ */
+void BTTRX_FSM::startRecovery(string bd_address, uint16_t window) {
+  recovery_address_ = bd_address;
+  recovery_start_ = millis();
+  recovery_window_ = window * 1000ul;
+  next_recovery_page_ = recovery_start_;
+  pending_address_ = "";
+  pending_link_ = -1;
+  recovery_attempts_++;
+  setState(STATE_RECOVERING);
+}
+
+/**
+ * @brief A link came up during STATE_RECOVERING. The recovery ends once the
+ * address of the link is known: successfully if it is the lost device.
+ * Otherwise another device connected and the lost one is not paged anymore
+ *
+ * @param link_id
+ */
+void BTTRX_FSM::checkRecovery(link_id_t link_id) {
+  string bd_address = remote_devices_[link_id].bd_address;
+  if (bd_address.empty()) {
+    return; // Known once LIST reports the link
+  }
+  abandonPage();
+  finishRecovery(bd_address == recovery_address_);
+  updateStateFromLinks();
+}
+
+/**
+ * @brief Update the recovery statistics. The caller leaves STATE_RECOVERING
+ *
+ * @param success True if the lost device is connected again
+ */
+void BTTRX_FSM::finishRecovery(bool success) {
+  if (success) {
+    ulong duration = millis() - recovery_start_;
+    recoveries_++;
+    recovery_time_total_ += duration;
+    recovery_time_max_ = max(recovery_time_max_, duration);
+    LOG_INFO("INFO: link recovered after %lu ms", duration);
+  } else {
+    LOG_INFO("INFO: link recovery failed");
+  }
+  recovery_address_ = "";
+
+  string stats = to_string(recoveries_) + "/" +
+                 to_string(recovery_attempts_) + " recovered";
+  if (recoveries_ > 0) {
+    stats += ", avg " + to_string(recovery_time_total_ / recoveries_) +
+             " ms, max " + to_string(recovery_time_max_) + " ms";
+  }
+  bttrx_control_.storeSetting(kRecoveryStats, stats);
+}
+
+/**
+ * @brief Reads serial messages from the bluetooth module and handles all
+ * pending ones. Stops early if the state changed or a step of the current
+ * state completed, so it can react before the next message.
  */
 void BTTRX_FSM::handleIncomingMessage() {
-  iWrapMessage msg;
-  wt32i_.getIncomingMessage(&msg);
+  state_t state = current_state_;
+  for (int i = 0; i < UART_QUEUE_SIZE; i++) {
+    iWrapMessage msg;
+    wt32i_.getIncomingMessage(&msg);
+    if (msg.msg_type == kEmpty) {
+      break;
+    }
+    handleMessage(msg);
+    if (current_state_ != state || msg.msg_type == kSETTING_DUMP_END ||
+        (current_state_ == STATE_INIT && bt_ready_)) {
+      break;
+    }
+  }
+  updateUARTStats();
+}
+
+/**
+ * @brief Start reading the Bluetooth module in a separate task
+ *
+ * @param serial_bt Stream of the Bluetooth module
+ */
+void BTTRX_FSM::startUARTReader(Stream *serial_bt) {
+  uart_reader_.begin(serial_bt);
+  serial_.setReader(&uart_reader_);
+}
+
+/**
+ * @brief Report the fill level and the stalls of the UART reader queue
+ */
+void BTTRX_FSM::updateUARTStats() {
+  size_t high_water = uart_reader_.getHighWater();
+  uint32_t stalls = uart_reader_.getStalls();
+  if (high_water == uart_high_water_ && stalls == uart_stalls_) {
+    return;
+  }
+  if (stalls != uart_stalls_) {
+    LOG_WARNING("WARNING: UART reader queue full %u times",
+                (unsigned)(stalls - uart_stalls_));
+  }
+  uart_high_water_ = high_water;
+  uart_stalls_ = stalls;
+  bttrx_control_.storeSetting(
+      kUARTStats, "high water " + to_string(high_water) + "/" +
+                      to_string(uart_reader_.getCapacity()) + ", stalls " +
+                      to_string(stalls));
+}
+
+/**
+ * @brief Handle a single message of the bluetooth module
+ */
+void BTTRX_FSM::handleMessage(iWrapMessage &msg) {
+  if (current_state_ == STATE_CONFIGURE) {
+    config_.readBack(msg.msg);
+  }
 
   switch (msg.msg_type) {
   case kSETTING_CONTROL_GAIN:
@@ -293,58 +877,161 @@ void BTTRX_FSM::handleIncomingMessage() {
   case kSETTING_PIN_CODE:
     bttrx_control_.storeSetting(kPinCode, splitString(msg.msg)[4]);
     break;
+  case kSETTING_DUMP_END:
+    config_dump_complete_ = true;
+    break;
+  case kBOOT_READY:
+  case kOK:
+    if (current_state_ == STATE_INIT) {
+      bt_ready_ = true;
+    }
+    break;
   case kLIST_RESULT:
-    if (current_state_ != STATE_CONNECTED) {
-      // Kill existing connections
+    if (isTrackedLink(msg.link_id)) {
+      // LIST is polled, only a newly learned address counts as use
+      string bd_address = splitString(msg.msg)[10];
+      if (remote_devices_[msg.link_id].bd_address != bd_address) {
+        remote_devices_[msg.link_id].bd_address = bd_address;
+        peer_list_.touch(bd_address);
+      }
+      if (bd_address == pending_address_) {
+        // The paged device connected before its CALL reply was seen
+        pending_address_ = "";
+        pending_link_ = -1;
+      }
+      if (current_state_ == STATE_RECOVERING) {
+        checkRecovery(msg.link_id);
+      }
+      updateStatusmessage();
+    } else if (!abandoned_address_.empty() &&
+               splitString(msg.msg)[10] == abandoned_address_) {
+      // Page given up before the CALL reply
+      wt32i_.close(splitString(msg.msg)[1]);
+      abandoned_address_ = "";
+    } else if (getConnectedLinkCount() == 0 &&
+               (current_state_ == STATE_CONFIGURE ||
+                current_state_ == STATE_INQUIRY)) {
+      // Kill stale connections from before our (re)start
       wt32i_.close(splitString(msg.msg)[1]);
-    } else if (current_state_ == STATE_CONNECTED) {
-      remote_device_info_.bd_address = splitString(msg.msg)[10];
     }
     break;
+  case kINQUIRY_PARTIAL:
+    inquiry_cache_.update(msg.msg, millis());
+    break;
   case kINQUIRY_RESULT:
+  case kINQUIRY_FINISHED:
+    if (msg.msg_type == kINQUIRY_RESULT) {
+      inquiry_cache_.update(msg.msg, millis());
+    }
     // In the meantime, we may have got an incoming connection and we do not
     // need to try to connect. So only do this in case we are still in the
-    // INQUIRY state
-    if (current_state_ == STATE_INQUIRY) {
-      if (!wt32i_.getInquiredDevices().empty()) {
-        remote_device_info_.bd_address = wt32i_.getInquiredDevices().at(0);
-        wt32i_.connectHFPAG(remote_device_info_.bd_address);
-        setState(STATE_CONNECTING);
-      }
+    // INQUIRY state, once all results are known
+    if (current_state_ == STATE_INQUIRY && !wt32i_.inquiryRunning()) {
+      connectToBestInquiryResult();
     }
     break;
-  case kNAME_RESULT:
+  case kINQUIRY_ERROR:
+    LOG_WARNING("WARNING: %s", msg.msg.c_str());
+    break;
+  case kCALL_RESULT:
+    if (current_state_ == STATE_PAGING || current_state_ == STATE_CONNECTING ||
+        current_state_ == STATE_RECOVERING) {
+      pending_link_ = msg.link_id;
+    }
+    break;
+  case kNAME_RESULT: {
     // Store friendly name
-    remote_device_info_.bd_friendly_name = splitString(msg.msg, "\"")[1];
-    updateStatusmessage();
+    link_id_t link_id = findLink(splitString(msg.msg)[1]);
+    if (link_id >= 0) {
+      remote_devices_[link_id].bd_friendly_name =
+          splitString(msg.msg, "\"")[1];
+      updateStatusmessage();
+    } else {
+      inquiry_cache_.setName(splitString(msg.msg)[1],
+                             splitString(msg.msg, "\"")[1]);
+    }
     break;
+  }
   case kHFPAG_READY:
     // Indication that HFP-AG connection was successful
-    wt32i_.indicateNetworkAvailable();
+    addLink(msg.link_id);
+    if (!wt32i_.isFirmwareAtLeast(6, 2)) {
+      // Experimental: Workaround for iWrap before 6.2, AT+COPS message does
+      // not get exposed to us, so send +COPS on our own, repeated while
+      // connected. Newer versions report the initial indicators on their
+      // own (CONTROL HFPINIT)
+      hfp_indicators_.resend(msg.link_id);
+      hfp_indicators_.requestOperator(msg.link_id);
+      cops_time_ = millis();
+    } else {
+      hfp_indicators_.acknowledge(msg.link_id);
+    }
     wt32i_.list();
-    setState(STATE_CONNECTED);
+    if (current_state_ == STATE_RECOVERING) {
+      checkRecovery(msg.link_id);
+    } else {
+      updateStateFromLinks();
+    }
     break;
   case kHFPAG_CALLING:
-    // Indication that an outgoing phone call is requested
-    wt32i_.connect();
+    // Indication that an outgoing phone call is requested. The link the
+    // request came from gets PTT and audio
+    if (isTrackedLink(msg.link_id) && msg.link_id != active_link_) {
+      selectActiveLink(msg.link_id);
+    }
+    wt32i_.connect(toCommandLink(msg.link_id));
+    break;
+  case kSCO_CONNECT:
+    sco_link_ = msg.link_id;
     break;
   case kHFPAG_CONNECT:
     // Phone call established
-    setState(STATE_CALL_RUNNING);
+    if (isTrackedLink(msg.link_id)) {
+      remote_devices_[msg.link_id].link_state = kLinkCallRunning;
+    }
+    if (current_state_ != STATE_CALL_RUNNING) {
+      setState(STATE_CALL_RUNNING);
+    }
     break;
   case kHFPAG_NO_CARRIER:
     // Phone call ended
-    setState(STATE_CONNECTED);
+    if (isTrackedLink(msg.link_id)) {
+      remote_devices_[msg.link_id].link_state = kLinkConnected;
+    }
+    updateStateFromLinks();
     break;
   case kHFPAG_UNKOWN:
     // Handle AT command
     wt32i_.handleMessage_HFPAG_UNKNOWN(msg);
     break;
   case kNOCARRIER_ERROR_LINK_LOSS:
-    // Connection try was unsuccessful, get back to inquiry
-    remote_device_info_.bd_address = "";
-    remote_device_info_.bd_friendly_name = "";
-    setState(STATE_INQUIRY);
+  case kNOCARRIER_ERROR_CALL_ENDED:
+    if (msg.link_id == sco_link_) {
+      sco_link_ = -1;
+    }
+    if (isTrackedLink(msg.link_id)) {
+      // HFP-AG link lost, continue with the remaining links
+      removeLink(msg.link_id);
+    } else if (current_state_ == STATE_PAGING) {
+      if (msg.link_id == pending_link_) {
+        // Known device did not answer, try the next one
+        pageNextPeer();
+      }
+    } else if (current_state_ == STATE_RECOVERING) {
+      if (msg.link_id == pending_link_) {
+        // Lost device did not answer (yet), try again shortly
+        pending_address_ = "";
+        pending_link_ = -1;
+        next_recovery_page_ = millis() + RECOVERY_RETRY_INTERVAL;
+      }
+    } else if (msg.msg_type == kNOCARRIER_ERROR_LINK_LOSS &&
+               getConnectedLinkCount() == 0) {
+      // Connection try was unsuccessful, get back to inquiry
+      pending_address_ = "";
+      pending_link_ = -1;
+      setState(STATE_INQUIRY);
+    }
+    // Otherwise an audio (SCO) link of a call was closed
     break;
   case kSSP_CONFIRM:
     wt32i_.sendSSPConfirmation(splitString(msg.msg)[2]);
@@ -354,6 +1041,192 @@ void BTTRX_FSM::handleIncomingMessage() {
   }
 }
 
+/**
+ * @brief Count the HFP-AG links which are currently established
+ *
+ * @return int
+ */
+int BTTRX_FSM::getConnectedLinkCount() {
+  int count = 0;
+  for (link_id_t link_id = 0; link_id < BT_MAX_LINKS; link_id++) {
+    if (remote_devices_[link_id].link_state != kLinkUnused) {
+      count++;
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Check if the link id belongs to an established HFP-AG link
+ *
+ * @param link_id
+ * @return bool
+ */
+bool BTTRX_FSM::isTrackedLink(link_id_t link_id) {
+  return link_id >= 0 && link_id < BT_MAX_LINKS &&
+         remote_devices_[link_id].link_state != kLinkUnused;
+}
+
+/**
+ * @brief Find the HFP-AG link to a remote device
+ *
+ * @param bd_address
+ * @return link_id_t -1 if there is no link to the device
+ */
+link_id_t BTTRX_FSM::findLink(string bd_address) {
+  for (link_id_t link_id = 0; link_id < BT_MAX_LINKS; link_id++) {
+    if (remote_devices_[link_id].link_state != kLinkUnused &&
+        remote_devices_[link_id].bd_address == bd_address) {
+      return link_id;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief Register a new HFP-AG link. The first link becomes the active one
+ *
+ * @param link_id
+ */
+void BTTRX_FSM::addLink(link_id_t link_id) {
+  if (link_id < 0 || link_id >= BT_MAX_LINKS) {
+    LOG_ERROR("ERROR: invalid link id");
+    return;
+  }
+  BDDeviceInfo *device = &remote_devices_[link_id];
+  if (device->link_state == kLinkUnused) {
+    *device = BDDeviceInfo();
+    device->link_state = kLinkConnected;
+  }
+  // Only the link of the outgoing connection gets its address, any other
+  // link learns the address from the LIST result
+  if (!pending_address_.empty() && pending_link_ == link_id) {
+    device->bd_address = pending_address_;
+    peer_list_.touch(pending_address_);
+    pending_address_ = "";
+    pending_link_ = -1;
+  }
+  if (!isTrackedLink(active_link_)) {
+    active_link_ = link_id;
+  }
+}
+
+/**
+ * @brief Forget a closed HFP-AG link. If it was the active link, the next
+ * remaining link takes over
+ *
+ * @param link_id
+ */
+void BTTRX_FSM::removeLink(link_id_t link_id) {
+  string bd_address = remote_devices_[link_id].bd_address;
+  remote_devices_[link_id] = BDDeviceInfo();
+  wt32i_.clearHFPStatus(link_id);
+  hfp_indicators_.disconnect(link_id);
+  if (link_id == active_link_) {
+    active_link_ = -1;
+    selectNextLink();
+  }
+  if (getConnectedLinkCount() == 0) {
+    // The device is probably still nearby, try to get it back quickly
+    uint16_t window = bttrx_control_.getRecoveryWindow();
+    if (!bd_address.empty() && window > 0) {
+      startRecovery(bd_address, window);
+      return;
+    }
+    inquiry_scheduler_.reset(millis());
+  }
+  updateStateFromLinks();
+}
+
+/**
+ * @brief Give PTT and audio to the given link. A running call moves to the
+ * new link: the old audio (SCO) link is closed, a new one is opened
+ *
+ * @param link_id
+ */
+void BTTRX_FSM::selectActiveLink(link_id_t link_id) {
+  active_link_ = link_id;
+  LOG_INFO("INFO: active link %d", link_id);
+  bool call_moved = false;
+  for (link_id_t other = 0; other < BT_MAX_LINKS; other++) {
+    if (other != link_id &&
+        remote_devices_[other].link_state == kLinkCallRunning) {
+      remote_devices_[other].link_state = kLinkConnected;
+      call_moved = true;
+    }
+  }
+  if (call_moved) {
+    if (sco_link_ >= 0) {
+      wt32i_.close(to_string(sco_link_));
+      sco_link_ = -1;
+    }
+    remote_devices_[link_id].link_state = kLinkCallRunning;
+    wt32i_.openSCO(link_id);
+  }
+  updateStatusmessage();
+}
+
+/**
+ * @brief Make the next established link (round robin) the active one
+ */
+void BTTRX_FSM::selectNextLink() {
+  for (int i = 1; i <= BT_MAX_LINKS; i++) {
+    link_id_t link_id = (active_link_ + i + BT_MAX_LINKS) % BT_MAX_LINKS;
+    if (isTrackedLink(link_id)) {
+      if (link_id != active_link_) {
+        selectActiveLink(link_id);
+      }
+      return;
+    }
+  }
+  active_link_ = -1;
+}
+
+/**
+ * @brief Find the link carrying the running call
+ *
+ * @return link_id_t The active link if no call is running
+ */
+link_id_t BTTRX_FSM::getCallLink() {
+  for (link_id_t link_id = 0; link_id < BT_MAX_LINKS; link_id++) {
+    if (remote_devices_[link_id].link_state == kLinkCallRunning) {
+      return link_id;
+    }
+  }
+  return active_link_;
+}
+
+/**
+ * @brief Address an HFP-AG command to a link. With a single link, the
+ * command is sent without link id as before
+ *
+ * @param link_id
+ * @return link_id_t -1 if the link id can be left out
+ */
+link_id_t BTTRX_FSM::toCommandLink(link_id_t link_id) {
+  return getConnectedLinkCount() > 1 ? link_id : -1;
+}
+
+/**
+ * @brief Derive the FSM state from the state of the HFP-AG links
+ */
+void BTTRX_FSM::updateStateFromLinks() {
+  state_t state = STATE_INQUIRY;
+  for (link_id_t link_id = 0; link_id < BT_MAX_LINKS; link_id++) {
+    if (remote_devices_[link_id].link_state == kLinkCallRunning) {
+      state = STATE_CALL_RUNNING;
+      break;
+    } else if (remote_devices_[link_id].link_state == kLinkConnected) {
+      state = STATE_CONNECTED;
+    }
+  }
+  if (state != current_state_) {
+    setState(state);
+  } else {
+    updateStatusmessage();
+  }
+}
+
 /**
  * @brief Helper function to change state machine states.
  * Currently only used to print a debug message on state change
@@ -364,25 +1237,37 @@ void BTTRX_FSM::setState(state_t state) {
   current_state_ = state;
   switch (state) {
   case STATE_INIT:
-    serial_.dbg_println("STATE: INIT");
+    LOG_INFO("STATE: INIT");
     break;
   case STATE_CONFIGURE:
-    serial_.dbg_println("STATE: CONFIGURE");
+    LOG_INFO("STATE: CONFIGURE");
+    break;
+  case STATE_PAGING:
+    LOG_INFO("STATE: PAGING");
     break;
   case STATE_INQUIRY:
-    serial_.dbg_println("STATE: INQUIRY");
+    LOG_INFO("STATE: INQUIRY");
     break;
   case STATE_CONNECTING:
-    serial_.dbg_println("STATE: CONNECTING");
+    LOG_INFO("STATE: CONNECTING");
     break;
   case STATE_CONNECTED:
-    serial_.dbg_println("STATE: CONNECTED");
+    LOG_INFO("STATE: CONNECTED");
     break;
-  case STATE_CALL_RUNNING:
-    serial_.dbg_println("STATE: CALL_RUNNING");
+  case STATE_CALL_RUNNING: {
+    LOG_INFO("STATE: CALL_RUNNING");
+    // Digits heard between calls are no commands
+    char digit;
+    while (tones_.readDigit(&digit)) {
+    }
+    dtmf_command_.clear();
+    break;
+  }
+  case STATE_RECOVERING:
+    LOG_INFO("STATE: RECOVERING");
     break;
   default:
-    serial_.dbg_println("ERROR: Trying to go into unkown state");
+    LOG_ERROR("ERROR: Trying to go into unkown state");
     break;
   }
 
@@ -409,24 +1294,28 @@ void BTTRX_FSM::handlePTTDuringCall() {
     handlePTTWiredWillimode();
     handlePTTBLEToggle();
     break;
+  case kVox:
+    handlePTTVox();
+    break;
   default:
     break;
   }
 }
 
 /**
- * @brief Handle press of wired and BLE PTT button in Direct Mode
+ * @brief Handle press of wired and BLE PTT button in Direct Mode. PTT is
+ * held while any of the buttons is pressed
  */
 void BTTRX_FSM::handlePTTDirect() {
   // Hold Button for PTT
-  if (ptt_button_.isPressedEdge() || ble_button_.isPressedEdge()) {
+  if (ptt_button_.isPressedEdge() || ble_buttons_.isPressedEdge()) {
     ptt_output_.on();
 #ifdef ARDUINO
     bttrx_display_.setTransmitMessage("<<< ON AIR >>>");
 #endif // ARDUINO
   } else if (ptt_button_.isReleased() &&
-             (!ble_button_.isConnected() ||
-              (ble_button_.isConnected() && ble_button_.isReleased()))) {
+             (!ble_buttons_.isConnected() ||
+              (ble_buttons_.isConnected() && ble_buttons_.isReleased()))) {
     ptt_output_.delayed_off(bttrx_control_.getPTTHangTime());
 #ifdef ARDUINO
     bttrx_display_.setTransmitMessage("idle");
@@ -481,7 +1370,7 @@ void BTTRX_FSM::handlePTTWiredWillimode() {
  */
 void BTTRX_FSM::handlePTTBLEToggle() {
   // Press Button to assert PTT, press again to release PTT
-  if (ble_button_.isPressedEdge()) {
+  if (ble_buttons_.isPressedEdge()) {
     ptt_output_.toggle(bttrx_control_.getPTTHangTime());
 #ifdef ARDUINO
     if (ptt_output_.getState()) {
@@ -492,3 +1381,56 @@ void BTTRX_FSM::handlePTTBLEToggle() {
 #endif // ARDUINO
   }
 }
+
+/**
+ * @brief Key PTT by the audio level on PIN_VOX_IN, the detector has its own
+ * hang time. With a CTCSS tone set, the tone has to be present as well.
+ * The settings are read from the preferences again only after a change
+ */
+void BTTRX_FSM::handlePTTVox() {
+  uint32_t revision = bttrx_control_.getSettingsRevision();
+  if (revision != vox_settings_revision_) {
+    vox_settings_revision_ = revision;
+    vox_.setThreshold(bttrx_control_.getVoxThreshold());
+    vox_.setHangTime(bttrx_control_.getVoxHangTime());
+    vox_ctcss_tone_ = bttrx_control_.getCTCSSTone();
+  }
+
+  bool key = vox_.isPressed() && (vox_ctcss_tone_ == 0 ||
+                                  tones_.getCTCSSTone() == vox_ctcss_tone_);
+  if (key && !vox_ptt_) {
+    vox_ptt_ = true;
+    ptt_output_.on();
+#ifdef ARDUINO
+    bttrx_display_.setTransmitMessage("<<< ON AIR >>>");
+#endif // ARDUINO
+  } else if (!key && vox_ptt_) {
+    vox_ptt_ = false;
+    ptt_output_.delayed_off(bttrx_control_.getPTTHangTime());
+#ifdef ARDUINO
+    bttrx_display_.setTransmitMessage("idle");
+#endif // ARDUINO
+  }
+}
+
+/**
+ * @brief Run remote commands sent as DTMF digits during a call. A command
+ * starts with "*" and ends with "#", e.g. DTMF_HANGUP_COMMAND "#"
+ */
+void BTTRX_FSM::handleDTMFCommands() {
+  char digit;
+  while (tones_.readDigit(&digit)) {
+    if (digit == '*') {
+      dtmf_command_ = "*";
+    } else if (digit == '#') {
+      if (dtmf_command_ == DTMF_HANGUP_COMMAND) {
+        LOG_INFO("DTMF: hangup");
+        wt32i_.hangup(toCommandLink(getCallLink()));
+      }
+      dtmf_command_.clear();
+    } else if (!dtmf_command_.empty() &&
+               dtmf_command_.length() <= DTMF_COMMAND_LENGTH) {
+      dtmf_command_ += digit;
+    }
+  }
+}
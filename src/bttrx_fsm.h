@@ -26,36 +26,57 @@ Contact: bt-trx.com, mail@bt-trx.com
 #include "arduino-mock/Serial.h"
 #endif
 
+#include "bdaddresscache.h"
 #include "bddeviceinfo.h"
 #include "bttrx_control.h"
 #include "bttrx_display.h"
-#include "button_ble.h"
+#include "button_ble_group.h"
 #include "button_hw.h"
+#include "hfpindicators.h"
+#include "inquirycache.h"
+#include "inquiryscheduler.h"
 #include "led.h"
+#include "levelmeter.h"
+#include "peerlist.h"
 #include "ptt.h"
 #include "settings.h"
+#include "tonedetector.h"
+#include "uartreader.h"
+#include "vox.h"
 #include "wt32i.h"
+#include "wt32iconfig.h"
 
 #include <string>
 using namespace std;
 
+/**
+ * @brief Reopens the UART to the Bluetooth module with another rate
+ */
+typedef void (*BaudRateCallback)(uint32_t);
+
 class BTTRX_FSM {
 public:
   enum state_t {
     STATE_INIT,
     STATE_CONFIGURE,
+    STATE_PAGING,
     STATE_INQUIRY,
     STATE_CONNECTING,
     STATE_CONNECTED,
-    STATE_CALL_RUNNING
+    STATE_CALL_RUNNING,
+    STATE_RECOVERING
   };
 
   BTTRX_FSM();
   BTTRX_FSM(Stream *serial_bt, Stream *serial_dbg = NULL);
   void setSerial(Stream *serial_bt, Stream *serial_dbg = NULL);
+  void setBaudRateCallback(BaudRateCallback,
+                           uint32_t fast_rate = SERIAL_BT_FAST_RATE);
+  void startUARTReader(Stream *serial_bt);
+  void startAudio();
   void run();
 
-  ButtonBLE *getBLEButtonHandler() { return &ble_button_; };
+  ButtonBLEGroup *getBLEButtonHandler() { return &ble_buttons_; };
 
   BTTRX_CONTROL bttrx_control_;
 #ifdef ARDUINO
@@ -64,37 +85,146 @@ public:
 
   // only required for unit testing
   state_t getCurrentState() { return current_state_; };
+  WT32i *getWT32i() { return &wt32i_; };
+  link_id_t getActiveLink() { return active_link_; };
+  int getConnectedLinkCount();
+  PeerList *getPeerList() { return &peer_list_; };
+  InquiryCache *getInquiryCache() { return &inquiry_cache_; };
+  WT32iConfig *getConfig() { return &config_; };
+  BDAddressCache *getBDAddressCache() { return &bd_address_cache_; };
+  ToneDetector *getToneDetector() { return &tones_; };
+  UARTReader *getUARTReader() { return &uart_reader_; };
 
 private:
   SerialWrapper serial_;
+  UARTReader uart_reader_;
+  size_t uart_high_water_ = 0;
+  uint32_t uart_stalls_ = 0;
+  void updateUARTStats();
   WT32i wt32i_;
+  WT32iConfig config_;
+  HFPIndicatorManager hfp_indicators_;
+  ulong cops_time_ = 0; // ms, +COPS last sent
 
   state_t current_state_;
   void setState(state_t);
 
+  // Sub-steps of STATE_INIT: reset pulse, boot banner, "AT" as fallback,
+  // switch to the fast rate and confirm it with "AT"
+  enum init_step_t {
+    kInitReset,
+    kInitRelease,
+    kInitWaitReady,
+    kInitProbe,
+    kInitBaudConfirm,
+    kInitBaudFallback
+  };
+  init_step_t init_step_ = kInitReset;
+  ulong init_start_ = 0;
+  bool bt_ready_ = false;
+  BaudRateCallback baud_rate_callback_ = NULL;
+  uint32_t baud_rate_ = SERIAL_BT_RATE;
+  uint32_t fast_rate_ = SERIAL_BT_FAST_RATE; // 0: stay at SERIAL_BT_RATE
+  uint32_t found_rate_ = SERIAL_BT_RATE; // Rate the module answered with
+  bool baud_rate_fallback_ = false; // Fast rate failed, don't try again
+  ulong boot_time_ = 0; // ms, reset to "READY."
+  ulong configure_begin_ = 0; // ms, for the configuration time
+  void changeBaudRate(uint32_t);
+  uint32_t targetBaudRate() const;
+  void startBaudRateSwitch();
+  void finishInit();
+
+  // Sub-steps of STATE_CONFIGURE, each waits for a "SET" dump
+  enum configure_step_t { kConfigureStart, kConfigureRead, kConfigureVerify };
+  configure_step_t configure_step_ = kConfigureStart;
+  ulong configure_start_ = 0;
+  bool config_dump_complete_ = false;
+
   LED led_connected_;
   LED led_busy_;
   ButtonHW helper_button_;
   ButtonHW ptt_button_;
-  ButtonBLE ble_button_;
+  ButtonBLEGroup ble_buttons_;
+  VOX vox_;
+  bool vox_ptt_ = false;
+  uint16_t vox_ctcss_tone_ = 0; // 0.1 Hz, cached with the VOX settings
+  uint32_t vox_settings_revision_ = UINT32_MAX; // Loaded with this revision
+  ToneDetector tones_;
+  LevelMeter level_meter_;
+  ulong level_meter_time_ = 0;
+  uint16_t audio_peak_ = 0; // ADC counts, since the level was published
+  void updateAudioLevel();
+  string dtmf_command_; // Digits since "*"
+  void handleDTMFCommands();
   PTT ptt_output_;
 
-  BDDeviceInfo remote_device_info_;
+  BDDeviceInfo remote_devices_[BT_MAX_LINKS];
+  link_id_t active_link_ = -1;
+  link_id_t sco_link_ = -1; // Audio of the running call
+  string pending_address_; // Outgoing connection attempt
+  link_id_t pending_link_ = -1;
+  string abandoned_address_; // Page given up before its CALL reply
+  void pageDevice(string);
+  void abandonPage();
+  PeerList peer_list_;
+  BDAddressCache bd_address_cache_;
+  size_t page_index_ = 0;
+  ulong page_start_ = 0;
+  InquiryCache inquiry_cache_;
+  InquiryScheduler inquiry_scheduler_;
+
+  // Reconnection of a lost device
+  string recovery_address_;
+  ulong recovery_start_ = 0;
+  ulong recovery_window_ = 0; // ms, read when the recovery starts
+  ulong next_recovery_page_ = 0;
+  uint16_t recovery_attempts_ = 0;
+  uint16_t recoveries_ = 0;
+  ulong recovery_time_total_ = 0; // ms
+  ulong recovery_time_max_ = 0;   // ms
+  void startRecovery(string, uint16_t);
+  void checkRecovery(link_id_t);
+  void finishRecovery(bool);
+  ulong inquiry_start_ = 0;
+  ulong inquiry_deadline_ = 0; // Results are overdue afterwards
+  ulong helper_press_start_ = 0;
   void updateStatusmessage();
 
+  // Link handling
+  bool isTrackedLink(link_id_t);
+  link_id_t findLink(string);
+  void addLink(link_id_t);
+  void removeLink(link_id_t);
+  void selectActiveLink(link_id_t);
+  void selectNextLink();
+  void updateStateFromLinks();
+  link_id_t getCallLink();
+  link_id_t toCommandLink(link_id_t);
+
   // FSM State handler
   void handleStateInit();
   void handleStateConfigure();
+  void setDesiredConfiguration();
+  void readConfiguration();
+  void finishConfiguration();
+  void handleStatePaging();
+  void pageNextPeer();
   void handleStateInquiry();
+  void connectToBestInquiryResult();
   void handleStateConnecting();
   void handleStateConnected();
   void handleStateCallRunning();
+  void handleStateRecovering();
+  bool isHelperButtonShortPress();
+  bool isHelperButtonLongPress();
   // Message handler
   void handleIncomingMessage();
+  void handleMessage(iWrapMessage &);
   // Handle PTT during Call
   void handlePTTDuringCall();
   void handlePTTDirect();
   void handlePTTWiredToggle();
   void handlePTTBLEToggle();
   void handlePTTWiredWillimode();
+  void handlePTTVox();
 };
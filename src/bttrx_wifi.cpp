@@ -87,7 +87,19 @@ void BTTRX_WIFI::firmwareUpdateResponse(AsyncWebServerRequest *request) {
   ESP.restart();
 }
 
+/**
+ * @brief Count a served request for the coexistence statistics
+ *
+ * @param start micros() when the request arrived
+ */
+void BTTRX_WIFI::countRequest(ulong start) {
+  if (coex_stats_ != nullptr) {
+    coex_stats_->countRequest(millis(), micros() - start);
+  }
+}
+
 void BTTRX_WIFI::handleSet(AsyncWebServerRequest *request) {
+  ulong start = micros();
   string name = "";
   string value = "";
   if (request->hasParam("id")) {
@@ -107,9 +119,11 @@ void BTTRX_WIFI::handleSet(AsyncWebServerRequest *request) {
   } else {
     request->send(500, "text/plain", "Error");
   }
+  countRequest(start);
 }
 
 void BTTRX_WIFI::handleGet(AsyncWebServerRequest *request) {
+  ulong start = micros();
   string name = "";
   if (request->hasParam("id")) {
     name = request->getParam("id")->value().c_str();
@@ -126,9 +140,11 @@ void BTTRX_WIFI::handleGet(AsyncWebServerRequest *request) {
   } else {
     request->send(500, "text/plain", "Error");
   }
+  countRequest(start);
 }
 
 void BTTRX_WIFI::handleAction(AsyncWebServerRequest *request) {
+  ulong start = micros();
   string name = "";
   if (request->hasParam("id")) {
     name = request->getParam("id")->value().c_str();
@@ -140,17 +156,19 @@ void BTTRX_WIFI::handleAction(AsyncWebServerRequest *request) {
 
   if (bttrx_control_->action(name) == kSuccess) {
     request->send(200, "text/plain", "Success");
-    return;
+  } else {
+    request->send(500, "text/plain", "Error");
   }
-  request->send(500, "text/plain", "Error");
+  countRequest(start);
 }
 
-void BTTRX_WIFI::setup(BTTRX_CONTROL *control) {
+void BTTRX_WIFI::setup(BTTRX_CONTROL *control, CoexStats *coex_stats) {
   if (control == nullptr) {
     Serial.println("nullptr given");
     return;
   }
   bttrx_control_ = control;
+  coex_stats_ = coex_stats;
 
   Serial.println("");
   Serial.println("Configuring access point...");
@@ -180,7 +198,8 @@ void BTTRX_WIFI::setup(BTTRX_CONTROL *control) {
   });
 
   /*return index page which is stored in serverIndex */
-  server.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
+  server.on("/", HTTP_GET, [this](AsyncWebServerRequest *request) {
+    ulong start = micros();
     String website = index_html;
     website.replace("%STYLE%", style_css);
     website.replace("%SCRIPT%", script_js);
@@ -189,6 +208,7 @@ void BTTRX_WIFI::setup(BTTRX_CONTROL *control) {
         request->beginResponse(200, "text/html", website);
     response->addHeader("Connection", "close");
     request->send(response);
+    countRequest(start);
   });
   /*handling uploading firmware file */
   server.on(
@@ -29,6 +29,7 @@ Contact: bt-trx.com, mail@bt-trx.com
 #include <WiFiAP.h>
 
 #include "bttrx_control.h"
+#include "coexstats.h"
 #include "settings.h"
 #include "website.h"
 
@@ -37,13 +38,15 @@ extern const char *GIT_REVISION;
 class BTTRX_WIFI {
 public:
   AsyncWebServer server = AsyncWebServer(80);
-  void setup(BTTRX_CONTROL *);
+  void setup(BTTRX_CONTROL *, CoexStats *);
   void handleSet(AsyncWebServerRequest *);
   void handleGet(AsyncWebServerRequest *);
   void handleAction(AsyncWebServerRequest *);
 
 private:
   BTTRX_CONTROL *bttrx_control_;
+  CoexStats *coex_stats_ = nullptr;
+  void countRequest(ulong);
   void firmwareUpdateResponse(AsyncWebServerRequest *);
   String resultPage(uint8_t);
   String updateErrorcodeToString(uint8_t);
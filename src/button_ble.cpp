@@ -20,31 +20,138 @@ Contact: bt-trx.com, mail@bt-trx.com
 
 #include "button_ble.h"
 
+#include <string.h>
+
+namespace {
+/**
+ * @brief Compare a notification with a message of the button. The payload
+ * is not null-terminated, a trailing null byte is accepted nevertheless.
+ */
+bool matches(const uint8_t *data, size_t length, const char *message,
+             size_t message_length) {
+  if (length < message_length || length > message_length + 1) {
+    return false;
+  }
+  if (length > message_length && data[message_length] != 0) {
+    return false;
+  }
+  return memcmp(data, message, message_length) == 0;
+}
+} // namespace
+
 /**
- * @brief Update the button state
+ * @brief Identify a notification of the button characteristic
  *
+ * @param data Payload, not null-terminated
+ * @param length Payload length in bytes
+ * @return BLENotification
  */
-void ButtonBLE::update() {
-  state_changed = false;
-  if (next_state != button_state) {
-    button_state = next_state;
-    state_changed = true;
+BLENotification ButtonBLE::parseNotification(const uint8_t *data,
+                                             size_t length) {
+  if (data == NULL) {
+    return kBLENotifyUnknown;
+  }
+  if (matches(data, length, "ELET1", 5)) {
+    return kBLENotifyPressed;
   }
+  if (matches(data, length, "ELET2", 5)) {
+    return kBLENotifyReleased;
+  }
+  if (length >= 4 && memcmp(data, "BATT", 4) == 0) {
+    return kBLENotifyBattery;
+  }
+  return kBLENotifyUnknown;
 }
 
-void ButtonBLE::setConnected(bool state) {
-  was_connected = is_connected;
-  is_connected = state;
+/**
+ * @brief Decode the level of a battery report
+ *
+ * @param data Payload "BATT" followed by decimal digits, not null-terminated
+ * @param length Payload length in bytes
+ * @return int Level as reported by the button, -1 if not decodable
+ */
+int ButtonBLE::parseBatteryLevel(const uint8_t *data, size_t length) {
+  if (parseNotification(data, length) != kBLENotifyBattery) {
+    return -1;
+  }
+  int level = -1;
+  for (size_t i = 4; i < length && data[i] != 0; i++) {
+    if (data[i] < '0' || data[i] > '9' || level > 999) {
+      return -1;
+    }
+    level = (level < 0 ? 0 : level * 10) + (data[i] - '0');
+  }
+  return level;
 }
 
 /**
- * @brief Update the button state
+ * @brief Queue a press or release, called by the task of the BLE stack only
  *
+ * @param data Payload, not null-terminated
+ * @param length Payload length in bytes
+ * @param time Time of reception in ms
+ * @return BLENotification
  */
-void ButtonBLE::setPressed() { next_state = BTNSTATE_PRESSED; }
+BLENotification ButtonBLE::handleNotification(const uint8_t *data,
+                                              size_t length, ulong time) {
+  BLENotification notification = parseNotification(data, length);
+  ButtonState state;
+  switch (notification) {
+  case kBLENotifyPressed:
+    state = BTNSTATE_PRESSED;
+    break;
+  case kBLENotifyReleased:
+    state = BTNSTATE_RELEASED;
+    break;
+  case kBLENotifyBattery:
+    battery_level_ = parseBatteryLevel(data, length);
+    return notification;
+  default:
+    return notification;
+  }
+  if (!events_.push({state, time})) {
+    dropped_++;
+  }
+  return notification;
+}
+
+/**
+ * @brief Update the button state, called by the main loop only. At most one
+ * edge is taken per call, so a short press within one loop iteration is
+ * still seen as press and release
+ *
+ */
+void ButtonBLE::update() {
+  state_changed = false;
+  ButtonBLEEvent event;
+  while (events_.pop(&event)) {
+    if (event.state != button_state) {
+      button_state = event.state;
+      edge_time_ = event.time;
+      state_changed = true;
+      break;
+    }
+  }
+}
 
 /**
- * @brief Update the button state
+ * @brief Account for an edge handled by the main loop
  *
+ * @param latency ms since the edge was received
  */
-void ButtonBLE::setReleased() { next_state = BTNSTATE_RELEASED; }
+void ButtonBLE::recordLatency(ulong latency) {
+  edges_++;
+  latency_total_ += latency;
+  if (latency > latency_max_) {
+    latency_max_ = latency;
+  }
+}
+
+ulong ButtonBLE::getLatencyAverage() {
+  return edges_ == 0 ? 0 : latency_total_ / edges_;
+}
+
+void ButtonBLE::setConnected(bool state) {
+  was_connected = is_connected;
+  is_connected = state;
+}
@@ -27,13 +27,45 @@ Contact: bt-trx.com, mail@bt-trx.com
 #endif
 
 #include "button.h"
+#include "settings.h"
+#include "spscqueue.h"
 
+#include <atomic>
+#include <stddef.h>
+
+enum BLENotification {
+  kBLENotifyUnknown,
+  kBLENotifyPressed,  // "ELET1"
+  kBLENotifyReleased, // "ELET2"
+  kBLENotifyBattery   // "BATTx"
+};
+
+typedef struct {
+  ButtonState state;
+  ulong time;
+} ButtonBLEEvent;
+
+/**
+ * @brief PTT button connected via BLE. Notifications arrive on the task of
+ * the BLE stack and are handed to the main loop as timestamped edges through
+ * a lock-free queue, without heap allocations.
+ */
 class ButtonBLE : public Button {
 public:
-  void setPressed();
-  void setReleased();
+  static BLENotification parseNotification(const uint8_t *, size_t);
+  static int parseBatteryLevel(const uint8_t *, size_t);
+  BLENotification handleNotification(const uint8_t *, size_t, ulong);
   void update();
 
+  ulong getEdgeTime() { return edge_time_; }
+  uint32_t getDropped() { return dropped_; }
+  int getBatteryLevel() { return battery_level_; }
+
+  void recordLatency(ulong);
+  uint32_t getEdges() { return edges_; }
+  ulong getLatencyMax() { return latency_max_; }
+  ulong getLatencyAverage();
+
   bool isConnected() { return is_connected; }
   bool wasConnected() { return was_connected; }
   bool disappeared() { return was_connected && !is_connected; }
@@ -42,5 +74,13 @@ public:
 private:
   bool is_connected = false;
   bool was_connected = false;
-  ButtonState next_state = BTNSTATE_UNKNOWN;
-};
\ No newline at end of file
+  SPSCQueue<ButtonBLEEvent, BLE_BUTTON_QUEUE_SIZE + 1> events_;
+  std::atomic<uint32_t> dropped_{0}; // Edges lost, the queue was full
+  std::atomic<int> battery_level_{-1}; // As reported by "BATTx", -1: unknown
+  ulong edge_time_ = 0;
+
+  // Time from reception of an edge to its handling by the main loop
+  uint32_t edges_ = 0;
+  ulong latency_total_ = 0;
+  ulong latency_max_ = 0;
+};
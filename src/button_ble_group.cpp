@@ -0,0 +1,118 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "button_ble_group.h"
+
+/**
+ * @brief Access a single button, e.g. to feed its notifications
+ *
+ * @param index 0 .. BLE_MAX_BUTTONS - 1
+ * @return ButtonBLE* NULL if out of range
+ */
+ButtonBLE *ButtonBLEGroup::getButton(size_t index) {
+  if (index >= BLE_MAX_BUTTONS) {
+    return NULL;
+  }
+  return &buttons_[index];
+}
+
+/**
+ * @brief Update all buttons and the merged state, called by the main loop.
+ * Disconnected buttons are ignored, a lost button can't hold PTT
+ */
+void ButtonBLEGroup::update() {
+  bool any_pressed = false;
+  bool any_released = false;
+  int source = -1;
+  for (int i = 0; i < BLE_MAX_BUTTONS; i++) {
+    ButtonBLE &button = buttons_[i];
+    button.update();
+    if (button.isPressedEdge() || button.isReleasedEdge()) {
+      button.recordLatency(millis() - button.getEdgeTime());
+      source = i;
+      revision_++;
+    }
+    if (button.getBatteryLevel() != battery_seen_[i] ||
+        button.isConnected() != connected_seen_[i]) {
+      battery_seen_[i] = button.getBatteryLevel();
+      connected_seen_[i] = button.isConnected();
+      revision_++;
+    }
+    if (button.isConnected()) {
+      any_pressed |= button.isPressed();
+      any_released |= button.isReleased();
+    }
+  }
+
+  ButtonState state = BTNSTATE_UNKNOWN;
+  if (any_pressed) {
+    state = BTNSTATE_PRESSED;
+  } else if (any_released) {
+    state = BTNSTATE_RELEASED;
+  }
+  state_changed = state != button_state;
+  button_state = state;
+  if (state_changed) {
+    // No source if a pressed button got lost
+    edge_source_ = source;
+    if (source >= 0) {
+      edge_time_ = buttons_[source].getEdgeTime();
+    }
+  }
+}
+
+bool ButtonBLEGroup::isConnected() { return getConnectedCount() > 0; }
+
+size_t ButtonBLEGroup::getConnectedCount() {
+  size_t count = 0;
+  for (int i = 0; i < BLE_MAX_BUTTONS; i++) {
+    if (buttons_[i].isConnected()) {
+      count++;
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Summary for the web interface
+ *
+ * @return string e.g. "1: connected, battery 4, 12 edges, latency avg 3 ms,
+ * max 9 ms; 2: not connected"
+ */
+string ButtonBLEGroup::getStats() {
+  string stats;
+  for (int i = 0; i < BLE_MAX_BUTTONS; i++) {
+    ButtonBLE &button = buttons_[i];
+    if (i > 0) {
+      stats += "; ";
+    }
+    stats += to_string(i + 1) + ": ";
+    stats += button.isConnected() ? "connected" : "not connected";
+    if (button.getBatteryLevel() >= 0) {
+      stats += ", battery " + to_string(button.getBatteryLevel());
+    }
+    if (button.getEdges() > 0) {
+      stats += ", " + to_string(button.getEdges()) + " edges, latency avg " +
+               to_string(button.getLatencyAverage()) + " ms, max " +
+               to_string(button.getLatencyMax()) + " ms";
+    }
+  }
+  return stats;
+}
@@ -0,0 +1,61 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+#include "arduino-mock/Arduino.h"
+#endif
+
+#include "button.h"
+#include "button_ble.h"
+#include "settings.h"
+
+#include <string>
+using namespace std;
+
+/**
+ * @brief Up to BLE_MAX_BUTTONS BLE PTT buttons, e.g. a handheld button and a
+ * foot switch, merged into a single button: it is pressed as long as any
+ * connected button is pressed
+ */
+class ButtonBLEGroup : public Button {
+public:
+  ButtonBLE *getButton(size_t);
+  size_t size() { return BLE_MAX_BUTTONS; }
+  void update();
+
+  bool isConnected();
+  size_t getConnectedCount();
+  ulong getEdgeTime() { return edge_time_; }
+  int getEdgeSource() { return edge_source_; }
+  uint32_t getRevision() { return revision_; }
+  string getStats();
+
+private:
+  ButtonBLE buttons_[BLE_MAX_BUTTONS];
+  bool connected_seen_[BLE_MAX_BUTTONS] = {};
+  int battery_seen_[BLE_MAX_BUTTONS] = {};
+  ulong edge_time_ = 0;
+  int edge_source_ = -1; // Button causing the last edge
+  uint32_t revision_ = 0; // Changes with the statistics
+};
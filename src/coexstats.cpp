@@ -0,0 +1,88 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "coexstats.h"
+
+/**
+ * @brief Record the heap a stack took while starting
+ *
+ * @param stack kCoexWiFi or kCoexBLE
+ * @param free_before Free heap before starting it in bytes
+ * @param free_after Free heap once it runs in bytes
+ */
+void CoexStats::stackStarted(CoexStack stack, uint32_t free_before,
+                             uint32_t free_after) {
+  stack_heap_[stack] = free_before > free_after ? free_before - free_after : 0;
+}
+
+/**
+ * @brief Count a served web request, called by the web server task only
+ *
+ * @param time Time the request arrived in ms
+ * @param duration Time spent serving it in us
+ */
+void CoexStats::countRequest(ulong time, uint32_t duration) {
+  last_request_ = time;
+  had_request_ = true;
+  requests_++;
+  request_time_total_ += duration;
+  if (duration > request_time_max_) {
+    request_time_max_ = duration;
+  }
+}
+
+/**
+ * @brief Check if the web interface is in use, BLE scans leave it more air
+ * time then
+ *
+ * @param now Current time in ms
+ * @return true if a request arrived within WIFI_TRAFFIC_HOLD
+ */
+bool CoexStats::isWebBusy(ulong now) {
+  return had_request_ && now - last_request_ < WIFI_TRAFFIC_HOLD;
+}
+
+/**
+ * @brief Average time spent serving a web request
+ *
+ * @return uint32_t us, 0 without requests
+ */
+uint32_t CoexStats::getRequestTimeAverage() {
+  uint32_t requests = requests_;
+  return requests == 0 ? 0 : request_time_total_ / requests;
+}
+
+/**
+ * @brief Summary of heap and web latency
+ *
+ * @param free_heap Current free heap in bytes
+ * @param min_free_heap Lowest free heap since boot in bytes
+ * @return string e.g. "heap 81234 free, 60120 min; wifi 42000 bytes, ble
+ * 38000 bytes; 5 requests, avg 900 us, max 2100 us"
+ */
+string CoexStats::getStats(uint32_t free_heap, uint32_t min_free_heap) {
+  return "heap " + to_string(free_heap) + " free, " +
+         to_string(min_free_heap) + " min; wifi " +
+         to_string(stack_heap_[kCoexWiFi]) + " bytes, ble " +
+         to_string(stack_heap_[kCoexBLE]) + " bytes; " +
+         to_string(requests_) + " requests, avg " +
+         to_string(getRequestTimeAverage()) + " us, max " +
+         to_string(request_time_max_) + " us";
+}
@@ -0,0 +1,63 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+#include "arduino-mock/Arduino.h"
+#endif
+
+#include "settings.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+using namespace std;
+
+enum CoexStack { kCoexWiFi, kCoexBLE };
+
+/**
+ * @brief Memory and latency figures of WiFi and BLE running side by side.
+ * Web requests are counted on the task of the web server, everything else
+ * runs in the main loop
+ */
+class CoexStats {
+public:
+  void stackStarted(CoexStack, uint32_t, uint32_t);
+  void countRequest(ulong, uint32_t);
+  bool isWebBusy(ulong);
+
+  uint32_t getStackHeap(CoexStack stack) { return stack_heap_[stack]; };
+  uint32_t getRequests() { return requests_; };
+  uint32_t getRequestTimeMax() { return request_time_max_; };
+  uint32_t getRequestTimeAverage();
+  string getStats(uint32_t, uint32_t);
+
+private:
+  uint32_t stack_heap_[2] = {}; // Bytes taken by starting each stack
+
+  std::atomic<ulong> last_request_{0}; // ms
+  std::atomic<bool> had_request_{false};
+  std::atomic<uint32_t> requests_{0};
+  std::atomic<uint32_t> request_time_total_{0}; // us
+  std::atomic<uint32_t> request_time_max_{0};   // us
+};
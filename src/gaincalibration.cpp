@@ -0,0 +1,142 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gaincalibration.h"
+#include "levelmeter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * @brief Start a new calibration, the first gain is set by the next update()
+ */
+void GainCalibration::start() {
+  state_ = kGainCalibrationRunning;
+  starting_ = true;
+  steps_ = 0;
+  low_ = 0;
+  high_ = GAIN_MAX;
+  gain_ = (low_ + high_) / 2;
+  has_best_ = false;
+}
+
+/**
+ * @brief Run the calibration, has to be called in the main loop
+ *
+ * @param now Current time in ms
+ * @param peak Highest level since the previous call in ADC counts
+ * @return int Gain to set now, -1 to keep the current one
+ */
+int GainCalibration::update(ulong now, uint16_t peak) {
+  if (state_ != kGainCalibrationRunning) {
+    return -1;
+  }
+  if (starting_) {
+    starting_ = false;
+    start_time_ = now;
+  } else if (now - step_start_ < GAIN_CALIBRATION_SETTLE) {
+    return -1; // Audio of the previous gain is still in the pipeline
+  } else {
+    if (peak > step_peak_) {
+      step_peak_ = peak;
+    }
+    if (now - step_start_ <
+        GAIN_CALIBRATION_SETTLE + GAIN_CALIBRATION_MEASURE) {
+      return -1;
+    }
+    finishStep();
+    if (low_ > high_) {
+      duration_ = now - start_time_;
+      state_ = has_best_ ? kGainCalibrationDone : kGainCalibrationFailed;
+      return has_best_ ? best_gain_ : -1;
+    }
+    gain_ = (low_ + high_) / 2;
+  }
+  step_start_ = now;
+  step_peak_ = 0;
+  return gain_;
+}
+
+/**
+ * @brief Evaluate the measured gain and narrow the search. A clipping or too
+ * loud gain moves the search down, a too quiet one up
+ */
+void GainCalibration::finishStep() {
+  steps_++;
+  int16_t level = LevelMeter::toDBFS(step_peak_);
+  bool clipped = step_peak_ >= GAIN_CALIBRATION_CLIP;
+  if (!clipped && level >= GAIN_CALIBRATION_MIN_LEVEL &&
+      (!has_best_ || abs(level - GAIN_CALIBRATION_TARGET) <
+                         abs(best_level_ - GAIN_CALIBRATION_TARGET))) {
+    has_best_ = true;
+    best_gain_ = gain_;
+    best_level_ = level;
+  }
+  if (has_best_ && getError() <= GAIN_CALIBRATION_TOLERANCE) {
+    low_ = high_ + 1; // No other step can come closer
+  } else if (clipped || level > GAIN_CALIBRATION_TARGET) {
+    high_ = gain_ - 1;
+  } else {
+    low_ = gain_ + 1;
+  }
+}
+
+/**
+ * @brief Distance of the chosen gain to the target, half a gain step at best
+ *
+ * @return int16_t dB
+ */
+int16_t GainCalibration::getError() {
+  return abs(best_level_ - GAIN_CALIBRATION_TARGET);
+}
+
+/**
+ * @brief Summary for the web interface
+ *
+ * @return string e.g. "gain c, peak -7 dBFS (1 dB off), 5 steps, 3000 ms"
+ */
+string GainCalibration::getResult() {
+  switch (state_) {
+  case kGainCalibrationRunning:
+    return "running, " + to_string(steps_) + " steps";
+  case kGainCalibrationDone:
+    return "gain " + toGainString(best_gain_) + ", peak " +
+           to_string(best_level_) + " dBFS (" + to_string(getError()) +
+           " dB off), " + to_string(steps_) + " steps, " +
+           to_string(duration_) + " ms";
+  case kGainCalibrationFailed:
+    return "failed, no usable signal, " + to_string(steps_) + " steps, " +
+           to_string(duration_) + " ms";
+  default:
+    return "";
+  }
+}
+
+/**
+ * @brief Format a gain step like "SET CONTROL GAIN" expects it
+ *
+ * @param gain 0 - GAIN_MAX
+ * @return string hexadecimal, e.g. "c"
+ */
+string GainCalibration::toGainString(uint8_t gain) {
+  char buffer[3];
+  snprintf(buffer, sizeof(buffer), "%x", gain);
+  return buffer;
+}
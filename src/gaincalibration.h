@@ -0,0 +1,82 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+#include "arduino-mock/Arduino.h"
+#endif
+
+#include "settings.h"
+
+#include <stdint.h>
+#include <string>
+using namespace std;
+
+enum GainCalibrationState {
+  kGainCalibrationIdle,
+  kGainCalibrationRunning,
+  kGainCalibrationDone,
+  kGainCalibrationFailed
+};
+
+/**
+ * @brief Finds the gain step that brings the audio peak closest to
+ * GAIN_CALIBRATION_TARGET. The steps are binary searched, each one is given
+ * time to settle and then measured. Nothing blocks: update() is called with
+ * the peak measured since its previous call and tells which gain to set
+ */
+class GainCalibration {
+public:
+  void start();
+  int update(ulong, uint16_t);
+
+  GainCalibrationState getState() { return state_; };
+  bool isRunning() { return state_ == kGainCalibrationRunning; };
+  uint8_t getGain() { return best_gain_; };
+  int16_t getLevel() { return best_level_; };
+  int16_t getError();
+  ulong getDuration() { return duration_; };
+  uint8_t getSteps() { return steps_; };
+  string getResult();
+
+  static string toGainString(uint8_t);
+
+private:
+  GainCalibrationState state_ = kGainCalibrationIdle;
+  bool starting_ = false;
+  ulong start_time_ = 0;
+  ulong step_start_ = 0;
+  ulong duration_ = 0; // ms
+  uint8_t steps_ = 0;
+
+  // Search range, inclusive
+  int low_ = 0;
+  int high_ = 0;
+  uint8_t gain_ = 0;
+  uint16_t step_peak_ = 0; // ADC counts
+
+  bool has_best_ = false;
+  uint8_t best_gain_ = 0;
+  int16_t best_level_ = 0; // dBFS
+  void finishStep();
+};
@@ -0,0 +1,47 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "goertzel.h"
+
+#include <math.h>
+
+/**
+ * @brief Tune the filter, the only floating point math is done here
+ *
+ * @param frequency in 0.1 Hz, e.g. 885 for the CTCSS tone 88.5 Hz
+ * @param sample_rate in Hz
+ */
+void Goertzel::begin(uint32_t frequency, uint32_t sample_rate) {
+  coefficient_ = (int32_t)lround(
+      2.0 * cos(2.0 * M_PI * frequency / (10.0 * sample_rate)) * (1 << 14));
+  reset();
+}
+
+/**
+ * @brief Power of the frequency in the samples since the last reset(). A
+ * sine of amplitude A over N samples gives (A * N / 2)^2
+ *
+ * @return int64_t
+ */
+int64_t Goertzel::getPower() {
+  int64_t s1 = s1_;
+  int64_t s2 = s2_;
+  return s1 * s1 + s2 * s2 - ((coefficient_ * s1) >> 14) * s2;
+}
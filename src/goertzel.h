@@ -0,0 +1,53 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief Fixed-point Goertzel filter, measures the power of one frequency
+ * over a block of samples. Per sample it takes one multiplication, the
+ * coefficient is Q14
+ */
+class Goertzel {
+public:
+  void begin(uint32_t, uint32_t);
+  void reset() { s1_ = s2_ = 0; };
+
+  /**
+   * @brief Feed one sample, inline as it runs at audio rate
+   *
+   * @param sample signed, at most 12 bit
+   */
+  void process(int32_t sample) {
+    int32_t s0 =
+        sample + (int32_t)(((int64_t)coefficient_ * s1_) >> 14) - s2_;
+    s2_ = s1_;
+    s1_ = s0;
+  }
+
+  int64_t getPower();
+
+private:
+  int32_t coefficient_ = 0; // 2 * cos(2 * pi * f / fs) in Q14
+  int32_t s1_ = 0;
+  int32_t s2_ = 0;
+};
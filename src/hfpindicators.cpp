@@ -0,0 +1,146 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "hfpindicators.h"
+
+#include <vector>
+
+/**
+ * @brief Set the value of an indicator, it is only sent if it changed
+ *
+ * @param indicator
+ * @param value
+ */
+void HFPIndicatorManager::set(HFPIndicator indicator, int8_t value) {
+  if (indicator >= kHFPIndicatorCount) {
+    return;
+  }
+  uint8_t bit = 1 << indicator;
+  if ((valid_ & bit) && values_[indicator] == value) {
+    return;
+  }
+  values_[indicator] = value;
+  valid_ |= bit;
+  for (link_id_t link_id = 0; link_id < BT_MAX_LINKS; link_id++) {
+    if (connected_ & (1 << link_id)) {
+      dirty_[link_id] |= bit;
+    }
+  }
+}
+
+/**
+ * @brief Send all known values to a link again, e.g. after it connected
+ *
+ * @param link_id
+ */
+void HFPIndicatorManager::resend(link_id_t link_id) {
+  if (!isValidLink(link_id)) {
+    return;
+  }
+  connected_ |= 1 << link_id;
+  dirty_[link_id] = valid_;
+}
+
+/**
+ * @brief Mark all values as known to the HFP device of a link, e.g. if the
+ * module reported them on its own
+ *
+ * @param link_id
+ */
+void HFPIndicatorManager::acknowledge(link_id_t link_id) {
+  if (!isValidLink(link_id)) {
+    return;
+  }
+  connected_ |= 1 << link_id;
+  dirty_[link_id] = 0;
+}
+
+/**
+ * @brief Send the network operator, for iWrap versions that do not forward
+ * AT+COPS? of the HFP device
+ *
+ * @param link_id
+ */
+void HFPIndicatorManager::requestOperator(link_id_t link_id) {
+  if (isValidLink(link_id)) {
+    operator_pending_ |= 1 << link_id;
+  }
+}
+
+/**
+ * @brief Forget a closed link, nothing is sent to it anymore
+ *
+ * @param link_id
+ */
+void HFPIndicatorManager::disconnect(link_id_t link_id) {
+  if (!isValidLink(link_id)) {
+    return;
+  }
+  connected_ &= ~(1 << link_id);
+  operator_pending_ &= ~(1 << link_id);
+  dirty_[link_id] = 0;
+}
+
+/**
+ * @brief Check if any link waits for values or the operator
+ *
+ * @return bool
+ */
+bool HFPIndicatorManager::pending() {
+  for (link_id_t link_id = 0; link_id < BT_MAX_LINKS; link_id++) {
+    if (dirty_[link_id] != 0) {
+      return true;
+    }
+  }
+  return operator_pending_ != 0;
+}
+
+/**
+ * @brief Send the values pending for any link in one batch
+ *
+ * @param wt32i
+ * @return size_t Number of lines sent
+ */
+size_t HFPIndicatorManager::flush(WT32i *wt32i) {
+  uint8_t dirty = 0;
+  for (link_id_t link_id = 0; link_id < BT_MAX_LINKS; link_id++) {
+    dirty |= dirty_[link_id];
+    dirty_[link_id] = 0;
+  }
+
+  vector<string> lines;
+  for (int i = 0; i < kHFPIndicatorCount; i++) {
+    if (dirty & (1 << i)) {
+      lines.push_back("STATUS " + WT32i::hfpIndicatorToString(
+                                      static_cast<HFPIndicator>(i)) +
+                      " " + to_string(values_[i]));
+    }
+  }
+  if (operator_pending_) {
+    lines.push_back("+COPS: 0,0,\"BTTRX\"");
+    lines.push_back("OK");
+  }
+  operator_pending_ = 0;
+
+  if (!lines.empty()) {
+    wt32i->sendLines(lines);
+  }
+  return lines.size();
+}
@@ -0,0 +1,56 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#include "wt32i.h"
+
+#include <stdint.h>
+#include <string>
+using namespace std;
+
+/**
+ * @brief Indicators the HFP-AG reports to the HFP devices (e.g. network
+ * service and signal strength). Values are only sent if they changed or a
+ * device connected, all pending values get sent in one batch. What each
+ * link still has to receive is tracked per link, the STATUS lines of the
+ * module apply to all links
+ */
+class HFPIndicatorManager {
+public:
+  void set(HFPIndicator, int8_t);
+  void resend(link_id_t);
+  void acknowledge(link_id_t);
+  void requestOperator(link_id_t);
+  void disconnect(link_id_t);
+  bool pending();
+  size_t flush(WT32i *);
+
+private:
+  int8_t values_[kHFPIndicatorCount] = {};
+  uint8_t valid_ = 0; // Bit per indicator, set once a value is known
+  // Bit per indicator, set until the value is sent to the link
+  uint8_t dirty_[BT_MAX_LINKS] = {};
+  uint8_t connected_ = 0;        // Bit per link
+  uint8_t operator_pending_ = 0; // Bit per link
+  bool isValidLink(link_id_t link_id) {
+    return link_id >= 0 && link_id < BT_MAX_LINKS;
+  }
+};
@@ -0,0 +1,189 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "inquirycache.h"
+#include "splitstring.h"
+
+#include <string.h>
+
+/**
+ * @brief Store an inquiry result. The least recently seen device is replaced
+ * if the table is full
+ *
+ * Expected format, RSSI and name are optional:
+ * INQUIRY_PARTIAL <bd_address> <class_of_device> ["<name>"] [<rssi>]
+ * INQUIRY <bd_address> <class_of_device>
+ *
+ * @param inquiry_result Message from the WT32i
+ * @param now Current time in ms
+ * @return ResultType
+ */
+ResultType InquiryCache::update(string inquiry_result, unsigned long now) {
+  vector<string> splitted_msg = splitString(inquiry_result);
+  uint8_t address[BD_ADDRESS_SIZE];
+  if (splitted_msg.size() < 3 ||
+      PeerList::packAddress(splitted_msg[1], address) != kSuccess ||
+      splitted_msg[2].find_first_not_of("0123456789abcdefABCDEF") !=
+          string::npos) {
+    return kError;
+  }
+
+  InquiryEntry *entry = findEntry(address);
+  if (entry == NULL) {
+    entry = &entries_[0];
+    for (InquiryEntry &candidate : entries_) {
+      if (!candidate.valid) {
+        entry = &candidate;
+        break;
+      }
+      if (candidate.last_seen < entry->last_seen) {
+        entry = &candidate;
+      }
+    }
+    memset(entry, 0, sizeof(InquiryEntry));
+    memcpy(entry->bd_address, address, BD_ADDRESS_SIZE);
+    entry->rssi = INQUIRY_RSSI_UNKNOWN;
+    entry->valid = true;
+  }
+
+  entry->class_of_device = stoul(splitted_msg[2], nullptr, 16);
+  entry->last_seen = now;
+
+  // Optional cached name and RSSI of INQUIRY_PARTIAL
+  vector<string> quoted = splitString(inquiry_result, "\"");
+  if (quoted.size() > 2 && !quoted[1].empty()) {
+    setName(splitted_msg[1], quoted[1]);
+  }
+  string last = splitted_msg.back();
+  if (splitted_msg.size() > 3 && last.find_first_not_of("-0123456789") ==
+                                     string::npos) {
+    int rssi = stoi(last);
+    if (rssi > INQUIRY_RSSI_UNKNOWN && rssi < 128) {
+      entry->rssi = rssi;
+    }
+  }
+  return kSuccess;
+}
+
+/**
+ * @brief Store the friendly name of a device which is already in the table
+ *
+ * @param bd_address
+ * @param name
+ */
+void InquiryCache::setName(string bd_address, string name) {
+  uint8_t address[BD_ADDRESS_SIZE];
+  if (PeerList::packAddress(bd_address, address) != kSuccess) {
+    return;
+  }
+  InquiryEntry *entry = findEntry(address);
+  if (entry != NULL) {
+    strncpy(entry->name, name.c_str(), INQUIRY_NAME_LENGTH - 1);
+    entry->name[INQUIRY_NAME_LENGTH - 1] = '\0';
+  }
+}
+
+/**
+ * @brief Choose the device to connect to among the devices seen since the
+ * given time
+ *
+ * @param seen_since Start of the current inquiry in ms
+ * @param known_peers Devices which were connected before
+ * @return string Address of the device with the best score, empty if there
+ * is no suitable device
+ */
+string InquiryCache::selectBest(unsigned long seen_since,
+                                PeerList *known_peers) {
+  const InquiryEntry *best = NULL;
+  int best_score = 0;
+  for (const InquiryEntry &entry : entries_) {
+    if (!entry.valid || entry.last_seen < seen_since) {
+      continue;
+    }
+    string address = PeerList::unpackAddress(entry.bd_address);
+    int entry_score = score(entry, known_peers->contains(address));
+    if (entry_score > best_score) {
+      best = &entry;
+      best_score = entry_score;
+    }
+  }
+  if (best == NULL) {
+    return "";
+  }
+  return PeerList::unpackAddress(best->bd_address);
+}
+
+/**
+ * @brief Score of a device: known peers first, then audio devices, then the
+ * strongest signal. Devices which are neither known nor audio devices (e.g.
+ * phones) are not considered
+ *
+ * @param entry
+ * @param known_peer True if the device was connected before
+ * @return int Score, 0 if the device is not suitable
+ */
+int InquiryCache::score(const InquiryEntry &entry, bool known_peer) {
+  bool audio =
+      ((entry.class_of_device >> 8) & 0x1F) == COD_MAJOR_CLASS_AUDIO;
+  if (!known_peer && !audio) {
+    return 0;
+  }
+  return (known_peer ? 1024 : 0) + (audio ? 512 : 0) +
+         (entry.rssi - INQUIRY_RSSI_UNKNOWN + 1);
+}
+
+/**
+ * @brief Number of devices in the table
+ *
+ * @return size_t
+ */
+size_t InquiryCache::size() {
+  size_t count = 0;
+  for (const InquiryEntry &entry : entries_) {
+    if (entry.valid) {
+      count++;
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Look up a device
+ *
+ * @param bd_address
+ * @return const InquiryEntry* NULL if the device is not in the table
+ */
+const InquiryEntry *InquiryCache::find(string bd_address) {
+  uint8_t address[BD_ADDRESS_SIZE];
+  if (PeerList::packAddress(bd_address, address) != kSuccess) {
+    return NULL;
+  }
+  return findEntry(address);
+}
+
+InquiryEntry *InquiryCache::findEntry(const uint8_t *address) {
+  for (InquiryEntry &entry : entries_) {
+    if (entry.valid &&
+        memcmp(entry.bd_address, address, BD_ADDRESS_SIZE) == 0) {
+      return &entry;
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,66 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#include "peerlist.h"
+#include "resulttype.h"
+#include "settings.h"
+
+#include <stdint.h>
+#include <string>
+using namespace std;
+
+#define INQUIRY_RSSI_UNKNOWN -128
+#define INQUIRY_NAME_LENGTH 32
+#define COD_MAJOR_CLASS_AUDIO 0x04 // Audio/Video
+
+/**
+ * @brief A device found by inquiry
+ */
+typedef struct {
+  uint8_t bd_address[BD_ADDRESS_SIZE];
+  uint32_t class_of_device;
+  int8_t rssi;
+  char name[INQUIRY_NAME_LENGTH];
+  unsigned long last_seen;
+  bool valid;
+} InquiryEntry;
+
+/**
+ * @brief Fixed size table of inquiry results, keyed by Bluetooth address.
+ * Chooses the device to connect to by a score
+ */
+class InquiryCache {
+public:
+  InquiryCache() {}
+
+  ResultType update(string, unsigned long);
+  void setName(string, string);
+  string selectBest(unsigned long, PeerList *);
+  size_t size();
+  const InquiryEntry *find(string);
+  static int score(const InquiryEntry &, bool);
+
+private:
+  InquiryEntry entries_[INQUIRY_CACHE_SIZE] = {};
+
+  InquiryEntry *findEntry(const uint8_t *);
+};
@@ -0,0 +1,86 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "inquiryscheduler.h"
+
+#include <algorithm>
+
+/**
+ * @brief Set the scheduling policy
+ *
+ * @param duty_cycle Maximum share of radio time used for inquiries (1-100 %)
+ * @param max_interval Maximum interval between inquiries in s
+ */
+void InquiryScheduler::setPolicy(uint16_t duty_cycle, uint16_t max_interval) {
+  duty_cycle_ = std::min<uint16_t>(std::max<uint16_t>(duty_cycle, 1), 100);
+  max_interval_ = max_interval;
+}
+
+/**
+ * @brief Start over with a burst of short inquiries, e.g. after a link loss
+ * or a button press
+ *
+ * @param now
+ */
+void InquiryScheduler::reset(ulong now) {
+  attempts_ = 0;
+  next_start_ = now;
+}
+
+/**
+ * @brief Check if the next inquiry should be started
+ *
+ * @param now
+ * @return bool
+ */
+bool InquiryScheduler::isDue(ulong now) {
+  return (long)(now - next_start_) >= 0;
+}
+
+/**
+ * @brief Register the start of an inquiry and schedule the next one
+ *
+ * @param now
+ * @return uint8_t Duration of the inquiry in units of 1.28 s
+ */
+uint8_t InquiryScheduler::start(ulong now) {
+  bool burst = attempts_ < INQUIRY_BURST_COUNT;
+  uint8_t duration = burst ? INQUIRY_SHORT_DURATION : INQUIRY_DURATION;
+  ulong duration_ms = duration * INQUIRY_UNIT;
+
+  if (burst) {
+    interval_ = INQUIRY_MIN_INTERVAL;
+  } else {
+    // Exponential backoff, bounded by the maximum interval
+    int exponent = std::min(attempts_ - INQUIRY_BURST_COUNT + 1, 16);
+    interval_ = std::min((ulong)INQUIRY_MIN_INTERVAL << exponent,
+                         (ulong)max_interval_ * 1000);
+    // ... but never more radio time than the budget allows
+    interval_ = std::max(interval_, duration_ms * 100 / duty_cycle_);
+  }
+  interval_ = std::max(interval_, duration_ms);
+
+  if (attempts_ < UINT16_MAX) {
+    attempts_++;
+  }
+  next_start_ = now + interval_;
+  radio_time_ += duration_ms;
+  return duration;
+}
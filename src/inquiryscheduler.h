@@ -0,0 +1,58 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+#include "arduino-mock/Arduino.h"
+#endif
+
+#include "settings.h"
+
+/**
+ * @brief Decides when to start the next inquiry and how long it runs.
+ * After a reset (link loss, button press) a burst of short inquiries is
+ * started, then the interval backs off exponentially up to the configured
+ * maximum. Outside of the burst, the radio time never exceeds the duty cycle
+ * budget
+ */
+class InquiryScheduler {
+public:
+  InquiryScheduler() {}
+
+  void setPolicy(uint16_t, uint16_t);
+  void reset(ulong);
+  bool isDue(ulong);
+  uint8_t start(ulong);
+
+  ulong getInterval() { return interval_; };
+  ulong getRadioTime() { return radio_time_; };
+
+private:
+  uint16_t duty_cycle_ = INQUIRY_DEFAULT_DUTY_CYCLE;     // percent
+  uint16_t max_interval_ = INQUIRY_DEFAULT_MAX_INTERVAL; // s
+
+  uint16_t attempts_ = 0;
+  ulong next_start_ = 0;
+  ulong interval_ = 0;
+  ulong radio_time_ = 0; // ms, sum of all inquiry durations
+};
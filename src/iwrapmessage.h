@@ -31,6 +31,7 @@ enum iWrapMessageType {
   kSETTING_CONTROL_GAIN,
   kSETTING_PIN_CODE,
   kSETTING_UNKNOWN,
+  kSETTING_DUMP_END,
   kLIST_RESULT,
   kINQUIRY_RESULT,
   kNAME_RESULT,
@@ -42,7 +43,16 @@ enum iWrapMessageType {
   kHFPAG_UNKOWN,
   kNOCARRIER_ERROR_LINK_LOSS,
   kNOCARRIER_ERROR_CALL_ENDED,
-  kSSP_CONFIRM
+  kSSP_CONFIRM,
+  kHFP_STATUS,
+  kCALL_RESULT,
+  kINQUIRY_PARTIAL,
+  kINQUIRY_FINISHED,
+  kINQUIRY_ERROR,
+  kBOOT_BANNER,
+  kBOOT_READY,
+  kSCO_CONNECT,
+  kOK
 };
 
 /**
@@ -52,4 +62,5 @@ enum iWrapMessageType {
 typedef struct {
   iWrapMessageType msg_type = kEmpty;
   std::string msg;
+  int link_id = -1; // Link the message refers to, -1 if none
 } iWrapMessage;
@@ -0,0 +1,102 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "levelmeter.h"
+
+#include <math.h>
+
+/**
+ * @brief Integer square root, one result per block only
+ */
+static uint32_t squareRoot(uint64_t value) {
+  uint64_t root = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+  while (bit > value) {
+    bit >>= 2;
+  }
+  while (bit != 0) {
+    if (value >= root + bit) {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+/**
+ * @brief Feed one sample, called by the sampling task only
+ *
+ * @param sample signed, bias removed, at most 12 bit
+ */
+void LevelMeter::process(int32_t sample) {
+  uint16_t magnitude = sample < 0 ? -sample : sample;
+  if (magnitude > block_peak_) {
+    block_peak_ = magnitude;
+  }
+  block_energy_ += (uint32_t)(sample * sample);
+  if (++block_samples_ < LEVEL_METER_BLOCK_SIZE) {
+    return;
+  }
+
+  rms_ = squareRoot(block_energy_ / block_samples_);
+  uint16_t peak = peak_;
+  while (block_peak_ > peak &&
+         !peak_.compare_exchange_weak(peak, block_peak_)) {
+  }
+  block_peak_ = 0;
+  block_energy_ = 0;
+  block_samples_ = 0;
+}
+
+/**
+ * @brief Highest peak since the previous call, so no peak is missed however
+ * rarely the level is read
+ *
+ * @return uint16_t ADC counts
+ */
+uint16_t LevelMeter::readPeak() { return peak_.exchange(0); }
+
+/**
+ * @brief Convert a level to dB below full scale of the ADC
+ *
+ * @param level ADC counts
+ * @return int16_t dBFS, LEVEL_METER_FLOOR at most
+ */
+int16_t LevelMeter::toDBFS(uint16_t level) {
+  if (level == 0) {
+    return LEVEL_METER_FLOOR;
+  }
+  int16_t dbfs = lround(20 * log10(level / 2048.0));
+  return dbfs < LEVEL_METER_FLOOR ? LEVEL_METER_FLOOR : dbfs;
+}
+
+/**
+ * @brief Level for the web interface
+ *
+ * @param peak ADC counts
+ * @param rms ADC counts
+ * @return string "peak,rms" in dBFS, e.g. "-6,-9"
+ */
+string LevelMeter::formatLevel(uint16_t peak, uint16_t rms) {
+  return to_string(toDBFS(peak)) + "," + to_string(toDBFS(rms));
+}
@@ -0,0 +1,53 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#include "settings.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+using namespace std;
+
+/**
+ * @brief Peak and RMS level of the audio to the TRX, sampled on PIN_VOX_IN
+ * after the DAC gain. Samples are summed up on the sampling task, only one
+ * result per LEVEL_METER_BLOCK_SIZE samples is handed to the main loop
+ */
+class LevelMeter {
+public:
+  void process(int32_t);
+
+  uint16_t readPeak();
+  uint16_t getRMS() { return rms_; };
+
+  static int16_t toDBFS(uint16_t);
+  static string formatLevel(uint16_t, uint16_t);
+
+private:
+  // Current block, only accessed by the sampling task
+  uint16_t block_peak_ = 0;
+  uint64_t block_energy_ = 0;
+  uint16_t block_samples_ = 0;
+
+  std::atomic<uint16_t> peak_{0}; // ADC counts, highest since readPeak()
+  std::atomic<uint16_t> rms_{0};  // ADC counts of the last block
+};
@@ -0,0 +1,102 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "logger.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+Logger logger;
+
+/**
+ * @brief Set the debug Stream. On the target, the task writing the messages
+ * is started
+ *
+ * @param stream
+ */
+void Logger::begin(Stream *stream) {
+  stream_ = stream;
+#ifdef ARDUINO
+  xTaskCreate(drainTask, "logger", LOG_TASK_STACK_SIZE, this,
+              LOG_TASK_PRIORITY, NULL);
+#endif
+}
+
+/**
+ * @brief Queue a message, only waits for other tasks logging at the same
+ * time. If the queue is full, the message is dropped and counted
+ *
+ * @param level LOG_LEVEL_*
+ * @param format printf format string, followed by its arguments
+ */
+void Logger::log(uint8_t level, const char *format, ...) {
+  if (stream_ == NULL) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(producer_mutex_);
+  LogEntry *entry = queue_.reserve();
+  if (entry == NULL) {
+    dropped_++;
+    return;
+  }
+  entry->level = level;
+  va_list args;
+  va_start(args, format);
+  vsnprintf(entry->text, sizeof(entry->text), format, args);
+  va_end(args);
+  queue_.commit();
+  logged_++;
+}
+
+/**
+ * @brief Write queued messages to the debug Stream
+ *
+ * @param max_messages Upper limit of messages written by this call
+ * @return size_t Number of messages written
+ */
+size_t Logger::drain(size_t max_messages) {
+  size_t written = 0;
+  const LogEntry *entry;
+  while (written < max_messages && (entry = queue_.peek()) != NULL) {
+    stream_->println(entry->text);
+    queue_.release();
+    written++;
+  }
+
+  uint32_t dropped = dropped_;
+  if (dropped != dropped_reported_) {
+    char text[48];
+    snprintf(text, sizeof(text), "WARNING: %u log messages dropped",
+             (unsigned int)(dropped - dropped_reported_));
+    stream_->println(text);
+    dropped_reported_ = dropped;
+  }
+  return written;
+}
+
+#ifdef ARDUINO
+void Logger::drainTask(void *parameter) {
+  Logger *self = static_cast<Logger *>(parameter);
+  while (true) {
+    self->drain();
+    vTaskDelay(LOG_DRAIN_INTERVAL / portTICK_PERIOD_MS);
+  }
+}
+#endif
@@ -0,0 +1,98 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "arduino-mock/Serial.h"
+#endif
+
+#include "settings.h"
+#include "spscqueue.h"
+
+#include <mutex>
+#include <stdint.h>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+// Messages above LOG_LEVEL are removed at compile time, incl. their
+// arguments
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logger.log(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARNING
+#define LOG_WARNING(...) logger.log(LOG_LEVEL_WARNING, __VA_ARGS__)
+#else
+#define LOG_WARNING(...) ((void)0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) logger.log(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logger.log(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+typedef struct {
+  uint8_t level;
+  char text[LOG_LINE_LENGTH];
+} LogEntry;
+
+/**
+ * @brief Debug output decoupled from the caller: messages are formatted into
+ * a ring buffer and written to the debug Stream by a low priority task.
+ * Any task may log (main loop, web server, BLE), producers are serialized by
+ * a mutex. The drain task is the single consumer.
+ */
+class Logger {
+public:
+  void begin(Stream *);
+  void log(uint8_t, const char *, ...)
+      __attribute__((format(printf, 3, 4)));
+  size_t drain(size_t = LOG_QUEUE_SIZE);
+
+  uint32_t getLogged() { return logged_; };
+  uint32_t getDropped() { return dropped_; };
+
+private:
+  Stream *stream_ = NULL;
+  SPSCQueue<LogEntry, LOG_QUEUE_SIZE + 1> queue_;
+  std::mutex producer_mutex_; // The queue takes a single producer at a time
+  std::atomic<uint32_t> logged_{0};
+  std::atomic<uint32_t> dropped_{0};
+  uint32_t dropped_reported_ = 0;
+
+#ifdef ARDUINO
+  static void drainTask(void *);
+#endif
+};
+
+extern Logger logger;
@@ -24,6 +24,8 @@ Contact: bt-trx.com, mail@bt-trx.com
 #include "settings.h"
 
 #include "bttrx_fsm.h"
+#include "coexstats.h"
+#include "logger.h"
 
 #ifdef ARDUINO
 #include "bttrx_ble.h"
@@ -42,6 +44,8 @@ BTTRX_FSM bttrx_fsm;
 BTTRX_WIFI bttrx_wifi;
 BTTRX_BLE bttrx_ble;
 BTTRX_DISPLAY bttrx_display;
+CoexStats coex_stats;
+ulong coex_stats_time_ = 0;
 bool wifi_started_ = false;
 String hardwareVersion = " unknown";
 
@@ -50,7 +54,10 @@ void checkForWifiStart() {
   ulong startTime = millis();
   while (!digitalRead(PIN_BTN_0)) {
     if (startTime + BTN_PRESS_WIFI_MODE_TIMEOUT < millis()) {
-      bttrx_wifi.setup(&(bttrx_fsm.bttrx_control_));
+      uint32_t free_heap = ESP.getFreeHeap();
+      bttrx_wifi.setup(&(bttrx_fsm.bttrx_control_), &coex_stats);
+      coex_stats.stackStarted(kCoexWiFi, free_heap, ESP.getFreeHeap());
+      bttrx_fsm.startAudio(); // Level meter of the web interface
       wifi_started_ = true;
       break;
     }
@@ -66,6 +73,18 @@ void checkForWifiStart() {
 #endif
 }
 
+/**
+ * @brief Reopen the UART to the WT32i after the module changed its rate
+ */
+void setBTBaudRate(uint32_t baud_rate) {
+  SERIAL_BT.flush(); // "SET CONTROL BAUD" still has to go out
+#ifdef ESP32
+  SERIAL_BT.updateBaudRate(baud_rate);
+#else
+  SERIAL_BT.begin(baud_rate);
+#endif
+}
+
 void setupPins() {
   // Set up GPIOs
   pinMode(PIN_BTN_0, INPUT);
@@ -112,6 +131,7 @@ void setup() {
   // Set up Serial ports
   SERIAL_DBG.begin(SERIAL_DBG_RATE);
   SERIAL_DBG.setTimeout(SERIAL_TIMEOUT);
+  SERIAL_BT.setRxBufferSize(UART_RX_BUFFER_SIZE);
   SERIAL_BT.begin(SERIAL_BT_RATE);
   SERIAL_BT.setTimeout(SERIAL_TIMEOUT);
 
@@ -121,7 +141,10 @@ void setup() {
     ;
 #endif
 
+  logger.begin(&SERIAL_DBG);
   bttrx_fsm.setSerial(&SERIAL_BT, &SERIAL_DBG);
+  bttrx_fsm.setBaudRateCallback(setBTBaudRate);
+  bttrx_fsm.startUARTReader(&SERIAL_BT);
 
   // Print version information
   getHardwareVersion();
@@ -141,16 +164,27 @@ void setup() {
   // Check whether to start Wifi
   checkForWifiStart();
 
-  // Start BLE
-  // Currently, BLE can't run simultaneously with Wifi
-  // (Wifi does not serve pages then)
-  // TODO investigate if this is a resource issue
-  if (!wifi_started_) {
-    bttrx_ble.setupBLE(bttrx_fsm.getBLEButtonHandler());
+  // Start BLE, next to WiFi as long as the heap allows for both stacks
+  uint32_t free_heap = ESP.getFreeHeap();
+  if (free_heap < BLE_HEAP_BUDGET) {
+    LOG_WARNING("WARNING: BLE not started, %u bytes free", (unsigned)free_heap);
+  } else {
+    bttrx_ble.setupBLE(bttrx_fsm.getBLEButtonHandler(),
+                       &(bttrx_fsm.bttrx_control_));
+    coex_stats.stackStarted(kCoexBLE, free_heap, ESP.getFreeHeap());
   }
 }
 
 void loop() {
   bttrx_fsm.run();
+  bttrx_ble.setHFPBusy(bttrx_fsm.getConnectedLinkCount() > 0);
+  bttrx_ble.setWebBusy(coex_stats.isWebBusy(millis()));
   bttrx_ble.run();
+
+  if (millis() - coex_stats_time_ >= COEX_STATS_INTERVAL) {
+    coex_stats_time_ = millis();
+    bttrx_fsm.bttrx_control_.storeSetting(
+        kCoexStats,
+        coex_stats.getStats(ESP.getFreeHeap(), ESP.getMinFreeHeap()));
+  }
 }
@@ -0,0 +1,139 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "peerlist.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define PEER_LIST_KEY "bt_peers"
+
+PeerList::PeerList(Preferences *preferences) : preferences_(preferences) {}
+
+/**
+ * @brief Read the list from the preferences
+ */
+void PeerList::load() {
+  size_t length =
+      preferences_->getBytes(PEER_LIST_KEY, peers_, sizeof(peers_));
+  size_ = length / BD_ADDRESS_SIZE;
+  if (size_ > PEER_LIST_SIZE) {
+    size_ = PEER_LIST_SIZE;
+  }
+}
+
+/**
+ * @brief Mark a device as most recently used. The preferences are only
+ * written if the order of the list changes
+ *
+ * @param bd_address Bluetooth address, e.g. "00:07:80:12:34:56"
+ */
+void PeerList::touch(string bd_address) {
+  uint8_t address[BD_ADDRESS_SIZE];
+  if (packAddress(bd_address, address) != kSuccess) {
+    return;
+  }
+
+  int index = find(address);
+  if (index == 0) {
+    return; // Already most recently used
+  }
+  if (index < 0) {
+    // New device, drop the least recently used one if the list is full
+    index = size_ < PEER_LIST_SIZE ? size_++ : PEER_LIST_SIZE - 1;
+  }
+  memmove(peers_[1], peers_[0], index * BD_ADDRESS_SIZE);
+  memcpy(peers_[0], address, BD_ADDRESS_SIZE);
+  store();
+}
+
+/**
+ * @brief Check if a device is in the list
+ *
+ * @param bd_address
+ * @return bool
+ */
+bool PeerList::contains(string bd_address) {
+  uint8_t address[BD_ADDRESS_SIZE];
+  return packAddress(bd_address, address) == kSuccess && find(address) >= 0;
+}
+
+/**
+ * @brief Return the address of an entry, 0 is the most recently used one
+ *
+ * @param index
+ * @return string Empty if the index is out of range
+ */
+string PeerList::at(size_t index) {
+  if (index >= size_) {
+    return "";
+  }
+  return unpackAddress(peers_[index]);
+}
+
+/**
+ * @brief Convert a Bluetooth address to 6 bytes
+ *
+ * @param bd_address Bluetooth address, e.g. "00:07:80:12:34:56"
+ * @param packed output: 6 bytes
+ * @return ResultType
+ */
+ResultType PeerList::packAddress(string bd_address, uint8_t *packed) {
+  if (bd_address.length() != 3 * BD_ADDRESS_SIZE - 1) {
+    return kError;
+  }
+  for (int i = 0; i < BD_ADDRESS_SIZE; i++) {
+    if (i > 0 && bd_address[3 * i - 1] != ':') {
+      return kError;
+    }
+    string byte = bd_address.substr(3 * i, 2);
+    if (byte.find_first_not_of("0123456789abcdefABCDEF") != string::npos) {
+      return kError;
+    }
+    packed[i] = stoul(byte, nullptr, 16);
+  }
+  return kSuccess;
+}
+
+/**
+ * @brief Convert 6 bytes to a Bluetooth address as reported by iWrap
+ *
+ * @param packed 6 bytes
+ * @return string e.g. "00:07:80:12:34:56"
+ */
+string PeerList::unpackAddress(const uint8_t *packed) {
+  char address[3 * BD_ADDRESS_SIZE];
+  snprintf(address, sizeof(address), "%02x:%02x:%02x:%02x:%02x:%02x",
+           packed[0], packed[1], packed[2], packed[3], packed[4], packed[5]);
+  return address;
+}
+
+int PeerList::find(const uint8_t *address) {
+  for (size_t i = 0; i < size_; i++) {
+    if (memcmp(peers_[i], address, BD_ADDRESS_SIZE) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void PeerList::store() {
+  preferences_->putBytes(PEER_LIST_KEY, peers_, size_ * BD_ADDRESS_SIZE);
+}
@@ -0,0 +1,62 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#include "resulttype.h"
+#include "settings.h"
+
+#include <stdint.h>
+#include <string>
+using namespace std;
+
+#ifdef ARDUINO
+#include "Preferences.h"
+#else
+#include "../test/esp32_mock/Preferences.h"
+#endif
+
+#define BD_ADDRESS_SIZE 6 // Bytes of a packed Bluetooth address
+
+/**
+ * @brief Most recently used list of HFP devices, persisted as packed
+ * addresses in the preferences
+ */
+class PeerList {
+public:
+  PeerList(Preferences *);
+
+  void load();
+  void touch(string);
+  bool contains(string);
+  size_t size() { return size_; };
+  string at(size_t);
+
+  static ResultType packAddress(string, uint8_t *);
+  static string unpackAddress(const uint8_t *);
+
+private:
+  Preferences *preferences_;
+  uint8_t peers_[PEER_LIST_SIZE][BD_ADDRESS_SIZE] = {};
+  size_t size_ = 0;
+
+  int find(const uint8_t *);
+  void store();
+};
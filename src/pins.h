@@ -39,6 +39,7 @@ Contact: bt-trx.com, mail@bt-trx.com
 #define PIN_WT32_TX 17   // Serial2 Tx
 #define PIN_HW_VER 34    // ADC1 CH6
 #define PIN_VOX_IN 35    // ADC1 CH7
+#define ADC_CHANNEL_VOX_IN ADC1_CHANNEL_7 // PIN_VOX_IN
 #define SERIAL_DBG Serial
 #define SERIAL_BT Serial2 // Default: RX: 16, TX: 17, RTS: 7, CTS: 8
 #endif
@@ -19,7 +19,9 @@ Contact: bt-trx.com, mail@bt-trx.com
 */
 
 #include "serialwrapper.h"
+#include "logger.h"
 #include "splitstring.h"
+#include <string.h>
 #include <vector>
 
 SerialWrapper::SerialWrapper(Stream *serial_bt, Stream *serial_dbg)
@@ -31,55 +33,115 @@ void SerialWrapper::setSerialStreams(Stream *serial_bt, Stream *serial_dbg) {
 }
 
 /**
- * @brief Passing through the println command to the wrapped Stream.
- * Printing also to debug Stream, if defined.
+ * @brief Take received lines from a UARTReader instead of reading the Stream
+ *
+ * @param reader NULL to read the Stream directly
+ */
+void SerialWrapper::setReader(UARTReader *reader) { reader_ = reader; }
+
+/**
+ * @brief Send a line to the Bluetooth module. The line and its CRLF are
+ * written at once, or collected until endBatch() if a batch is open.
+ * If a debug Stream is set, a copy is logged after the write. Waits while
+ * another task has a batch open.
  *
  * @param _string String to write to the Stream
- * @return Bytes written to the Stream
+ * @return Bytes written to the Stream, 0 if collected in a batch
  */
 size_t SerialWrapper::println(const char *_string) {
-  if (serial_dbg_ != NULL) {
-    string dbg_output = "> ";
-    dbg_output += string(_string);
-    serial_dbg_->println(dbg_output.c_str());
+  std::lock_guard<std::recursive_mutex> lock(tx_mutex_);
+  size_t length = strlen(_string);
+  if (tx_length_ + length + 2 >= sizeof(tx_buffer_)) {
+    flush();
+  }
+  if (length + 2 >= sizeof(tx_buffer_)) {
+    // Too long for the buffer, pass through
+    size_t written = serial_bt_->println(_string);
+    if (serial_dbg_ != NULL) {
+      LOG_DEBUG("> %s", _string);
+    }
+    return written;
   }
-  return serial_bt_->println(_string);
+  memcpy(tx_buffer_ + tx_length_, _string, length);
+  tx_length_ += length;
+  tx_buffer_[tx_length_++] = '\r';
+  tx_buffer_[tx_length_++] = '\n';
+  tx_buffer_[tx_length_] = '\0';
+
+  if (batching_) {
+    return 0;
+  }
+  return flush();
 }
 
 /**
- * @brief Passing through the println command to the wrapped Stream.
- * Printing also to debug Stream, if defined.
+ * @brief Send a line to the Bluetooth module, see println(const char *)
  *
  * @param _string String to write to the Stream
  * @return Bytes written to the Stream
  */
 size_t SerialWrapper::println(string _string) {
+  return println(_string.c_str());
+}
+
+/**
+ * @brief Collect the following lines and send them with one write
+ * Example: "+CREG: 1,1" and "OK" as answer to an AT command. Lines of other
+ * tasks wait until endBatch()
+ */
+void SerialWrapper::beginBatch() {
+  tx_mutex_.lock();
+  batching_ = true;
+}
+
+/**
+ * @brief Send all lines collected since beginBatch()
+ */
+void SerialWrapper::endBatch() {
+  batching_ = false;
+  flush();
+  tx_mutex_.unlock();
+}
+
+size_t SerialWrapper::flush() {
+  if (tx_length_ == 0) {
+    return 0;
+  }
+  size_t written = serial_bt_->print(tx_buffer_);
   if (serial_dbg_ != NULL) {
-    string dbg_output = "> ";
-    dbg_output += string(_string);
-    serial_dbg_->println(dbg_output.c_str());
+    // Log each line, prefixed with "> "
+    char *line = tx_buffer_;
+    char *end;
+    while ((end = strstr(line, "\r\n")) != NULL) {
+      *end = '\0';
+      LOG_DEBUG("> %s", line);
+      line = end + 2;
+    }
   }
-  return serial_bt_->println(_string.c_str());
+  tx_length_ = 0;
+  return written;
 }
 
 /**
- * @brief Prints to the debug Stream
+ * @brief Log a message, see LOG_INFO(). The LOG_* macros avoid building
+ * strings for messages of disabled levels
  *
  * @param _string
  * @return size_t
  */
 size_t SerialWrapper::dbg_println(const char *_string) {
-  return serial_dbg_->println(_string);
+  LOG_INFO("%s", _string);
+  return strlen(_string);
 }
 
 /**
- * @brief Prints to the debug Stream
+ * @brief Log a message, see dbg_println(const char *)
  *
  * @param _string
  * @return size_t
  */
 size_t SerialWrapper::dbg_println(string _string) {
-  return serial_dbg_->println(_string.c_str());
+  return dbg_println(_string.c_str());
 }
 
 /**
@@ -88,6 +150,8 @@ size_t SerialWrapper::dbg_println(string _string) {
  *
  * Example: Expectation "foo" matches line "foo bar", but does match "foobar".
  * In case of a match, the whole line is written to the output parameter.
+ * Other lines are kept for readLineToString(), e.g. events of the module
+ * received in between.
  *
  * @param expectation Expected word at the beginning of the read line
  * @param output Output parameter to write the matching line to
@@ -100,7 +164,7 @@ ResultType SerialWrapper::waitForInputBlocking(string expectation,
   ulong start_time = millis();
 
   while (millis() < (start_time + timeout)) {
-    string input = readLineToString();
+    string input = readReceivedLine();
     if (!input.empty()) {
       string first_element = splitString(input)[0];
 
@@ -110,20 +174,49 @@ ResultType SerialWrapper::waitForInputBlocking(string expectation,
         }
         return ResultType::kSuccess;
       }
+      if (deferred_lines_.size() >= UART_QUEUE_SIZE) {
+        LOG_WARNING("WARNING: line from WT32i dropped: %s",
+                    deferred_lines_.front().c_str());
+        deferred_lines_.pop_front();
+      }
+      deferred_lines_.push_back(input);
     }
   }
   return ResultType::kTimeoutError;
 }
 
+/**
+ * @brief Reading a line from the Stream. Lines kept by waitForInputBlocking()
+ * come first, see readReceivedLine()
+ *
+ * @return Line as a string
+ */
+string SerialWrapper::readLineToString() {
+  if (!deferred_lines_.empty()) {
+    string output = deferred_lines_.front();
+    deferred_lines_.pop_front();
+    return output;
+  }
+  return readReceivedLine();
+}
+
 /**
  * @brief Reading a line from the Stream. A line is defined with the
  * SERIAL_DELIMITER line ending. Maximum SERIAL_MAX_LINE_LENGTH chars are read.
+ * With a UARTReader set, the next queued line is taken without waiting.
  * If defined, the line is output to the debug Stream.
  *
  * @return Line as a string
  */
-string SerialWrapper::readLineToString() {
+string SerialWrapper::readReceivedLine() {
   string output = "";
+  if (reader_ != NULL) {
+    if (reader_->readLine(&output) && serial_dbg_ != NULL) {
+      LOG_DEBUG("< %s", output.c_str());
+    }
+    return output;
+  }
+
   char buffer[SERIAL_MAX_LINE_LENGTH + 1] = "";
   if (serial_bt_->readBytesUntil(SERIAL_DELIMITER, buffer,
                                  SERIAL_MAX_LINE_LENGTH)) {
@@ -135,7 +228,7 @@ string SerialWrapper::readLineToString() {
     }
 
     if (serial_dbg_ != NULL) {
-      serial_dbg_->println(string("< " + output).c_str());
+      LOG_DEBUG("< %s", output.c_str());
     }
   }
 
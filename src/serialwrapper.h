@@ -29,7 +29,10 @@ Contact: bt-trx.com, mail@bt-trx.com
 
 #include "resulttype.h"
 #include "settings.h"
+#include "uartreader.h"
 
+#include <deque>
+#include <mutex>
 #include <string>
 using namespace std;
 
@@ -43,6 +46,8 @@ public:
   virtual ResultType waitForInputBlocking(string, string * = NULL,
                                           uint32_t = BT_SERIAL_TIMEOUT) = 0;
   virtual string readLineToString() = 0;
+  virtual void beginBatch() = 0;
+  virtual void endBatch() = 0;
 };
 
 class SerialWrapper : public SerialWrapperInterface {
@@ -52,6 +57,7 @@ public:
   ~SerialWrapper(){};
 
   void setSerialStreams(Stream *, Stream *);
+  void setReader(UARTReader *);
 
   size_t println(const char *);
   size_t println(string);
@@ -62,7 +68,25 @@ public:
                                   uint32_t timeout = BT_SERIAL_TIMEOUT);
   string readLineToString();
 
+  void beginBatch();
+  void endBatch();
+
 private:
   Stream *serial_bt_ = NULL;
   Stream *serial_dbg_ = NULL;
+  UARTReader *reader_ = NULL;
+
+  // Lines skipped by waitForInputBlocking(), returned by readLineToString()
+  // before new ones, at most UART_QUEUE_SIZE
+  deque<string> deferred_lines_;
+  string readReceivedLine();
+
+  // Lines to the Bluetooth module incl. CRLF, sent with a single write.
+  // The main loop and the web server task both send commands, the mutex is
+  // held from beginBatch() to endBatch()
+  std::recursive_mutex tx_mutex_;
+  char tx_buffer_[SERIAL_TX_BUFFER_SIZE];
+  size_t tx_length_ = 0;
+  bool batching_ = false;
+  size_t flush();
 };
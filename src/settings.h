@@ -23,25 +23,110 @@ Contact: bt-trx.com, mail@bt-trx.com
 #include "pins.h"
 
 #define SERIAL_DBG_RATE 115200
-#define SERIAL_BT_RATE 115200
+#define SERIAL_BT_RATE 115200 // Rate of the WT32i after a factory reset
+#define SERIAL_BT_FAST_RATE 921600 // Rate negotiated after boot, 0: disabled
+#define SERIAL_BT_PROBE_RATE 921600 // Stored rate tried if the fast rate is 0
 #define SERIAL_TIMEOUT 10 // ms  // serial readline timeout
 #define SERIAL_DELIMITER '\n'
 #define SERIAL_MAX_LINE_LENGTH 110
+#define SERIAL_TX_BUFFER_SIZE 256 // Bytes of commands coalesced into one write
+#define UART_QUEUE_SIZE 64 // Lines buffered, fits a SET dump or inquiry
+#define UART_RX_BUFFER_SIZE 2048 // Bytes, held by the driver if queue is full
+#define UART_POLL_INTERVAL 1 // ms  // 92 bytes at 921600 baud
+#define UART_TASK_STACK_SIZE 2048 // Bytes
+#define UART_TASK_PRIORITY 5 // Above the main loop
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 4 // 0: off, 1: error, 2: warning, 3: info, 4: debug
+#endif
+#define LOG_QUEUE_SIZE 32 // Number of debug messages buffered
+#define LOG_LINE_LENGTH 120 // Bytes per debug message, longer ones are cut
+#define LOG_DRAIN_INTERVAL 20 // ms
+#define LOG_TASK_STACK_SIZE 2048 // Bytes
+#define LOG_TASK_PRIORITY 1 // Just above idle
 #define BT_SERIAL_TIMEOUT 100 // ms  // Time to wait for answers from BT module
+#define BT_RESET_PULSE 5 // ms  // Time PIN_BT_RESET is held low
+#define BT_READY_TIMEOUT 3000 // ms  // Time to wait for the boot banner
+#define BT_PROBE_TIMEOUT 2000 // ms  // Time to wait for "OK" to "AT"
+#define BT_MAX_LINKS 8 // Number of iWrap link ids tracked (0..7)
+#define WT32I_CONFIG_SIZE 12 // Number of WT32i settings enforced on boot
+#define CONFIG_READ_TIMEOUT 2000 // ms  // Time to wait for the "SET" dump
+#define PEER_LIST_SIZE 4 // Number of recently used HFP devices to remember
+#define HFP_COPS_INTERVAL 10000 // ms  // +COPS resend for iWrap before 6.2
+#define PAGE_TIMEOUT 2500 // ms  // Time to wait for a known device to answer
+#define RECOVERY_RETRY_INTERVAL 500 // ms  // Pause between pages of lost device
+#define RECOVERY_DEFAULT_WINDOW 30 // s
 
-#define INQUIRY_DURATION "5" // *1.28s
+#define INQUIRY_UNIT 1280 // ms  // Inquiry duration unit of iWrap
+#define INQUIRY_DURATION 5 // *1.28s
+#define INQUIRY_TIMEOUT_MARGIN 3000 // ms  // Results are late, give up
+#define INQUIRY_SHORT_DURATION 2 // *1.28s  // Used for the burst after a reset
+#define INQUIRY_BURST_COUNT 3 // Number of short inquiries after a reset
+#define INQUIRY_MIN_INTERVAL 5000 // ms
+#define INQUIRY_DEFAULT_DUTY_CYCLE 10 // %
+#define INQUIRY_DEFAULT_MAX_INTERVAL 60 // s
+#define INQUIRY_CACHE_SIZE 16 // Number of inquired devices to remember
 #define BLE_SCAN_DURATION 1  // s
 #define BLE_SCAN_INTERVAL 5  // s
+#define BLE_NEW_BUTTON_WINDOW 60 // s after boot, search next to a connected one
+#define BLE_SCAN_BUSY_BACKOFF 4 // Scans are rarer while an HFP link is up
+#define BLE_SCAN_WINDOW_IDLE 50 // ms  // Controller listens this long ...
+#define BLE_SCAN_CYCLE_IDLE 100 // ms  // ... every cycle
+#define BLE_SCAN_WINDOW_BUSY 30 // ms  // Leave air time to HFP
+#define BLE_SCAN_CYCLE_BUSY 320 // ms
+#define BLE_MAX_BUTTONS 2 // BLE PTT buttons connected at the same time
+#define BLE_BUTTON_ADDRESS_KEY "ble_button" // Preferences key, +index
+#define BLE_RECONNECT_INTERVAL 1000 // ms  // Between direct connection tries
+#define BLE_RECONNECT_SCAN_AFTER 10 // Failed tries before scanning once
+#define BLE_EVENT_QUEUE_SIZE 8 // Connection steps buffered for the main loop
+#define BLE_BUTTON_QUEUE_SIZE 8 // Button edges buffered for the main loop
+#define BLE_TASK_STACK_SIZE 4096 // Bytes
+#define BLE_TASK_PRIORITY 1 // Same as the main loop
 
 #define BTN_PRESS_WIFI_MODE_TIMEOUT 5000 // ms
 
 #define WIFI_HOSTNAME "bt-trx"
 #define WIFI_SSID_PREFIX "bt-trx"
 #define WIFI_PASSWORD "bt-trx73" // minimum 8 chars
+#define WIFI_TRAFFIC_HOLD 2000 // ms  // Web interface counts as busy this long
+#define BLE_HEAP_BUDGET 40000 // Bytes  // Free heap BLE needs next to WiFi
+#define COEX_STATS_INTERVAL 1000 // ms
 
 #define BD_ADDR_OUI_ANYTONE "00:1b:10" // Anytone Bluetooth PTT BP-01
 
 #define PTT_TIMEOUT_WILLIMODE 1000 // ms
+#define VOX_SAMPLE_RATE 8000 // Hz
+#define VOX_BLOCK_SIZE 32 // Samples per DMA block, 4 ms at 8 kHz
+#define VOX_DC_SHIFT 10 // Bias tracking, time constant 2^10 samples
+#define VOX_ATTACK_SHIFT 2 // Envelope rise, time constant 2^2 samples
+#define VOX_RELEASE_SHIFT 7 // Envelope decay, time constant 2^7 samples
+#define VOX_DEFAULT_THRESHOLD 200 // ADC counts of the envelope
+#define VOX_DEFAULT_HANG_TIME 500 // ms
+#define VOX_TASK_STACK_SIZE 2048 // Bytes
+#define VOX_TASK_PRIORITY 4 // Above the main loop, below the UART reader
+#define DTMF_BLOCK_SIZE 205 // Samples, 25.6 ms, bins 39 Hz apart
+#define DTMF_MIN_LEVEL 40 // ADC counts (RMS) of a digit
+#define DTMF_MIN_ENERGY 70 // % of the block energy in both tones
+#define DTMF_MAX_TWIST 6 // Power ratio of the tones, about 8 dB
+#define DTMF_QUEUE_SIZE 16 // Digits buffered for the main loop
+#define DTMF_COMMAND_LENGTH 8 // Digits between "*" and "#"
+#define DTMF_HANGUP_COMMAND "*73" // Followed by "#"
+#define CTCSS_TONE_COUNT 38
+#define CTCSS_DECIMATION 16 // 500 Hz after decimation
+#define CTCSS_BLOCK_SIZE 200 // Decimated samples, 400 ms, bins 2.5 Hz apart
+#define CTCSS_MIN_LEVEL 20 // ADC counts (amplitude) of a sub-tone
+#define CTCSS_MIN_ENERGY 50 // % of the energy below the voice band
+#define LEVEL_METER_BLOCK_SIZE 400 // Samples, 50 ms
+#define LEVEL_METER_FLOOR -60 // dBFS, reported for silence
+#define LEVEL_METER_INTERVAL 250 // ms  // Level published to the web UI
+#define GAIN_MAX 22 // Highest step of "SET CONTROL GAIN", 3 dB apart
+#define GAIN_CALIBRATION_TARGET -6 // dBFS  // Peak level, leaves headroom
+#define GAIN_CALIBRATION_MIN_LEVEL -40 // dBFS  // Below: no signal
+#define GAIN_CALIBRATION_TOLERANCE 1 // dB  // Close enough, stop searching
+#define GAIN_CALIBRATION_CLIP 2000 // ADC counts of a clipping peak
+#define GAIN_CALIBRATION_SETTLE 100 // ms  // Ignored after a gain change
+#define GAIN_CALIBRATION_MEASURE 500 // ms  // Peak measured per gain
+#define LINK_SWITCH_PRESS_DURATION 1000 // ms  // Helper button long press
 
 #define CALLSIGN_LENGTH 6 // Max length of callsign for BT/WiFi identification
 
@@ -0,0 +1,119 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+/**
+ * @brief Lock-free ring buffer for exactly one producer and one consumer,
+ * e.g. the main loop and a background task. Holds up to N - 1 elements.
+ */
+template <typename T, size_t N> class SPSCQueue {
+public:
+  /**
+   * @brief Append an element, called by the producer only
+   *
+   * @return false if the queue is full
+   */
+  bool push(const T &element) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t next = (head + 1) % N;
+    if (next == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    buffer_[head] = element;
+    head_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Reserve the next free slot to fill it in place, avoids a copy of
+   * large elements. Has to be followed by commit()
+   *
+   * @return T* NULL if the queue is full
+   */
+  T *reserve() {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if ((head + 1) % N == tail_.load(std::memory_order_acquire)) {
+      return NULL;
+    }
+    return &buffer_[head];
+  }
+
+  /**
+   * @brief Publish the slot returned by reserve()
+   */
+  void commit() {
+    size_t head = head_.load(std::memory_order_relaxed);
+    head_.store((head + 1) % N, std::memory_order_release);
+  }
+
+  /**
+   * @brief Remove the oldest element, called by the consumer only
+   *
+   * @return false if the queue is empty
+   */
+  bool pop(T *element) {
+    const T *front = peek();
+    if (front == NULL) {
+      return false;
+    }
+    *element = *front;
+    release();
+    return true;
+  }
+
+  /**
+   * @brief Access the oldest element in place. Has to be followed by
+   * release()
+   *
+   * @return const T* NULL if the queue is empty
+   */
+  const T *peek() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) {
+      return NULL;
+    }
+    return &buffer_[tail];
+  }
+
+  /**
+   * @brief Free the slot returned by peek()
+   */
+  void release() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    tail_.store((tail + 1) % N, std::memory_order_release);
+  }
+
+  size_t size() {
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    return (head + N - tail) % N;
+  }
+
+  static size_t capacity() { return N - 1; }
+
+private:
+  T buffer_[N];
+  std::atomic<size_t> head_{0}; // Next slot to write
+  std::atomic<size_t> tail_{0}; // Next slot to read
+};
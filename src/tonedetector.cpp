@@ -0,0 +1,188 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "tonedetector.h"
+
+static const uint16_t kDTMFFrequencies[8] = {6970,  7700,  8520,  9410,
+                                             12090, 13360, 14770, 16330};
+static const char kDTMFDigits[4][4] = {{'1', '2', '3', 'A'},
+                                       {'4', '5', '6', 'B'},
+                                       {'7', '8', '9', 'C'},
+                                       {'*', '0', '#', 'D'}};
+
+// EIA standard tones in 0.1 Hz
+static const uint16_t kCTCSSTones[CTCSS_TONE_COUNT] = {
+    670,  719,  744,  770,  797,  825,  854,  885,  915,  948,
+    974,  1000, 1035, 1072, 1109, 1148, 1188, 1230, 1273, 1318,
+    1365, 1413, 1462, 1514, 1567, 1622, 1679, 1738, 1799, 1862,
+    1928, 2035, 2107, 2181, 2257, 2336, 2418, 2503};
+
+ToneDetector::ToneDetector() {
+  for (int i = 0; i < 8; i++) {
+    dtmf_[i].begin(kDTMFFrequencies[i], VOX_SAMPLE_RATE);
+  }
+  for (int i = 0; i < CTCSS_TONE_COUNT; i++) {
+    ctcss_[i].begin(kCTCSSTones[i], VOX_SAMPLE_RATE / CTCSS_DECIMATION);
+  }
+}
+
+/**
+ * @brief Check if a frequency is one of the CTCSS tones detected
+ *
+ * @param tone in 0.1 Hz
+ */
+bool ToneDetector::isCTCSSTone(uint16_t tone) {
+  for (int i = 0; i < CTCSS_TONE_COUNT; i++) {
+    if (kCTCSSTones[i] == tone) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Feed one sample, called by the sampling task only
+ *
+ * @param sample signed, bias removed, at most 12 bit
+ */
+void ToneDetector::process(int32_t sample) {
+  for (int i = 0; i < 8; i++) {
+    dtmf_[i].process(sample);
+  }
+  dtmf_energy_ += sample * sample;
+  if (++dtmf_samples_ >= DTMF_BLOCK_SIZE) {
+    finishDTMFBlock();
+  }
+
+  // Second order CIC, the integrators wrap around on purpose
+  integrator1_ += (uint32_t)sample;
+  integrator2_ += integrator1_;
+  if (++decimation_count_ >= CTCSS_DECIMATION) {
+    decimation_count_ = 0;
+    uint32_t difference1 = integrator2_ - comb1_;
+    comb1_ = integrator2_;
+    uint32_t difference2 = difference1 - comb2_;
+    comb2_ = difference1;
+    processCTCSS((int32_t)difference2 / (CTCSS_DECIMATION * CTCSS_DECIMATION));
+  }
+}
+
+/**
+ * @brief Take the next detected digit, called by the main loop
+ *
+ * @param digit output: '0'-'9', '*', '#' or 'A'-'D'
+ * @return true if there was one
+ */
+bool ToneDetector::readDigit(char *digit) { return digits_.pop(digit); }
+
+/**
+ * @brief Find the digit of the current block. Both tones have to carry most
+ * of the energy and their levels must not differ too much (twist)
+ *
+ * @return char 0 if there is no valid digit
+ */
+char ToneDetector::decodeDTMF() {
+  if (dtmf_energy_ < (int64_t)DTMF_MIN_LEVEL * DTMF_MIN_LEVEL *
+                         DTMF_BLOCK_SIZE) {
+    return 0;
+  }
+  int row = 0;
+  int column = 4;
+  int64_t power[8];
+  for (int i = 0; i < 8; i++) {
+    power[i] = dtmf_[i].getPower();
+    if (i < 4 && power[i] > power[row]) {
+      row = i;
+    } else if (i >= 4 && power[i] > power[column]) {
+      column = i;
+    }
+  }
+  if (power[row] > power[column] * DTMF_MAX_TWIST ||
+      power[column] > power[row] * DTMF_MAX_TWIST) {
+    return 0;
+  }
+  // A tone holds 2 * power / N of the block energy
+  if ((power[row] + power[column]) * 2 * 100 <
+      dtmf_energy_ * DTMF_BLOCK_SIZE * DTMF_MIN_ENERGY) {
+    return 0;
+  }
+  return kDTMFDigits[row][column - 4];
+}
+
+/**
+ * @brief Report a digit once it was seen in two blocks in a row. It is
+ * reported again only after a pause
+ */
+void ToneDetector::finishDTMFBlock() {
+  char digit = decodeDTMF();
+  if (digit == 0) {
+    dtmf_digit_ = 0;
+  } else if (digit == dtmf_candidate_ && digit != dtmf_digit_) {
+    dtmf_digit_ = digit;
+    if (!digits_.push(digit)) {
+      dropped_digits_++;
+    }
+  }
+  dtmf_candidate_ = digit;
+
+  for (int i = 0; i < 8; i++) {
+    dtmf_[i].reset();
+  }
+  dtmf_energy_ = 0;
+  dtmf_samples_ = 0;
+}
+
+/**
+ * @brief Feed one decimated sample to the CTCSS filters
+ */
+void ToneDetector::processCTCSS(int32_t sample) {
+  for (int i = 0; i < CTCSS_TONE_COUNT; i++) {
+    ctcss_[i].process(sample);
+  }
+  ctcss_energy_ += sample * sample;
+  if (++ctcss_samples_ >= CTCSS_BLOCK_SIZE) {
+    finishCTCSSBlock();
+  }
+}
+
+/**
+ * @brief Pick the strongest tone of the block if it carries enough of the
+ * energy below the voice band
+ */
+void ToneDetector::finishCTCSSBlock() {
+  int best = 0;
+  int64_t best_power = 0;
+  for (int i = 0; i < CTCSS_TONE_COUNT; i++) {
+    int64_t power = ctcss_[i].getPower();
+    if (power > best_power) {
+      best_power = power;
+      best = i;
+    }
+    ctcss_[i].reset();
+  }
+  // A tone holds 2 * power / N of the block energy
+  bool valid = ctcss_energy_ >= (int64_t)CTCSS_MIN_LEVEL * CTCSS_MIN_LEVEL *
+                                    CTCSS_BLOCK_SIZE / 2 &&
+               best_power * 2 * 100 >=
+                   ctcss_energy_ * CTCSS_BLOCK_SIZE * CTCSS_MIN_ENERGY;
+  ctcss_tone_ = valid ? kCTCSSTones[best] : 0;
+  ctcss_energy_ = 0;
+  ctcss_samples_ = 0;
+}
@@ -0,0 +1,71 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#include "goertzel.h"
+#include "settings.h"
+#include "spscqueue.h"
+
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * @brief Detects DTMF digits and CTCSS sub-tones in the VOX audio with
+ * banks of Goertzel filters. process() runs on the sampling task, digits and
+ * the tone are read by the main loop
+ */
+class ToneDetector {
+public:
+  ToneDetector();
+  void process(int32_t);
+
+  bool readDigit(char *);
+  uint16_t getCTCSSTone() { return ctcss_tone_; };
+  uint32_t getDroppedDigits() { return dropped_digits_; };
+
+  static bool isCTCSSTone(uint16_t);
+
+private:
+  // DTMF, evaluated every DTMF_BLOCK_SIZE samples
+  Goertzel dtmf_[8]; // Rows, then columns
+  int64_t dtmf_energy_ = 0;
+  uint16_t dtmf_samples_ = 0;
+  char dtmf_candidate_ = 0; // Digit of the previous block
+  char dtmf_digit_ = 0;     // Digit reported last, until the tone ends
+  char decodeDTMF();
+  void finishDTMFBlock();
+
+  // CTCSS on the signal decimated by CTCSS_DECIMATION with a CIC filter
+  Goertzel ctcss_[CTCSS_TONE_COUNT];
+  uint32_t integrator1_ = 0;
+  uint32_t integrator2_ = 0;
+  uint32_t comb1_ = 0;
+  uint32_t comb2_ = 0;
+  uint16_t decimation_count_ = 0;
+  int64_t ctcss_energy_ = 0;
+  uint16_t ctcss_samples_ = 0;
+  void processCTCSS(int32_t);
+  void finishCTCSSBlock();
+
+  SPSCQueue<char, DTMF_QUEUE_SIZE + 1> digits_;
+  std::atomic<uint32_t> dropped_digits_{0};
+  std::atomic<uint16_t> ctcss_tone_{0}; // 0.1 Hz, 0: none
+};
@@ -0,0 +1,111 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "uartreader.h"
+
+#include <string.h>
+
+/**
+ * @brief Set the Stream to read from. On the target, the reading task is
+ * started
+ *
+ * @param stream
+ */
+void UARTReader::begin(Stream *stream) {
+  stream_ = stream;
+#ifdef ARDUINO
+  xTaskCreate(readTask, "uart_reader", UART_TASK_STACK_SIZE, this,
+              UART_TASK_PRIORITY, NULL);
+#endif
+}
+
+/**
+ * @brief Read all available bytes and queue the completed lines. Lines are
+ * split like Stream::readBytesUntil(): at SERIAL_DELIMITER or after
+ * SERIAL_MAX_LINE_LENGTH bytes. A trailing CR is removed, empty lines are
+ * skipped. Stops while the queue is full, the rest is read by the next poll.
+ *
+ * @return size_t Number of lines queued
+ */
+size_t UARTReader::poll() {
+  size_t lines = 0;
+  while (stream_->available() > 0) {
+    if (queue_.size() == queue_.capacity()) {
+      stalls_++;
+      break;
+    }
+    int c = stream_->read();
+    if (c < 0) {
+      break;
+    }
+    if (c != SERIAL_DELIMITER) {
+      line_[line_length_++] = (char)c;
+      if (line_length_ < SERIAL_MAX_LINE_LENGTH) {
+        continue;
+      }
+    } else if (line_length_ > 0 && line_[line_length_ - 1] == '\r') {
+      line_length_--;
+    }
+    if (line_length_ > 0) {
+      queueLine();
+      lines++;
+    }
+    line_length_ = 0;
+  }
+  return lines;
+}
+
+void UARTReader::queueLine() {
+  UARTLine *slot = queue_.reserve(); // Not full, checked by poll()
+  memcpy(slot->text, line_, line_length_);
+  slot->text[line_length_] = '\0';
+  queue_.commit();
+
+  size_t pending = queue_.size();
+  if (pending > high_water_) {
+    high_water_ = pending;
+  }
+}
+
+/**
+ * @brief Take the oldest received line, called by the main loop only
+ *
+ * @param line Output parameter
+ * @return true if a line was available
+ */
+bool UARTReader::readLine(string *line) {
+  const UARTLine *slot = queue_.peek();
+  if (slot == NULL) {
+    return false;
+  }
+  line->assign(slot->text);
+  queue_.release();
+  return true;
+}
+
+#ifdef ARDUINO
+void UARTReader::readTask(void *parameter) {
+  UARTReader *self = static_cast<UARTReader *>(parameter);
+  while (true) {
+    self->poll();
+    vTaskDelay(UART_POLL_INTERVAL / portTICK_PERIOD_MS);
+  }
+}
+#endif
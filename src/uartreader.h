@@ -0,0 +1,72 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "arduino-mock/Serial.h"
+#endif
+
+#include "settings.h"
+#include "spscqueue.h"
+
+#include <stdint.h>
+#include <string>
+using namespace std;
+
+typedef struct {
+  char text[SERIAL_MAX_LINE_LENGTH + 1];
+} UARTLine;
+
+/**
+ * @brief Reads the Stream of the Bluetooth module in its own task, so bursts
+ * don't overflow the UART FIFO during a slow main loop. Complete lines are
+ * handed to the main loop through a lock-free ring buffer. While it is full,
+ * reading stops and the bytes wait in the buffer of the UART driver.
+ */
+class UARTReader {
+public:
+  void begin(Stream *);
+  size_t poll();
+  bool readLine(string *);
+
+  size_t getPending() { return queue_.size(); };
+  size_t getCapacity() { return queue_.capacity(); };
+  size_t getHighWater() { return high_water_; };
+  uint32_t getStalls() { return stalls_; };
+
+private:
+  Stream *stream_ = NULL;
+  SPSCQueue<UARTLine, UART_QUEUE_SIZE + 1> queue_;
+
+  // Line being received, only accessed by the reader task
+  char line_[SERIAL_MAX_LINE_LENGTH + 1];
+  size_t line_length_ = 0;
+  void queueLine();
+
+  std::atomic<size_t> high_water_{0};
+  std::atomic<uint32_t> stalls_{0}; // Polls stopped by a full queue
+
+#ifdef ARDUINO
+  static void readTask(void *);
+#endif
+};
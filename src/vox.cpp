@@ -0,0 +1,128 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "vox.h"
+
+#ifdef ARDUINO
+#include "driver/i2s.h"
+#endif
+
+/**
+ * @brief Start sampling the audio line, does nothing if it already runs
+ */
+void VOX::begin() {
+#ifdef ARDUINO
+  if (task_ != NULL) {
+    return;
+  }
+  xTaskCreate(sampleTask, "vox", VOX_TASK_STACK_SIZE, this, VOX_TASK_PRIORITY,
+              &task_);
+#endif
+}
+
+/**
+ * @brief Run the envelope detector on a block of samples, called by the
+ * sampling task only. Integer shifts and adds per sample, no division
+ *
+ * @param samples 12 bit ADC values, the upper 4 bits (channel of the I2S
+ * ADC mode) are ignored
+ * @param count Number of samples
+ */
+void VOX::process(const uint16_t *samples, size_t count) {
+  uint8_t attack = attack_;
+  int32_t threshold = (int32_t)threshold_ << 4;
+  uint32_t hang = (uint32_t)hang_time_ * VOX_SAMPLE_RATE / 1000;
+  bool keyed = keyed_;
+
+  for (size_t i = 0; i < count; i++) {
+    int32_t sample = (int32_t)(samples[i] & 0x0FFF) << 4;
+    if (!started_) {
+      dc_ = sample; // No transient from the bias of the line
+      started_ = true;
+    }
+    // Remove the bias, then follow the rectified signal: fast up, slow down
+    dc_ += (sample - dc_) >> VOX_DC_SHIFT;
+    int32_t rectified = sample - dc_;
+    if (tones_ != nullptr) {
+      tones_->process(rectified >> 4);
+    }
+    if (meter_ != nullptr) {
+      meter_->process(rectified >> 4);
+    }
+    if (rectified < 0) {
+      rectified = -rectified;
+    }
+    if (rectified > envelope_) {
+      envelope_ += (rectified - envelope_) >> attack;
+    } else {
+      envelope_ += (rectified - envelope_) >> VOX_RELEASE_SHIFT;
+    }
+
+    if (envelope_ >= threshold) {
+      keyed = true;
+      hang_samples_ = hang;
+    } else if (hang_samples_ > 0) {
+      hang_samples_--;
+    } else {
+      keyed = false;
+    }
+  }
+  keyed_ = keyed;
+  level_ = envelope_ >> 4;
+}
+
+/**
+ * @brief Take over the result of the detector, has to be called in the main
+ * loop
+ */
+void VOX::update() {
+  ButtonState state = keyed_ ? BTNSTATE_PRESSED : BTNSTATE_RELEASED;
+  state_changed = state != button_state;
+  button_state = state;
+}
+
+#ifdef ARDUINO
+/**
+ * @brief Sample PIN_VOX_IN with the I2S ADC mode, the DMA fills the buffer
+ * without any CPU load. Each block is handed to the detector
+ */
+void VOX::sampleTask(void *parameter) {
+  VOX *self = static_cast<VOX *>(parameter);
+  i2s_config_t config = {};
+  config.mode =
+      (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN);
+  config.sample_rate = VOX_SAMPLE_RATE;
+  config.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+  config.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+  config.communication_format = I2S_COMM_FORMAT_I2S_MSB;
+  config.dma_buf_count = 4;
+  config.dma_buf_len = VOX_BLOCK_SIZE;
+  i2s_driver_install(I2S_NUM_0, &config, 0, NULL);
+  i2s_set_adc_mode(ADC_UNIT_1, ADC_CHANNEL_VOX_IN);
+  i2s_adc_enable(I2S_NUM_0);
+
+  uint16_t samples[VOX_BLOCK_SIZE];
+  while (true) {
+    size_t bytes = 0;
+    i2s_read(I2S_NUM_0, samples, sizeof(samples), &bytes, portMAX_DELAY);
+    self->process(samples, bytes / sizeof(samples[0]));
+  }
+}
+#endif
@@ -0,0 +1,78 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+#include "arduino-mock/Arduino.h"
+#endif
+
+#include "button.h"
+#include "levelmeter.h"
+#include "settings.h"
+#include "tonedetector.h"
+
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * @brief Voice operated PTT. The audio line on PIN_VOX_IN is sampled by DMA
+ * in its own task, a fixed-point envelope detector keys while the level is
+ * above the threshold and for the hang time afterwards. The main loop reads
+ * the result like a button. The samples are also handed to a ToneDetector
+ * and a LevelMeter
+ */
+class VOX : public Button {
+public:
+  void begin();
+  void process(const uint16_t *, size_t);
+  void update();
+
+  void setThreshold(uint16_t threshold) { threshold_ = threshold; };
+  void setHangTime(uint16_t hang_time) { hang_time_ = hang_time; };
+  void setAttack(uint8_t attack) { attack_ = attack; };
+  void setToneDetector(ToneDetector *tones) { tones_ = tones; };
+  void setLevelMeter(LevelMeter *meter) { meter_ = meter; };
+  bool isKeyed() { return keyed_; };
+  uint16_t getLevel() { return level_; };
+
+private:
+  std::atomic<uint16_t> threshold_{VOX_DEFAULT_THRESHOLD}; // ADC counts
+  std::atomic<uint16_t> hang_time_{VOX_DEFAULT_HANG_TIME}; // ms
+  std::atomic<uint8_t> attack_{VOX_ATTACK_SHIFT};
+  std::atomic<bool> keyed_{false};
+  std::atomic<uint16_t> level_{0}; // Envelope in ADC counts
+  ToneDetector *tones_ = nullptr;   // Set before begin()
+  LevelMeter *meter_ = nullptr;     // Set before begin()
+
+  // Detector state, only accessed by the sampling task. Values are ADC
+  // counts in Q4
+  bool started_ = false;
+  int32_t dc_ = 0;
+  int32_t envelope_ = 0;
+  uint32_t hang_samples_ = 0;
+
+#ifdef ARDUINO
+  TaskHandle_t task_ = NULL;
+  static void sampleTask(void *);
+#endif
+};
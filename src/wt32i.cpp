@@ -28,8 +28,12 @@ AN992: HANDS-FREE AND HEADSET PROFILES iWRAP APPLICATION NOTE, Version 1.12
 
 #include "wt32i.h"
 
+#include "logger.h"
 #include "splitstring.h"
 
+#include <algorithm>
+#include <stdio.h>
+
 /**
  * @brief Construct a new WT32i::WT32i object
  *
@@ -59,6 +63,22 @@ ResultType WT32i::available() {
   return serial_->waitForInputBlocking("OK", NULL, 2000);
 }
 
+/**
+ * @brief Check for availability of the WT32i module, non-blocking
+ * The module answers with "OK"
+ */
+void WT32i::probe() { serial_->println("AT"); }
+
+/**
+ * @brief Change the UART rate of the module, effective right after the
+ * command. 8 data bits, no parity, 1 stop bit
+ *
+ * @param baud_rate e.g. 921600
+ */
+void WT32i::setBaudRate(uint32_t baud_rate) {
+  serial_->println("SET CONTROL BAUD " + to_string(baud_rate) + ",8n1");
+}
+
 /**
  * @brief Display iWrap configuration values
  *
@@ -134,25 +154,6 @@ ResultType WT32i::setPinCode(string pin_code) {
   return kSuccess;
 }
 
-/**
- * @brief Request BD Address of the WT32i module
- *
- * @param bdaddress BD Address of the WT32i module (output)
- * @return ResultType
- */
-ResultType WT32i::getBDAddress(string *bdaddress) {
-  serial_->println("SET BT BDADDR");
-
-  // Expecting "SET BT BDADDR xx:xx:xx:xx:xx:xx"
-  string output;
-  if (serial_->waitForInputBlocking("SET", &output) ==
-      ResultType::kTimeoutError) {
-    return ResultType::kTimeoutError;
-  }
-  *bdaddress = splitString(output)[3];
-  return kSuccess;
-}
-
 /**
  * @brief Returns the 6-digit suffix of the given BD Address, without colons
  *
@@ -167,70 +168,59 @@ string WT32i::stripBDAddress(string bdaddress) {
 }
 
 /**
- * @brief Returns the 6 digit BD Address suffix of the BT module
+ * @brief Returns the iWrap version taken from the boot banner
+ *
+ * @return string e.g. "6.1.0", empty if unknown
+ */
+string WT32i::getFirmwareVersion() {
+  if (firmware_build_ == 0) {
+    return "";
+  }
+  return to_string(firmware_version_[0]) + "." +
+         to_string(firmware_version_[1]) + "." +
+         to_string(firmware_version_[2]);
+}
+
+/**
+ * @brief Check the iWrap version, e.g. for features introduced in 6.2
  *
- * @return string
+ * @param major
+ * @param minor
+ * @return true if the version is known and at least major.minor
  */
-string WT32i::getBDAddressSuffix() {
-  string bdaddress = "";
-  if (kSuccess != getBDAddress(&bdaddress)) {
-    return "1";
+bool WT32i::isFirmwareAtLeast(uint8_t major, uint8_t minor) {
+  if (firmware_build_ == 0) {
+    return false;
   }
-  return stripBDAddress(bdaddress);
+  return firmware_version_[0] > major ||
+         (firmware_version_[0] == major && firmware_version_[1] >= minor);
 }
 
 /**
  * @brief Starts inquiry, non-blocking
  *
+ * @param duration Duration in units of 1.28 s
  * @return ResultType
  */
-ResultType WT32i::startInquiry() {
-  // Clear current list of currently known devices
-  inquired_devices_.clear();
-
+ResultType WT32i::startInquiry(uint8_t duration) {
   // Inquiry for x * 1.28 seconds
-  string output = "INQUIRY ";
-  output.append(INQUIRY_DURATION);
+  string output = "INQUIRY " + to_string(duration);
   serial_->println(output.c_str());
 
   inquiry_running_ = true;
+  inquiry_results_pending_ = 0;
 
   return kSuccess;
 }
 
 /**
- * @brief Perform inquiry of bluetooth devices nearby
- * Blocks until answer or timeout!
- *
- * The list of inquiry results gets written to the inquired_devices_ list.
- *
- * @return ResultType
+ * @brief Cancel a running inquiry ("IC"). Results that are still missing
+ * are not waited for
  */
-ResultType WT32i::performInquiry() {
-  // Clear current list of currently known devices
-  inquired_devices_.clear();
-
-  // Inquiry for x * 1.28 seconds
-  serial_->println("INQUIRY 5"); // 5 * 1.28 sec
-
-  // Expecting "INQUIRY <num_devices>"
-  // Increased timeout, as Inquiry 5 takes longer than the default timeout
-  string output;
-  if (serial_->waitForInputBlocking("INQUIRY", &output, 8000) ==
-      ResultType::kTimeoutError) {
-    return ResultType::kTimeoutError;
-  }
-
-  // Reading inquiry data of <num_devices> and put it into inquired_devices_
-  int num_results = stoi(splitString(output)[1]);
-  for (int i = 0; i < num_results; i++) {
-    if (serial_->waitForInputBlocking("INQUIRY", &output) ==
-        ResultType::kTimeoutError) {
-      return ResultType::kTimeoutError;
-    }
-    inquired_devices_.push_back(splitString(output)[1]);
-  }
-  return ResultType::kSuccess;
+void WT32i::abortInquiry() {
+  serial_->println("IC");
+  inquiry_running_ = false;
+  inquiry_results_pending_ = 0;
 }
 
 void WT32i::list() { serial_->println("LIST"); }
@@ -311,10 +301,25 @@ ResultType WT32i::setStatus(string option, string value) {
 }
 
 /**
- * @brief Store information of HFP-AG status indications to hfp_states_ map
+ * @brief Send several lines with a single write, e.g. a batch of STATUS
+ * commands
+ *
+ * @param lines Lines without line ending
+ */
+void WT32i::sendLines(const vector<string> &lines) {
+  serial_->beginBatch();
+  for (const string &line : lines) {
+    serial_->println(line.c_str());
+  }
+  serial_->endBatch();
+}
+
+/**
+ * @brief Store information of HFP-AG status indications to hfp_states_ table
  *
  * With an active HFP-AG connection, the HFP device can indicate status
  * information (e.g. battery level, volume setting, ...).
+ * Only the indicators known from AN992 are stored, see HFPIndicator.
  *
  * @param input String with HFP status indication, e.g. "HFP 0 STATUS "service"
  * 0"
@@ -329,21 +334,36 @@ ResultType WT32i::storeHFPStatus(string input) {
     return ResultType::kError;
   };
 
-  link_id_t link_id = stoi(splitted_string.at(1));
-  string status_name = splitted_string.at(3);
+  link_id_t link_id = parseLinkId(splitted_string.at(1));
+  if (link_id < 0 || link_id >= BT_MAX_LINKS) {
+    return ResultType::kError;
+  }
 
   // Remove "" of property name ("service")
-  status_name.erase(status_name.begin());
-  status_name.erase(status_name.end() - 1);
-  int status_value = stoi(splitted_string.at(4));
+  string status_name = splitted_string.at(3);
+  if (status_name.length() > 2 && status_name.front() == '"' &&
+      status_name.back() == '"') {
+    status_name = status_name.substr(1, status_name.length() - 2);
+  }
+  HFPIndicator indicator = stringToHFPIndicator(status_name);
+  if (indicator == kHFPUnknownIndicator) {
+    return ResultType::kError;
+  }
 
-  hfp_states_[link_id][status_name] = status_value;
+  // Indicator values are small numbers, anything else is a garbled line
+  string value = splitted_string.at(4);
+  if (value.empty() || value.length() > 4 ||
+      value.find_first_not_of("0123456789") != string::npos) {
+    return ResultType::kError;
+  }
+  hfp_states_[link_id][indicator] = stoi(value);
+  hfp_states_valid_[link_id] |= 1 << indicator;
 
   return ResultType::kSuccess;
 }
 
 /**
- * @brief Get value of a HFP status parameter from hfp_states_ map
+ * @brief Get value of a HFP status parameter from hfp_states_ table
  *
  * @param link_id
  * @param status_name
@@ -352,36 +372,153 @@ ResultType WT32i::storeHFPStatus(string input) {
  */
 ResultType WT32i::getHFPStatus(int link_id, string status_name,
                                int *status_value) {
-  hfp_status_t::iterator it;
-  it = hfp_states_[link_id].find(status_name);
-  if (it == hfp_states_[link_id].end()) {
+  return getHFPStatus(link_id, stringToHFPIndicator(status_name),
+                      status_value);
+}
+
+/**
+ * @brief Get value of a HFP status parameter from hfp_states_ table
+ *
+ * @param link_id
+ * @param indicator
+ * @param status_value
+ * @return ResultType kError if the indicator has not been received yet
+ */
+ResultType WT32i::getHFPStatus(link_id_t link_id, HFPIndicator indicator,
+                               int *status_value) {
+  if (link_id < 0 || link_id >= BT_MAX_LINKS ||
+      indicator == kHFPUnknownIndicator) {
+    return ResultType::kError;
+  }
+  if (!(hfp_states_valid_[link_id] & (1 << indicator))) {
     return ResultType::kError;
   }
-  *status_value = it->second;
+  *status_value = hfp_states_[link_id][indicator];
   return ResultType::kSuccess;
 }
 
+/**
+ * @brief Forget all HFP status values of a link, e.g. after disconnect
+ *
+ * @param link_id
+ */
+void WT32i::clearHFPStatus(link_id_t link_id) {
+  if (link_id < 0 || link_id >= BT_MAX_LINKS) {
+    return;
+  }
+  hfp_states_valid_[link_id] = 0;
+}
+
+/**
+ * @brief Number of HFP status values currently stored in hfp_states_
+ *
+ * @return size_t
+ */
+size_t WT32i::getHFPStatusCount() {
+  size_t count = 0;
+  for (link_id_t link_id = 0; link_id < BT_MAX_LINKS; link_id++) {
+    for (int i = 0; i < kHFPIndicatorCount; i++) {
+      if (hfp_states_valid_[link_id] & (1 << i)) {
+        count++;
+      }
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Convert the name of a HFP indicator (AN992) to HFPIndicator
+ *
+ * @param name Indicator name without quotes, e.g. "battchg"
+ * @return HFPIndicator kHFPUnknownIndicator if the name is not known
+ */
+HFPIndicator WT32i::stringToHFPIndicator(string name) {
+  if (name == "service") {
+    return kHFPService;
+  }
+  if (name == "call") {
+    return kHFPCall;
+  }
+  if (name == "callsetup") {
+    return kHFPCallSetup;
+  }
+  if (name == "callheld") {
+    return kHFPCallHeld;
+  }
+  if (name == "signal") {
+    return kHFPSignal;
+  }
+  if (name == "roam") {
+    return kHFPRoam;
+  }
+  if (name == "battchg") {
+    return kHFPBattChg;
+  }
+  return kHFPUnknownIndicator;
+}
+
+/**
+ * @brief Convert a HFPIndicator to its name (AN992)
+ *
+ * @param indicator
+ * @return string Indicator name, e.g. "battchg", empty if unknown
+ */
+string WT32i::hfpIndicatorToString(HFPIndicator indicator) {
+  switch (indicator) {
+  case kHFPService:
+    return "service";
+  case kHFPCall:
+    return "call";
+  case kHFPCallSetup:
+    return "callsetup";
+  case kHFPCallHeld:
+    return "callheld";
+  case kHFPSignal:
+    return "signal";
+  case kHFPRoam:
+    return "roam";
+  case kHFPBattChg:
+    return "battchg";
+  default:
+    return "";
+  }
+}
+
+/**
+ * @brief Route the audio (SCO) of a call to the given HFP-AG link
+ *
+ * @param link_id
+ */
+void WT32i::openSCO(link_id_t link_id) {
+  serial_->println("SCO OPEN " + to_string(link_id));
+}
+
 /**
  * @brief Indicate outgoing phone call to the HFP device
+ *
+ * @param link_id HFP-AG link to address, -1 if only one link is connected
  */
-void WT32i::dial() {
-  serial_->println("DIALING");
+void WT32i::dial(link_id_t link_id) {
+  serial_->println(toLinkCommand("DIALING", link_id).c_str());
 }
 
 /**
  * @brief Accept phone call request
+ *
+ * @param link_id HFP-AG link to address, -1 if only one link is connected
  */
-void WT32i::connect() {
-  serial_->println("CONNECT");
+void WT32i::connect(link_id_t link_id) {
+  serial_->println(toLinkCommand("CONNECT", link_id).c_str());
 }
 
 /**
  * @brief Terminate phone call
  *
+ * @param link_id HFP-AG link to address, -1 if only one link is connected
  * @return ResultType
  */
-ResultType WT32i::hangup() {
-  serial_->println("HANGUP");
+ResultType WT32i::hangup(link_id_t link_id) {
+  serial_->println(toLinkCommand("HANGUP", link_id).c_str());
 
   return ResultType::kSuccess;
 }
@@ -421,6 +558,7 @@ ResultType WT32i::getIncomingMessage(iWrapMessage *msg) {
 ResultType WT32i::parseMessageString(string input, iWrapMessage *msg) {
   msg->msg_type = kUnknown;
   msg->msg = input;
+  msg->link_id = -1;
 
   if (input.empty()) {
     msg->msg_type = kEmpty;
@@ -431,6 +569,10 @@ ResultType WT32i::parseMessageString(string input, iWrapMessage *msg) {
 
   if (splitted_msg[0] == "SET") {
     msg->msg_type = kSETTING_UNKNOWN;
+    if (splitted_msg.size() == 1) {
+      // A bare "SET" terminates the listing of all settings
+      msg->msg_type = kSETTING_DUMP_END;
+    }
     if (splitted_msg.size() == 5) {
       if (splitted_msg[1] == "CONTROL" && splitted_msg[2] == "GAIN") {
         msg->msg_type = kSETTING_CONTROL_GAIN;
@@ -440,22 +582,42 @@ ResultType WT32i::parseMessageString(string input, iWrapMessage *msg) {
       }
     }
   } else if (splitted_msg[0] == "LIST") {
+    if (splitted_msg.size() == 2) {
+      // "LIST <number_of_connections>" starts a new listing, forget the
+      // results of the previous one
+      active_connections_.clear();
+    }
     if (splitted_msg.size() > 2) {
       active_connections_.push_back(splitted_msg[10]); // BT Address
+      msg->link_id = parseLinkId(splitted_msg[1]);
       msg->msg_type = kLIST_RESULT;
     }
+  } else if (splitted_msg[0] == "CALL" && splitted_msg.size() == 2) {
+    // Link id assigned to an outgoing connection
+    msg->link_id = parseLinkId(splitted_msg[1]);
+    msg->msg_type = kCALL_RESULT;
+  } else if (splitted_msg[0] == "INQUIRY_PARTIAL") {
+    msg->msg_type = kINQUIRY_PARTIAL;
   } else if (splitted_msg[0] == "INQUIRY") {
-    if (splitted_msg.size() == 2) {
-      if (stoi(splitted_msg[1]) == 0) {
-        inquiry_running_ = false;
-      }
-    }
-    if (splitted_msg.size() > 2) {
-      inquired_devices_.push_back(splitted_msg[1]); //  BT Address
+    if (splitted_msg.size() > 1 && splitted_msg[1] == "ERROR") {
+      // e.g. "INQUIRY ERROR 0x0c", no results follow
+      inquiry_results_pending_ = 0;
       inquiry_running_ = false;
+      msg->msg_type = kINQUIRY_ERROR;
+    } else if (splitted_msg.size() == 2) {
+      // "INQUIRY <num_devices>" ends the inquiry, the results follow
+      inquiry_results_pending_ = stoi(splitted_msg[1]);
+      inquiry_running_ = inquiry_results_pending_ > 0;
+      msg->msg_type = kINQUIRY_FINISHED;
+    } else if (splitted_msg.size() > 2) {
+      if (inquiry_results_pending_ > 0) {
+        inquiry_results_pending_--;
+      }
+      inquiry_running_ = inquiry_results_pending_ > 0;
       msg->msg_type = kINQUIRY_RESULT;
     }
   } else if (splitted_msg[0] == "HFP-AG") {
+    msg->link_id = parseLinkId(splitted_msg[1]);
     if (splitted_msg[2] == "READY") {
       msg->msg_type = kHFPAG_READY;
     } else if (splitted_msg[2] == "CALLING") {
@@ -469,16 +631,39 @@ ResultType WT32i::parseMessageString(string input, iWrapMessage *msg) {
     } else {
       return kError;
     }
+  } else if (splitted_msg[0] == "HFP" && splitted_msg.size() > 2 &&
+             splitted_msg[2] == "STATUS") {
+    msg->link_id = parseLinkId(splitted_msg[1]);
+    if (storeHFPStatus(input) != kSuccess) {
+      return kError;
+    }
+    msg->msg_type = kHFP_STATUS;
   } else if (splitted_msg[0] == "NO" && splitted_msg[1] == "CARRIER") {
+    msg->link_id = parseLinkId(splitted_msg[2]);
     if (splitted_msg[3] == "ERROR") {
+      // Link 1 usually carries the audio of a call, the FSM decides based on
+      // the links it tracks
       if (splitted_msg[2] == "1") {
         msg->msg_type = kNOCARRIER_ERROR_CALL_ENDED;
-      } else if (splitted_msg[2] == "0") {
+      } else {
         msg->msg_type = kNOCARRIER_ERROR_LINK_LOSS;
       }
     } else {
       return kError;
     }
+  } else if (splitted_msg[0] == "CONNECT" && splitted_msg.size() > 2 &&
+             splitted_msg[2] == "SCO") {
+    // Audio link of a call, it gets a link id of its own
+    msg->link_id = parseLinkId(splitted_msg[1]);
+    msg->msg_type = kSCO_CONNECT;
+  } else if (splitted_msg[0] == "WRAP") {
+    // e.g. "WRAP THOR AI (6.1.0 build 1119)"
+    msg->msg_type = kBOOT_BANNER;
+    return parseBanner(input);
+  } else if (splitted_msg[0] == "READY.") {
+    msg->msg_type = kBOOT_READY;
+  } else if (splitted_msg[0] == "OK") {
+    msg->msg_type = kOK;
   } else if (splitted_msg[0] == "SSP" && splitted_msg[1] == "CONFIRM") {
     msg->msg_type = kSSP_CONFIRM;
   } else if (splitted_msg[0] == "NAME" && splitted_msg[1] != "ERROR") {
@@ -490,6 +675,55 @@ ResultType WT32i::parseMessageString(string input, iWrapMessage *msg) {
   return kSuccess;
 }
 
+/**
+ * @brief Extract the firmware version from the boot banner
+ *
+ * @param input e.g. "WRAP THOR AI (6.1.0 build 1119)"
+ * @return ResultType kError if the banner does not contain a version
+ */
+ResultType WT32i::parseBanner(string input) {
+  unsigned int major = 0, minor = 0, patch = 0, build = 0;
+  size_t start = input.find('(');
+  if (start == string::npos ||
+      sscanf(input.c_str() + start, "(%u.%u.%u build %u", &major, &minor,
+             &patch, &build) != 4) {
+    return kError;
+  }
+  firmware_version_[0] = major;
+  firmware_version_[1] = minor;
+  firmware_version_[2] = patch;
+  firmware_build_ = build;
+  return kSuccess;
+}
+
+/**
+ * @brief Convert the link id of an iWrap message to a number
+ *
+ * @param input Link id as string, e.g. "0"
+ * @return link_id_t -1 if the input is not a valid link id
+ */
+link_id_t WT32i::parseLinkId(string input) {
+  if (input.empty() || input.length() > 2 ||
+      input.find_first_not_of("0123456789") != string::npos) {
+    return -1;
+  }
+  return stoi(input);
+}
+
+/**
+ * @brief Append the link id to an HFP-AG command, like "SCO OPEN <link>"
+ *
+ * @param command e.g. "HANGUP"
+ * @param link_id -1 to send the command without link id
+ * @return string e.g. "HANGUP 1"
+ */
+string WT32i::toLinkCommand(string command, link_id_t link_id) {
+  if (link_id < 0) {
+    return command;
+  }
+  return command + " " + to_string(link_id);
+}
+
 /**
  * @brief Handle incoming DIAL indication from HFP device
  *
@@ -534,6 +768,9 @@ ResultType WT32i::handleMessage_HFPAG_UNKNOWN(iWrapMessage msg) {
   // Not sure if we have to send "OK" on the end of each +C... answer, so this
   // is currently a bit trial and error and will be fixed gradually
 
+  // Multi-line answers are sent with a single write
+  ResultType result = kSuccess;
+  serial_->beginBatch();
   if (cmd == "AT+NREC=0") {
     // Indicate that we do not support Error Cancelation and Noise cancelation
     sendERROR();
@@ -661,25 +898,13 @@ ResultType WT32i::handleMessage_HFPAG_UNKNOWN(iWrapMessage msg) {
 
   // Unkown commands
   else {
-    serial_->dbg_println("INFO: unrecognized message");
+    LOG_INFO("INFO: unrecognized message");
     sendERROR();
-    return kError;
+    result = kError;
   }
+  serial_->endBatch();
 
-  return kSuccess;
-}
-
-/**
- * @brief Indicate the availability of the mobile phone network to the HFP
- * device
- *
- * @return ResultType
- */
-ResultType WT32i::indicateNetworkAvailable() {
-  setStatus("service", "1");
-  setStatus("signal", "5");
-
-  return kSuccess;
+  return result;
 }
 
 /**
@@ -25,7 +25,6 @@ Contact: bt-trx.com, mail@bt-trx.com
 #include "serialwrapper.h"
 #include "settings.h"
 
-#include <map>
 #include <string>
 #include <vector>
 using std::string;
@@ -33,6 +32,22 @@ using std::vector;
 
 typedef int link_id_t;
 
+/**
+ * @brief HFP indicators known from AN992, interned when parsing
+ * "HFP <link_id> STATUS" messages
+ */
+enum HFPIndicator {
+  kHFPService,
+  kHFPCall,
+  kHFPCallSetup,
+  kHFPCallHeld,
+  kHFPSignal,
+  kHFPRoam,
+  kHFPBattChg,
+  kHFPIndicatorCount,
+  kHFPUnknownIndicator = kHFPIndicatorCount
+};
+
 class WT32iInterface {
 public:
   virtual void resetBTPairings() = 0;
@@ -49,12 +64,14 @@ public:
   // Communication with WT32i device
   ResultType reset();
   ResultType available();
+  void probe();
+  void setBaudRate(uint32_t);
   void set();
   ResultType set(string, string = "", string = "");
   ResultType setAudioGain(string, string);
   ResultType setPinCode(string);
-  ResultType performInquiry();
-  ResultType startInquiry();
+  ResultType startInquiry(uint8_t = INQUIRY_DURATION);
+  void abortInquiry();
   bool inquiryRunning() { return inquiry_running_; }
   void list();
   void name(string);
@@ -63,9 +80,11 @@ public:
   void resetBTPairings();
   void connectHFPAG(string);
   ResultType setStatus(string, string);
-  void dial();
-  void connect();
-  ResultType hangup();
+  void sendLines(const vector<string> &);
+  void openSCO(link_id_t);
+  void dial(link_id_t = -1);
+  void connect(link_id_t = -1);
+  ResultType hangup(link_id_t = -1);
   ResultType sendSSPConfirmation(string);
 
   // Message handlers
@@ -76,27 +95,39 @@ public:
   // Helper Methods
   ResultType storeHFPStatus(string);
   ResultType getHFPStatus(int, string, int *);
-  vector<string> getInquiredDevices() { return inquired_devices_; };
+  ResultType getHFPStatus(link_id_t, HFPIndicator, int *);
+  void clearHFPStatus(link_id_t);
+  size_t getHFPStatusCount();
+  static HFPIndicator stringToHFPIndicator(string);
+  static string hfpIndicatorToString(HFPIndicator);
   vector<string> getActiveConnections() { return active_connections_; }
-  string getBDAddressSuffix();
-
-  ResultType indicateNetworkAvailable();
+  string getFirmwareVersion();
+  uint16_t getFirmwareBuild() { return firmware_build_; }
+  bool isFirmwareAtLeast(uint8_t, uint8_t);
+  static string stripBDAddress(string);
 
   // Only public for unit testing
   ResultType parseMessageString(string, iWrapMessage *);
 
 private:
-  typedef std::map<string, int> hfp_status_t;
-
   SerialWrapperInterface *serial_ = NULL;
-  vector<string> inquired_devices_;
   vector<string> active_connections_;
-  std::map<link_id_t, hfp_status_t> hfp_states_;
+
+  // HFP indicator values per link, a bit in hfp_states_valid_ marks an
+  // indicator as received
+  int8_t hfp_states_[BT_MAX_LINKS][kHFPIndicatorCount] = {};
+  uint8_t hfp_states_valid_[BT_MAX_LINKS] = {};
+
+  // iWrap version from the boot banner, 0.0.0 if unknown
+  uint8_t firmware_version_[3] = {};
+  uint16_t firmware_build_ = 0;
+  ResultType parseBanner(string);
 
   bool inquiry_running_ = false;
+  int inquiry_results_pending_ = 0;
 
-  ResultType getBDAddress(string *);
-  string stripBDAddress(string);
+  static link_id_t parseLinkId(string);
+  static string toLinkCommand(string, link_id_t);
 
   void sendOK();
   void sendERROR();
@@ -0,0 +1,209 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "wt32iconfig.h"
+#include "splitstring.h"
+
+#include <algorithm>
+#include <ctype.h>
+
+/**
+ * @brief Forget all entries
+ */
+void WT32iConfig::clear() {
+  for (size_t i = 0; i < size_; i++) {
+    entries_[i] = ConfigEntry();
+  }
+  size_ = 0;
+}
+
+/**
+ * @brief Set the desired value of a setting
+ * Example: "SET BT CLASS 400204" -> setDesired("BT CLASS", "400204")
+ *
+ * @param key Category and option, e.g. "BT AUTH *"
+ * @param value
+ * @return ResultType kError if the table is full
+ */
+ResultType WT32iConfig::setDesired(string key, string value) {
+  ConfigEntry *entry = add(key);
+  if (entry == NULL) {
+    return kError;
+  }
+  entry->desired = value;
+  entry->writable = true;
+  return kSuccess;
+}
+
+/**
+ * @brief Record the value of a setting from the read back without ever
+ * writing it, e.g. "BT BDADDR"
+ *
+ * @param key
+ * @return ResultType kError if the table is full
+ */
+ResultType WT32iConfig::watch(string key) {
+  return add(key) == NULL ? kError : kSuccess;
+}
+
+/**
+ * @brief Store the current value of a setting from a line of the "SET" dump
+ *
+ * @param line e.g. "SET BT CLASS 400204"
+ * @return ResultType kError if the setting is not part of the configuration
+ */
+ResultType WT32iConfig::readBack(string line) {
+  for (size_t i = 0; i < size_; i++) {
+    string prefix = "SET " + entries_[i].key;
+    if (line.compare(0, prefix.length(), prefix) != 0) {
+      continue;
+    }
+    if (line.length() == prefix.length()) {
+      entries_[i].current = "";
+    } else if (line[prefix.length()] == ' ') {
+      entries_[i].current = line.substr(prefix.length() + 1);
+    } else {
+      continue; // e.g. "SET BT NAMEX" is not "SET BT NAME"
+    }
+    entries_[i].current_known = true;
+    return kSuccess;
+  }
+  return kError;
+}
+
+/**
+ * @brief Forget the values read back, e.g. before a verification pass
+ */
+void WT32iConfig::resetReadBack() {
+  for (size_t i = 0; i < size_; i++) {
+    entries_[i].current = "";
+    entries_[i].current_known = false;
+  }
+}
+
+/**
+ * @brief Return the value of a setting as read back from the module
+ *
+ * @param key
+ * @return string Empty if unknown
+ */
+string WT32iConfig::getCurrent(string key) {
+  ConfigEntry *entry = find(key);
+  if (entry == NULL) {
+    return "";
+  }
+  return entry->current;
+}
+
+/**
+ * @brief Write all settings whose current value differs from the desired
+ * one, back to back without waiting for the module
+ *
+ * @param wt32i
+ * @return size_t Number of settings written
+ */
+size_t WT32iConfig::writeDifferences(WT32i *wt32i) {
+  size_t written = 0;
+  for (size_t i = 0; i < size_; i++) {
+    if (matches(entries_[i])) {
+      continue;
+    }
+    vector<string> category = splitString(entries_[i].key);
+    string option = entries_[i].key.substr(category[0].length() + 1);
+    wt32i->set(category[0], option, entries_[i].desired);
+    written++;
+  }
+  return written;
+}
+
+/**
+ * @brief Number of settings whose current value differs from the desired one
+ *
+ * @return size_t
+ */
+size_t WT32iConfig::countDifferences() {
+  size_t count = 0;
+  for (size_t i = 0; i < size_; i++) {
+    if (!matches(entries_[i])) {
+      count++;
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief List the keys of all differing settings, for debug output
+ *
+ * @return string e.g. "BT NAME, CONTROL ECHO"
+ */
+string WT32iConfig::getDifferences() {
+  string differences = "";
+  for (size_t i = 0; i < size_; i++) {
+    if (matches(entries_[i])) {
+      continue;
+    }
+    if (!differences.empty()) {
+      differences += ", ";
+    }
+    differences += entries_[i].key;
+  }
+  return differences;
+}
+
+ConfigEntry *WT32iConfig::find(string key) {
+  for (size_t i = 0; i < size_; i++) {
+    if (entries_[i].key == key) {
+      return &entries_[i];
+    }
+  }
+  return NULL;
+}
+
+ConfigEntry *WT32iConfig::add(string key) {
+  ConfigEntry *entry = find(key);
+  if (entry != NULL) {
+    return entry;
+  }
+  if (size_ >= WT32I_CONFIG_SIZE || key.find(' ') == string::npos) {
+    return NULL;
+  }
+  entry = &entries_[size_++];
+  *entry = ConfigEntry();
+  entry->key = key;
+  return entry;
+}
+
+/**
+ * @brief Check if the current value equals the desired one. iWrap prints hex
+ * values in lower case, so the comparison ignores the case
+ */
+bool WT32iConfig::matches(const ConfigEntry &entry) {
+  if (!entry.writable) {
+    return true;
+  }
+  if (!entry.current_known ||
+      entry.current.length() != entry.desired.length()) {
+    return false;
+  }
+  return std::equal(entry.current.begin(), entry.current.end(),
+                    entry.desired.begin(), [](char a, char b) {
+                      return tolower(a) == tolower(b);
+                    });
+}
@@ -0,0 +1,68 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#include "resulttype.h"
+#include "settings.h"
+#include "wt32i.h"
+
+#include <string>
+using namespace std;
+
+/**
+ * @brief A configuration value of the WT32i, e.g. key "BT CLASS" and value
+ * "400204" for "SET BT CLASS 400204"
+ */
+typedef struct {
+  string key;
+  string desired;
+  string current;
+  bool current_known;
+  bool writable;
+} ConfigEntry;
+
+/**
+ * @brief Desired configuration of the WT32i, compared against the values read
+ * back from the module ("SET" dump) so only differences get written
+ */
+class WT32iConfig {
+public:
+  WT32iConfig() {}
+
+  void clear();
+  ResultType setDesired(string, string);
+  ResultType watch(string);
+  ResultType readBack(string);
+  void resetReadBack();
+  string getCurrent(string);
+
+  size_t writeDifferences(WT32i *);
+  size_t countDifferences();
+  string getDifferences();
+
+private:
+  ConfigEntry entries_[WT32I_CONFIG_SIZE];
+  size_t size_ = 0;
+
+  ConfigEntry *find(string);
+  ConfigEntry *add(string);
+  static bool matches(const ConfigEntry &);
+};
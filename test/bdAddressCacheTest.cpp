@@ -0,0 +1,101 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gtest/gtest.h"
+
+#include "../src/bdaddresscache.h"
+
+#include <string.h>
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+using ::testing::StrEq;
+
+namespace {
+struct GetAddress {
+  const uint8_t *address;
+  size_t operator()(const char *, void *buffer, size_t) {
+    memcpy(buffer, address, BD_ADDRESS_SIZE);
+    return BD_ADDRESS_SIZE;
+  }
+};
+
+class BDAddressCacheTest : public ::testing::Test {
+protected:
+  Preferences preferencesMock;
+  const uint8_t stored_[BD_ADDRESS_SIZE] = {0x00, 0x07, 0x80,
+                                            0x12, 0x34, 0x56};
+};
+
+TEST_F(BDAddressCacheTest, get_empty) {
+  BDAddressCache cache(&preferencesMock);
+  EXPECT_CALL(preferencesMock, getBytes(StrEq("bt_bdaddr"), _, _))
+      .WillOnce(Return(0));
+
+  cache.load();
+  ASSERT_EQ("", cache.get());
+}
+
+TEST_F(BDAddressCacheTest, load_success) {
+  BDAddressCache cache(&preferencesMock);
+  EXPECT_CALL(preferencesMock, getBytes(StrEq("bt_bdaddr"), _, _))
+      .WillOnce(Invoke(GetAddress{stored_}));
+
+  cache.load();
+  ASSERT_EQ("00:07:80:12:34:56", cache.get());
+}
+
+TEST_F(BDAddressCacheTest, update_storesNewAddress) {
+  BDAddressCache cache(&preferencesMock);
+  EXPECT_CALL(preferencesMock,
+              putBytes(StrEq("bt_bdaddr"), _, BD_ADDRESS_SIZE));
+
+  ASSERT_TRUE(cache.update("00:07:80:12:34:56"));
+  ASSERT_EQ("00:07:80:12:34:56", cache.get());
+}
+
+TEST_F(BDAddressCacheTest, update_sameAddressNotWritten) {
+  BDAddressCache cache(&preferencesMock);
+  EXPECT_CALL(preferencesMock, getBytes(StrEq("bt_bdaddr"), _, _))
+      .WillOnce(Invoke(GetAddress{stored_}));
+  EXPECT_CALL(preferencesMock, putBytes(_, _, _)).Times(0);
+
+  cache.load();
+  ASSERT_FALSE(cache.update("00:07:80:12:34:56"));
+}
+
+TEST_F(BDAddressCacheTest, update_invalidAddress) {
+  BDAddressCache cache(&preferencesMock);
+  EXPECT_CALL(preferencesMock, putBytes(_, _, _)).Times(0);
+
+  ASSERT_FALSE(cache.update("00:07:80"));
+  ASSERT_EQ("", cache.get());
+}
+
+TEST_F(BDAddressCacheTest, update_ownKey) {
+  BDAddressCache cache(&preferencesMock, "ble_button");
+  EXPECT_CALL(preferencesMock,
+              putBytes(StrEq("ble_button"), _, BD_ADDRESS_SIZE));
+
+  ASSERT_TRUE(cache.update("00:1b:10:aa:bb:cc"));
+  ASSERT_EQ("00:1b:10:aa:bb:cc", cache.get());
+}
+} // namespace
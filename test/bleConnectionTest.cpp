@@ -0,0 +1,99 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gtest/gtest.h"
+
+#include "../src/bleconnection.h"
+
+namespace {
+class BLEConnectionTest : public ::testing::Test {
+protected:
+  BLEConnection connection;
+};
+
+TEST_F(BLEConnectionTest, update_measuresConnectAndDiscovery) {
+  ASSERT_TRUE(connection.start(1000));
+  ASSERT_EQ(kBLEConnecting, connection.getState());
+  ASSERT_FALSE(connection.update());
+
+  connection.post(kBLELinkUp, 1420);
+  ASSERT_TRUE(connection.update());
+  ASSERT_EQ(kBLEDiscovering, connection.getState());
+  ASSERT_EQ(420u, connection.getConnectTime());
+
+  connection.post(kBLESubscribed, 1600);
+  ASSERT_TRUE(connection.update());
+  ASSERT_TRUE(connection.isConnected());
+  ASSERT_EQ(180u, connection.getDiscoveryTime());
+  ASSERT_EQ("1 connects, 0 failed, connect 420 ms, discovery 180 ms",
+            connection.getStats());
+}
+
+TEST_F(BLEConnectionTest, update_allStepsAtOnce) {
+  connection.start(0);
+  connection.post(kBLELinkUp, 300);
+  connection.post(kBLESubscribed, 450);
+
+  ASSERT_TRUE(connection.update());
+  ASSERT_TRUE(connection.isConnected());
+  ASSERT_EQ(300u, connection.getConnectTime());
+  ASSERT_EQ(150u, connection.getDiscoveryTime());
+}
+
+TEST_F(BLEConnectionTest, update_failedDiscovery) {
+  connection.start(0);
+  connection.post(kBLELinkUp, 300);
+  connection.post(kBLEFailed, 2300);
+
+  ASSERT_TRUE(connection.update());
+  ASSERT_TRUE(connection.isIdle());
+  ASSERT_EQ(1u, connection.getFailures());
+  ASSERT_EQ(0u, connection.getConnects());
+  ASSERT_EQ("0 connects, 1 failed", connection.getStats());
+}
+
+TEST_F(BLEConnectionTest, start_onlyWhenIdle) {
+  ASSERT_TRUE(connection.start(0));
+  ASSERT_FALSE(connection.start(10));
+
+  connection.post(kBLELinkUp, 100);
+  connection.post(kBLESubscribed, 200);
+  connection.update();
+  ASSERT_FALSE(connection.start(300));
+}
+
+TEST_F(BLEConnectionTest, postDisconnect_backToIdle) {
+  connection.start(0);
+  connection.post(kBLELinkUp, 100);
+  connection.post(kBLESubscribed, 200);
+  connection.update();
+
+  connection.postDisconnect();
+  ASSERT_TRUE(connection.update());
+  ASSERT_TRUE(connection.isIdle());
+
+  // A new attempt starts from scratch
+  ASSERT_TRUE(connection.start(5000));
+  connection.post(kBLELinkUp, 5250);
+  connection.update();
+  ASSERT_EQ(250u, connection.getConnectTime());
+}
+
+} // namespace
@@ -0,0 +1,144 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gtest/gtest.h"
+
+#include "../src/blereconnectpolicy.h"
+
+namespace {
+class BLEReconnectPolicyTest : public ::testing::Test {
+protected:
+  BLEReconnectPolicy policy;
+};
+
+TEST_F(BLEReconnectPolicyTest, next_scansWithoutKnownDevice) {
+  ASSERT_EQ(kBLEScan, policy.next(0));
+  ASSERT_EQ(kBLEWait, policy.next(BLE_SCAN_INTERVAL * 1000 - 1));
+  ASSERT_EQ(kBLEScan, policy.next(BLE_SCAN_INTERVAL * 1000));
+  ASSERT_EQ(2u, policy.getScans());
+  ASSERT_EQ(2u * BLE_SCAN_DURATION * 1000, policy.getScanTime());
+  ASSERT_EQ(0u, policy.getDirectAttempts());
+}
+
+TEST_F(BLEReconnectPolicyTest, next_connectsKnownDeviceDirectly) {
+  policy.setKnownDevice(true);
+  policy.setFreeSlot(false);
+
+  ASSERT_EQ(kBLEConnectDirect, policy.next(0));
+  policy.failed();
+  ASSERT_EQ(kBLEWait, policy.next(BLE_RECONNECT_INTERVAL - 1));
+  ASSERT_EQ(kBLEConnectDirect, policy.next(BLE_RECONNECT_INTERVAL));
+  ASSERT_EQ(0u, policy.getScans());
+}
+
+TEST_F(BLEReconnectPolicyTest, next_scansOnceAfterFailures) {
+  policy.setKnownDevice(true);
+  policy.setFreeSlot(false);
+  ulong now = 0;
+  for (int i = 0; i < BLE_RECONNECT_SCAN_AFTER; i++) {
+    ASSERT_EQ(kBLEConnectDirect, policy.next(now));
+    policy.failed();
+    now += BLE_RECONNECT_INTERVAL;
+  }
+
+  // Maybe the button was replaced
+  ASSERT_EQ(kBLEScan, policy.next(now));
+  now += BLE_SCAN_DURATION * 1000;
+  ASSERT_EQ(kBLEConnectDirect, policy.next(now));
+  ASSERT_EQ(1u, policy.getScans());
+}
+
+TEST_F(BLEReconnectPolicyTest, next_scansForFreeSlotNextToKnownDevice) {
+  // One button stored, the other slot empty
+  policy.setKnownDevice(true);
+  policy.setFreeSlot(true);
+
+  ASSERT_EQ(kBLEScan, policy.next(0));
+  ulong now = BLE_SCAN_DURATION * 1000;
+  ASSERT_EQ(kBLEConnectDirect, policy.next(now));
+  policy.failed();
+  now += BLE_RECONNECT_INTERVAL;
+  ASSERT_EQ(kBLEConnectDirect, policy.next(now));
+  policy.failed();
+
+  now = BLE_SCAN_INTERVAL * 1000;
+  ASSERT_EQ(kBLEScan, policy.next(now));
+  ASSERT_EQ(2u, policy.getScans());
+  ASSERT_EQ(2u, policy.getDirectAttempts());
+
+  // Every slot has a button now, only direct connects
+  policy.setFreeSlot(false);
+  now += 2 * BLE_SCAN_INTERVAL * 1000;
+  ASSERT_EQ(kBLEConnectDirect, policy.next(now));
+  ASSERT_EQ(2u, policy.getScans());
+}
+
+TEST_F(BLEReconnectPolicyTest, next_waitsWithButtonConnected) {
+  // One button connected, the other slot empty
+  policy.setKnownDevice(false);
+  policy.setFreeSlot(true);
+  policy.setButtonConnected(true);
+
+  // A second button is only searched shortly after boot
+  ASSERT_EQ(kBLEScan, policy.next(0));
+  ulong now = BLE_NEW_BUTTON_WINDOW * 1000;
+  ASSERT_EQ(kBLEWait, policy.next(now));
+  ASSERT_EQ(kBLEWait, policy.next(now + 10 * BLE_SCAN_INTERVAL * 1000));
+  ASSERT_EQ(1u, policy.getScans());
+
+  // Searched again once the button is lost
+  policy.setButtonConnected(false);
+  ASSERT_EQ(kBLEScan, policy.next(now + 10 * BLE_SCAN_INTERVAL * 1000));
+}
+
+TEST_F(BLEReconnectPolicyTest, setBusy_backsOff) {
+  ASSERT_EQ(BLE_SCAN_WINDOW_IDLE, policy.getScanWindow());
+  ASSERT_EQ(BLE_SCAN_CYCLE_IDLE, policy.getScanCycle());
+  policy.setBusy(true);
+  ASSERT_EQ(BLE_SCAN_WINDOW_BUSY, policy.getScanWindow());
+  ASSERT_EQ(BLE_SCAN_CYCLE_BUSY, policy.getScanCycle());
+  ASSERT_LT(BLE_SCAN_WINDOW_BUSY * 100 / BLE_SCAN_CYCLE_BUSY,
+            BLE_SCAN_WINDOW_IDLE * 100 / BLE_SCAN_CYCLE_IDLE);
+
+  ASSERT_EQ(kBLEScan, policy.next(0));
+  ulong interval = BLE_SCAN_INTERVAL * 1000 * BLE_SCAN_BUSY_BACKOFF;
+  ASSERT_EQ(kBLEWait, policy.next(interval - 1));
+  ASSERT_EQ(kBLEScan, policy.next(interval));
+}
+
+TEST_F(BLEReconnectPolicyTest, setWebBusy_backsOff) {
+  policy.setWebBusy(true);
+  ASSERT_EQ(BLE_SCAN_WINDOW_BUSY, policy.getScanWindow());
+  ASSERT_EQ(BLE_SCAN_CYCLE_BUSY, policy.getScanCycle());
+
+  policy.setWebBusy(false);
+  ASSERT_EQ(BLE_SCAN_WINDOW_IDLE, policy.getScanWindow());
+}
+
+TEST_F(BLEReconnectPolicyTest, connected_reconnectsImmediately) {
+  policy.setKnownDevice(true);
+  policy.setFreeSlot(false);
+  ASSERT_EQ(kBLEConnectDirect, policy.next(1000));
+  policy.connected();
+
+  ASSERT_EQ(kBLEConnectDirect, policy.next(1001));
+}
+
+} // namespace
@@ -0,0 +1,56 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gtest/gtest.h"
+
+#include "../src/blescanstats.h"
+
+namespace {
+class BLEScanStatsTest : public ::testing::Test {
+protected:
+  BLEScanStats stats;
+};
+
+TEST_F(BLEScanStatsTest, finishScan_countsPerScan) {
+  stats.countResult(false, 20);
+  stats.countResult(true, 35);
+  stats.countResult(false, 15);
+  stats.finishScan();
+
+  ASSERT_EQ(1u, stats.getScans());
+  ASSERT_EQ(3u, stats.getLastResults());
+  ASSERT_EQ(1u, stats.getLastMatches());
+  ASSERT_EQ(70u, stats.getLastCPUTime());
+
+  stats.countResult(false, 10);
+  stats.finishScan();
+  ASSERT_EQ(2u, stats.getScans());
+  ASSERT_EQ(1u, stats.getLastResults());
+  ASSERT_EQ(0u, stats.getLastMatches());
+  ASSERT_EQ("last scan: 1 results, 0 matched, 10 us", stats.getStats());
+}
+
+TEST_F(BLEScanStatsTest, finishScan_emptyScan) {
+  stats.finishScan();
+  ASSERT_EQ(0u, stats.getLastResults());
+  ASSERT_EQ(0u, stats.getLastCPUTime());
+}
+
+} // namespace
@@ -24,9 +24,17 @@ Contact: bt-trx.com, mail@bt-trx.com
 #include "serialwrapperMock.h"
 #include "wt32iMock.h"
 
+#include <math.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
 using ::testing::_;
+using ::testing::DoAll;
+using ::testing::Invoke;
 using ::testing::Matcher;
 using ::testing::Return;
+using ::testing::SaveArg;
 using ::testing::SetArgPointee;
 using ::testing::SetArrayArgument;
 using ::testing::StrEq;
@@ -56,6 +64,53 @@ TEST_F(BTTRX_CONTROLTest, action_resetBTPairings_success) {
   ASSERT_EQ(ResultType::kSuccess, bttrx_control.action("resetBTPairings"));
 }
 
+TEST_F(BTTRX_CONTROLTest, action_calibrateGain_setsBestGain) {
+  BTTRX_CONTROL bttrx_control(&serialWrapperMock, &wt32iMock);
+  string dac_gain = "0";
+  EXPECT_CALL(wt32iMock, setAudioGain("0", _))
+      .WillRepeatedly(DoAll(SaveArg<1>(&dac_gain), Return(kSuccess)));
+
+  ASSERT_EQ(ResultType::kSuccess, bttrx_control.action("calibrateGain"));
+  ASSERT_TRUE(bttrx_control.isCalibratingGain());
+  ASSERT_EQ(ResultType::kError, bttrx_control.action("calibrateGain"));
+
+  // -6 dBFS at gain 9, 3 dB per step
+  for (ulong now = 0; now < 10000 && bttrx_control.isCalibratingGain();
+       now += 10) {
+    int gain = stoi(dac_gain, nullptr, 16);
+    bttrx_control.runGainCalibration(
+        now, lround(1026 * pow(10, 3.0 * (gain - 9) / 20)));
+  }
+
+  string value;
+  ASSERT_FALSE(bttrx_control.isCalibratingGain());
+  ASSERT_EQ("9", dac_gain);
+  ASSERT_EQ(ResultType::kSuccess, bttrx_control.get("dac_gain", &value));
+  ASSERT_EQ("9", value);
+  ASSERT_EQ(ResultType::kSuccess,
+            bttrx_control.get("gain_calibration", &value));
+  ASSERT_EQ(0u, value.find("gain 9, peak -6 dBFS (0 dB off)"));
+}
+
+TEST_F(BTTRX_CONTROLTest, action_calibrateGain_restoresGainWithoutSignal) {
+  BTTRX_CONTROL bttrx_control(&serialWrapperMock, &wt32iMock);
+  bttrx_control.storeSetting(kDACGain, "e");
+  string dac_gain;
+  EXPECT_CALL(wt32iMock, setAudioGain("0", _))
+      .WillRepeatedly(DoAll(SaveArg<1>(&dac_gain), Return(kSuccess)));
+
+  ASSERT_EQ(ResultType::kSuccess, bttrx_control.action("calibrateGain"));
+  for (ulong now = 0; now < 10000 && bttrx_control.isCalibratingGain();
+       now += 10) {
+    bttrx_control.runGainCalibration(now, 0);
+  }
+
+  string value;
+  ASSERT_EQ("e", dac_gain);
+  ASSERT_EQ(ResultType::kSuccess, bttrx_control.get("dac_gain", &value));
+  ASSERT_EQ("e", value);
+}
+
 TEST_F(BTTRX_CONTROLTest, set_adc_gain_success) {
   BTTRX_CONTROL bttrx_control(&serialWrapperMock, &wt32iMock);
 
@@ -91,6 +146,162 @@ TEST_F(BTTRX_CONTROLTest, set_ptt_hang_time) {
   ASSERT_EQ(ResultType::kError, bttrx_control.set("ptt_hang_time", "1000"));
 }
 
+TEST_F(BTTRX_CONTROLTest, set_ptt_mode) {
+  BTTRX_CONTROL bttrx_control(&serialWrapperMock, &wt32iMock);
+
+  ASSERT_EQ(ResultType::kSuccess, bttrx_control.set("ptt_mode", "4"));
+  ASSERT_EQ(ResultType::kError, bttrx_control.set("ptt_mode", "5"));
+}
+
+TEST_F(BTTRX_CONTROLTest, set_vox_threshold) {
+  BTTRX_CONTROL bttrx_control(&serialWrapperMock, &wt32iMock);
+
+  ASSERT_EQ(ResultType::kError, bttrx_control.set("vox_threshold", "0"));
+  ASSERT_EQ(ResultType::kSuccess, bttrx_control.set("vox_threshold", "1"));
+  ASSERT_EQ(ResultType::kSuccess, bttrx_control.set("vox_threshold", "2047"));
+  ASSERT_EQ(ResultType::kError, bttrx_control.set("vox_threshold", "2048"));
+}
+
+TEST_F(BTTRX_CONTROLTest, set_vox_hang_time) {
+  BTTRX_CONTROL bttrx_control(&serialWrapperMock, &wt32iMock);
+
+  ASSERT_EQ(ResultType::kSuccess, bttrx_control.set("vox_hang_time", "0"));
+  ASSERT_EQ(ResultType::kSuccess, bttrx_control.set("vox_hang_time", "5000"));
+  ASSERT_EQ(ResultType::kError, bttrx_control.set("vox_hang_time", "5001"));
+}
+
+TEST_F(BTTRX_CONTROLTest, set_ctcss_tone) {
+  BTTRX_CONTROL bttrx_control(&serialWrapperMock, &wt32iMock);
+
+  ASSERT_EQ(ResultType::kSuccess, bttrx_control.set("ctcss_tone", "0"));
+  ASSERT_EQ(ResultType::kSuccess, bttrx_control.set("ctcss_tone", "885"));
+  ASSERT_EQ(ResultType::kError, bttrx_control.set("ctcss_tone", "880"));
+}
+
+TEST_F(BTTRX_CONTROLTest, set_countsSettingsRevision) {
+  BTTRX_CONTROL bttrx_control(&serialWrapperMock, &wt32iMock);
+  uint32_t revision = bttrx_control.getSettingsRevision();
+
+  ASSERT_EQ(ResultType::kError, bttrx_control.set("vox_threshold", "0"));
+  ASSERT_EQ(revision, bttrx_control.getSettingsRevision());
+  ASSERT_EQ(ResultType::kSuccess, bttrx_control.set("vox_threshold", "1"));
+  ASSERT_EQ(revision + 1, bttrx_control.getSettingsRevision());
+  ASSERT_EQ(ResultType::kSuccess, bttrx_control.set("ctcss_tone", "885"));
+  ASSERT_EQ(revision + 2, bttrx_control.getSettingsRevision());
+}
+
+TEST_F(BTTRX_CONTROLTest, set_inquiry_duty_cycle) {
+  BTTRX_CONTROL bttrx_control(&serialWrapperMock, &wt32iMock);
+
+  ASSERT_EQ(ResultType::kError, bttrx_control.set("inquiry_duty_cycle", "0"));
+  ASSERT_EQ(ResultType::kSuccess, bttrx_control.set("inquiry_duty_cycle", "1"));
+  ASSERT_EQ(ResultType::kSuccess,
+            bttrx_control.set("inquiry_duty_cycle", "100"));
+  ASSERT_EQ(ResultType::kError,
+            bttrx_control.set("inquiry_duty_cycle", "101"));
+}
+
+TEST_F(BTTRX_CONTROLTest, set_inquiry_max_interval) {
+  BTTRX_CONTROL bttrx_control(&serialWrapperMock, &wt32iMock);
+
+  ASSERT_EQ(ResultType::kError, bttrx_control.set("inquiry_max_interval", "9"));
+  ASSERT_EQ(ResultType::kSuccess,
+            bttrx_control.set("inquiry_max_interval", "10"));
+  ASSERT_EQ(ResultType::kSuccess,
+            bttrx_control.set("inquiry_max_interval", "3600"));
+  ASSERT_EQ(ResultType::kError,
+            bttrx_control.set("inquiry_max_interval", "3601"));
+}
+
+TEST_F(BTTRX_CONTROLTest, set_recovery_window) {
+  BTTRX_CONTROL bttrx_control(&serialWrapperMock, &wt32iMock);
+
+  ASSERT_EQ(ResultType::kSuccess, bttrx_control.set("recovery_window", "0"));
+  ASSERT_EQ(ResultType::kSuccess, bttrx_control.set("recovery_window", "600"));
+  ASSERT_EQ(ResultType::kError, bttrx_control.set("recovery_window", "601"));
+}
+
+TEST_F(BTTRX_CONTROLTest, get_publishedValues) {
+  // Values published by the main loop, read-only for the web interface.
+  // Their content is tested where the strings are built
+  struct {
+    ParameterType type;
+    const char *name;
+  } published[] = {{kRecoveryStats, "recovery_stats"},
+                   {kBTFirmware, "bt_firmware"},
+                   {kBTLink, "bt_link"},
+                   {kUARTStats, "uart_stats"},
+                   {kBLEStats, "ble_stats"},
+                   {kBLEButtons, "ble_buttons"},
+                   {kCoexStats, "coex_stats"},
+                   {kAudioLevel, "audio_level"}};
+  BTTRX_CONTROL bttrx_control(&serialWrapperMock, &wt32iMock);
+
+  for (const auto &parameter : published) {
+    string value;
+    bttrx_control.storeSetting(parameter.type, parameter.name);
+    ASSERT_EQ(ResultType::kSuccess, bttrx_control.get(parameter.name, &value))
+        << parameter.name;
+    ASSERT_EQ(parameter.name, value);
+    ASSERT_EQ(ResultType::kError, bttrx_control.set(parameter.name, "0"))
+        << parameter.name;
+  }
+}
+
+TEST_F(BTTRX_CONTROLTest, get_whileMainLoopStores) {
+  BTTRX_CONTROL bttrx_control(&serialWrapperMock, &wt32iMock);
+  const string kShort = "-6,-9";
+  const string kLong = "-60,-90 and a string longer than the SSO buffer";
+  bttrx_control.storeSetting(kAudioLevel, kShort);
+
+  // The main loop publishes, the web server task reads
+  std::thread main_loop([&]() {
+    for (int i = 0; i < 10000; i++) {
+      bttrx_control.storeSetting(kAudioLevel, i % 2 ? kLong : kShort);
+    }
+  });
+  for (int i = 0; i < 10000; i++) {
+    string value;
+    bttrx_control.get(kAudioLevel, &value);
+    EXPECT_TRUE(value == kShort || value == kLong) << value;
+  }
+  main_loop.join();
+}
+
+TEST_F(BTTRX_CONTROLTest, set_whileMainLoopSendsBatch) {
+  SerialMock *serialMock = serialMockInstance();
+  SerialWrapper serial(&Serial);
+  WT32i wt32i(&serial);
+  BTTRX_CONTROL bttrx_control(&serial, &wt32i);
+  const string kBatch = "STATUS service 1\r\nSTATUS signal 5\r\n";
+  const string kGain = "SET CONTROL GAIN 0 5\r\n";
+
+  // Only called with the serial mutex held
+  std::vector<string> writes;
+  EXPECT_CALL(*serialMock, print(Matcher<const char *>(_)))
+      .WillRepeatedly(Invoke([&](const char *text) {
+        writes.push_back(text);
+        return strlen(text);
+      }));
+
+  // The main loop sends batches, the web server task sets the DAC gain
+  std::thread main_loop([&]() {
+    for (int i = 0; i < 1000; i++) {
+      wt32i.sendLines({"STATUS service 1", "STATUS signal 5"});
+    }
+  });
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_EQ(ResultType::kSuccess, bttrx_control.set("dac_gain", "5"));
+  }
+  main_loop.join();
+
+  ASSERT_EQ(2000u, writes.size());
+  for (const string &write : writes) {
+    ASSERT_TRUE(write == kBatch || write == kGain) << write;
+  }
+  releaseSerialMock();
+}
+
 TEST_F(BTTRX_CONTROLTest, get_pin_code_success) {
   BTTRX_CONTROL bttrx_control(&serialWrapperMock, &wt32iMock);
 
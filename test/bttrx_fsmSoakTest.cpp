@@ -0,0 +1,416 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+/*
+Soak test: runs the FSM for a simulated week of randomized events (reconnects,
+calls, PTT, AT command floods, web set/get calls) on a virtual clock and checks
+that neither the heap nor the containers of the WT32i class grow without bound.
+
+The heap is tracked by replacing the global operator new/delete with
+counting versions. The test is built as its own executable (test-soak), so no
+other test runs with them.
+*/
+
+#include "arduino-mock/Arduino.h"
+#include "arduino-mock/Serial.h"
+#include "gtest/gtest.h"
+
+#include "../src/bttrx_fsm.h"
+#include "fsmEnvironment.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+#include <random>
+
+using ::testing::_;
+using ::testing::Invoke;
+
+// Defined by bttrx_controlTest.cpp in test-all
+Preferences preferences;
+
+namespace {
+// Each block starts with the bytes it was counted with, 0 if it was
+// allocated while counting was off
+struct alignas(std::max_align_t) HeapHeader {
+  size_t counted_bytes;
+};
+
+std::atomic<bool> heap_counting{false};
+std::atomic<size_t> heap_live_bytes{0};
+std::atomic<size_t> heap_peak_bytes{0};
+} // namespace
+
+void *operator new(size_t size) {
+  HeapHeader *header = (HeapHeader *)malloc(sizeof(HeapHeader) + size);
+  if (header == NULL) {
+    throw std::bad_alloc();
+  }
+  header->counted_bytes = 0;
+  if (heap_counting) {
+    header->counted_bytes = malloc_usable_size(header);
+    size_t live = heap_live_bytes += header->counted_bytes;
+    size_t peak = heap_peak_bytes;
+    while (live > peak && !heap_peak_bytes.compare_exchange_weak(peak, live))
+      ;
+  }
+  return header + 1;
+}
+
+void operator delete(void *ptr) noexcept {
+  if (ptr == NULL) {
+    return;
+  }
+  HeapHeader *header = (HeapHeader *)ptr - 1;
+  heap_live_bytes -= header->counted_bytes;
+  free(header);
+}
+
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete[](void *ptr) noexcept { operator delete(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { operator delete(ptr); }
+
+namespace {
+const ulong kHour = 3600UL * 1000UL;
+const ulong kDay = 24 * kHour;
+const int kSimulatedDays = 7;
+
+// Upper bounds the containers of the WT32i class have to stay below
+const size_t kMaxInquiredDevices = 32;
+const size_t kMaxActiveConnections = 7;
+const size_t kMaxHFPStatusCount = 8;
+// Allowed growth of the live heap between the end of day 1 and the end of
+// the simulation
+const size_t kMaxHeapGrowth = 4096; // bytes
+
+const char *kHFPIndicators[] = {"service", "call", "callsetup", "callheld",
+                                "signal",  "roam", "battchg"};
+const char *kATCommands[] = {"AT+CSQ",  "AT+CBC",   "AT+COPS?", "AT+CREG?",
+                             "AT+CIND", "AT+CLCC", "AT+BTRH?", "AT+FOO"};
+
+/**
+ * @brief Fraction of the malloc arena that is free but not returned to the
+ * system, as an indicator for heap fragmentation
+ */
+double heapFragmentation() {
+#if defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 33)
+  struct mallinfo2 info = mallinfo2();
+#else
+  struct mallinfo info = mallinfo();
+#endif
+  if (info.arena == 0) {
+    return 0;
+  }
+  return (double)info.fordblks / info.arena;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * @brief Simulated environment of the FSM: virtual clock, WT32i module,
+ * HFP device, buttons and web interface
+ */
+class SoakSimulation : public FSMEnvironment {
+public:
+  SoakSimulation(BTTRX_FSM *fsm, unsigned seed) : fsm_(fsm), rng_(seed) {}
+
+  void step();
+
+private:
+  BTTRX_FSM *fsm_;
+  std::mt19937 rng_;
+  BTTRX_FSM::state_t last_state_ = BTTRX_FSM::STATE_INIT;
+  bool answered_ = false;
+  int ptt_hold_steps_ = 0;
+
+  bool chance(double probability) {
+    return std::uniform_real_distribution<double>(0, 1)(rng_) < probability;
+  }
+  int randomInt(int min, int max) {
+    return std::uniform_int_distribution<int>(min, max)(rng_);
+  }
+  string randomAddress() {
+    char address[18];
+    snprintf(address, sizeof(address), "de:ad:be:ef:00:%02x", randomInt(0, 23));
+    return address;
+  }
+  void simulateModule(BTTRX_FSM::state_t, bool);
+  void simulateButtons(BTTRX_FSM::state_t);
+  void simulateWebInterface();
+};
+
+/**
+ * @brief Advance the virtual clock and inject random events according to the
+ * current FSM state
+ */
+void SoakSimulation::step() {
+  now_ms += randomInt(100, 20000);
+
+  BTTRX_FSM::state_t state = fsm_->getCurrentState();
+  bool entered = state != last_state_;
+  last_state_ = state;
+  if (entered) {
+    answered_ = false;
+  }
+
+  simulateModule(state, entered);
+  simulateButtons(state);
+  simulateWebInterface();
+
+  // Let the FSM consume all pending lines
+  for (int i = 0; i < 64; i++) {
+    fsm_->run();
+    if (rx_lines.empty()) {
+      break;
+    }
+  }
+}
+
+void SoakSimulation::simulateModule(BTTRX_FSM::state_t state, bool entered) {
+  switch (state) {
+  case BTTRX_FSM::STATE_INIT:
+    rx_lines.push_back("WRAP THOR AI (6.1.0 build 1119)");
+    rx_lines.push_back("READY.");
+    break;
+  case BTTRX_FSM::STATE_CONFIGURE:
+    rx_lines.push_back("SET CONTROL GAIN 8 10");
+    rx_lines.push_back("SET BT BDADDR 00:07:80:12:34:56");
+    rx_lines.push_back("SET BT AUTH * 0000");
+    rx_lines.push_back("SET");
+    rx_lines.push_back("LIST 0");
+    break;
+  case BTTRX_FSM::STATE_INQUIRY:
+    if (chance(0.03)) {
+      // Incoming connection of an already paired device
+      rx_lines.push_back("HFP-AG 0 READY");
+    } else if (fsm_->getWT32i()->inquiryRunning() && chance(0.5)) {
+      int num_results = randomInt(0, 4);
+      for (int i = 0; i < num_results; i++) {
+        rx_lines.push_back("INQUIRY_PARTIAL " + randomAddress() + " 240404");
+      }
+      rx_lines.push_back("INQUIRY " + to_string(num_results));
+      for (int i = 0; i < num_results; i++) {
+        rx_lines.push_back("INQUIRY " + randomAddress() + " 240404");
+      }
+    }
+    break;
+  case BTTRX_FSM::STATE_CONNECTING:
+    if (!answered_) {
+      answered_ = true;
+      rx_lines.push_back(chance(0.85) ? "HFP-AG 0 READY"
+                                      : "NO CARRIER 0 ERROR 0");
+    }
+    break;
+  case BTTRX_FSM::STATE_CONNECTED:
+    if (entered) {
+      string address = randomAddress();
+      rx_lines.push_back("LIST 1");
+      rx_lines.push_back("LIST 0 CONNECTED HFP-AG 667 0 0 7 8d 8d " + address +
+                         " 3 OUTGOING ACTIVE MASTER ENCRYPTED 0");
+      rx_lines.push_back("NAME " + address + " \"Headset\"");
+    }
+    if (chance(0.1)) {
+      // AT command flood
+      int num_commands = randomInt(1, 20);
+      for (int i = 0; i < num_commands; i++) {
+        rx_lines.push_back(string("HFP-AG 0 UNKNOWN (0): ") +
+                           kATCommands[randomInt(0, 7)] + "\\r");
+      }
+    }
+    if (chance(0.2)) {
+      fsm_->getWT32i()->storeHFPStatus(string("HFP 0 STATUS \"") +
+                                       kHFPIndicators[randomInt(0, 6)] +
+                                       "\" " + to_string(randomInt(0, 5)));
+    }
+    if (isPressed(PIN_PTT_IN) && ptt_hold_steps_ >= 2 && !answered_) {
+      // FSM saw the PTT press and dialed, HFP device accepts the call
+      answered_ = true;
+      rx_lines.push_back("HFP-AG 0 CALLING");
+      rx_lines.push_back("HFP-AG 0 CONNECT");
+    }
+    if (chance(0.005)) {
+      rx_lines.push_back("NO CARRIER 0 ERROR 0");
+    }
+    break;
+  case BTTRX_FSM::STATE_CALL_RUNNING:
+    if (chance(0.05)) {
+      rx_lines.push_back("HFP-AG 0 NO CARRIER");
+      rx_lines.push_back("NO CARRIER 1 ERROR 0");
+    } else if (chance(0.002)) {
+      rx_lines.push_back("NO CARRIER 0 ERROR 0");
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+void SoakSimulation::simulateButtons(BTTRX_FSM::state_t state) {
+  if (ptt_hold_steps_ > 0) {
+    ptt_hold_steps_++;
+    if (chance(0.3)) {
+      setPressed(PIN_PTT_IN, false);
+      ptt_hold_steps_ = 0;
+    }
+  } else if (chance(state == BTTRX_FSM::STATE_CALL_RUNNING ? 0.3 : 0.05)) {
+    setPressed(PIN_PTT_IN, true);
+    ptt_hold_steps_ = 1;
+  }
+}
+
+void SoakSimulation::simulateWebInterface() {
+  if (!chance(0.02)) {
+    return;
+  }
+  string value;
+  switch (randomInt(0, 5)) {
+  case 0:
+    fsm_->bttrx_control_.set("adc_gain", to_string(randomInt(0, 16)));
+    break;
+  case 1:
+    fsm_->bttrx_control_.set("dac_gain", to_string(randomInt(0, 16)));
+    break;
+  case 2:
+    fsm_->bttrx_control_.set("ptt_hang_time", to_string(randomInt(0, 999)));
+    break;
+  case 3:
+    fsm_->bttrx_control_.set("pin_code", "2342");
+    break;
+  case 4:
+    fsm_->bttrx_control_.get("statusmessage", &value);
+    break;
+  default:
+    fsm_->bttrx_control_.get("ptt_mode", &value);
+    break;
+  }
+}
+
+struct SoakSample {
+  size_t live_bytes;
+  size_t peak_bytes;
+  double fragmentation;
+  size_t inquired_devices;
+  size_t active_connections;
+  size_t hfp_status_count;
+};
+
+class BTTRX_FSMSoakTest : public ::testing::Test {
+protected:
+  ArduinoMock *arduinoMock;
+  SerialMock *serialMock;
+  string gmock_verbose;
+
+  BTTRX_FSMSoakTest() {}
+
+  virtual ~BTTRX_FSMSoakTest() {}
+
+  virtual void SetUp() {
+    arduinoMock = arduinoMockInstance();
+    serialMock = serialMockInstance();
+
+    // Millions of uninteresting mock calls are expected, do not log them
+    gmock_verbose = ::testing::FLAGS_gmock_verbose;
+    ::testing::FLAGS_gmock_verbose = "error";
+
+    // Settings read from the (global) preferences mock: PTT mode "Direct",
+    // PTT timeout 1 minute, hang time 1 ms
+    ::testing::DefaultValue<uint16_t>::Set(1);
+    heap_counting = true;
+  }
+
+  virtual void TearDown() {
+    heap_counting = false;
+    ::testing::DefaultValue<uint16_t>::Clear();
+    ::testing::FLAGS_gmock_verbose = gmock_verbose;
+    releaseSerialMock();
+    releaseArduinoMock();
+  }
+
+  SoakSample sample(BTTRX_FSM *fsm) {
+    SoakSample result;
+    result.live_bytes = heap_live_bytes;
+    result.peak_bytes = heap_peak_bytes;
+    result.fragmentation = heapFragmentation();
+    result.inquired_devices = fsm->getInquiryCache()->size();
+    result.active_connections = fsm->getWT32i()->getActiveConnections().size();
+    result.hfp_status_count = fsm->getWT32i()->getHFPStatusCount();
+    return result;
+  }
+};
+
+TEST_F(BTTRX_FSMSoakTest, Run_OneWeek_MemoryBounded) {
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  SoakSimulation sim(&bttrx_fsm, 73);
+
+  EXPECT_CALL(*arduinoMock, millis())
+      .WillRepeatedly(Invoke(VirtualMillis{&sim}));
+  EXPECT_CALL(*arduinoMock, digitalRead(_))
+      .WillRepeatedly(Invoke(VirtualDigitalRead{&sim}));
+  EXPECT_CALL(*serialMock, readBytesUntil(_, _, _))
+      .WillRepeatedly(Invoke(VirtualReadLine{&sim}));
+
+  SoakSample max_sample = sample(&bttrx_fsm);
+  SoakSample day_one = max_sample;
+  ulong next_sample = kHour;
+  int day = 0;
+
+  while (sim.now_ms < kSimulatedDays * kDay) {
+    sim.step();
+    if (sim.now_ms < next_sample) {
+      continue;
+    }
+    next_sample += kHour;
+
+    SoakSample current = sample(&bttrx_fsm);
+    max_sample.inquired_devices =
+        std::max(max_sample.inquired_devices, current.inquired_devices);
+    max_sample.active_connections =
+        std::max(max_sample.active_connections, current.active_connections);
+    max_sample.hfp_status_count =
+        std::max(max_sample.hfp_status_count, current.hfp_status_count);
+
+    if (sim.now_ms / kDay > (ulong)day) {
+      day = sim.now_ms / kDay;
+      if (day == 1) {
+        day_one = current;
+      }
+      // The bound holds at the end of every day, not only the last one
+      EXPECT_LE(current.live_bytes, day_one.live_bytes + kMaxHeapGrowth)
+          << "day " << day;
+    }
+  }
+  SoakSample last = sample(&bttrx_fsm);
+  RecordProperty("heap_live_bytes", (int)last.live_bytes);
+  RecordProperty("heap_peak_bytes", (int)last.peak_bytes);
+  RecordProperty("heap_fragmentation_permille",
+                 (int)(last.fragmentation * 1000));
+
+  ASSERT_LE(max_sample.inquired_devices, kMaxInquiredDevices);
+  ASSERT_LE(max_sample.active_connections, kMaxActiveConnections);
+  ASSERT_LE(max_sample.hfp_status_count, kMaxHFPStatusCount);
+  ASSERT_LE(last.live_bytes, day_one.live_bytes + kMaxHeapGrowth);
+}
+} // namespace
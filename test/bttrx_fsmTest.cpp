@@ -23,6 +23,11 @@ Contact: bt-trx.com, mail@bt-trx.com
 #include "gtest/gtest.h"
 
 #include "../src/bttrx_fsm.h"
+#include "fsmEnvironment.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
 
 using ::testing::_;
 using ::testing::AtLeast;
@@ -33,6 +38,71 @@ using ::testing::SetArrayArgument;
 using ::testing::StrEq;
 
 namespace {
+/**
+ * @brief Environment of the FSM, additionally recording the lines sent to
+ * the WT32i module
+ */
+struct ScriptedEnvironment : public FSMEnvironment {
+  std::vector<string> tx_lines;
+  std::vector<string> tx_writes;
+};
+
+// Rates the UART got reopened with
+std::vector<uint32_t> baud_rates;
+void recordBaudRate(uint32_t baud_rate) { baud_rates.push_back(baud_rate); }
+
+/**
+ * @brief Serial::print(): lines sent to the module end with CRLF, the
+ * "> " prefix of the debug copy does not
+ */
+struct ScriptedWriteLine {
+  ScriptedEnvironment *env;
+  size_t operator()(const char *output) {
+    string lines = output;
+    env->tx_writes.push_back(lines);
+    size_t start = 0;
+    size_t end;
+    while ((end = lines.find("\r\n", start)) != string::npos) {
+      env->tx_lines.push_back(lines.substr(start, end - start));
+      start = end + 2;
+    }
+    return lines.length();
+  }
+};
+
+/**
+ * @brief Preferences::getBytes(): recently used devices stored as packed
+ * addresses
+ */
+struct StoredPeers {
+  std::vector<string> addresses;
+  size_t operator()(const char *key, void *buffer, size_t max_length) {
+    size_t length = 0;
+    if (strcmp(key, "bt_peers") != 0) {
+      return 0;
+    }
+    for (string address : addresses) {
+      if (length + BD_ADDRESS_SIZE > max_length) {
+        break;
+      }
+      PeerList::packAddress(address, (uint8_t *)buffer + length);
+      length += BD_ADDRESS_SIZE;
+    }
+    return length;
+  }
+};
+
+/**
+ * @brief Preferences::getBytes(): cached BD address of the module
+ */
+struct StoredBDAddress {
+  string address;
+  size_t operator()(const char *, void *buffer, size_t) {
+    PeerList::packAddress(address, (uint8_t *)buffer);
+    return BD_ADDRESS_SIZE;
+  }
+};
+
 class BTTRX_FSMTest : public ::testing::Test {
 protected:
   ArduinoMock *arduinoMock;
@@ -48,9 +118,125 @@ protected:
   }
 
   virtual void TearDown() {
+    ::testing::DefaultValue<uint16_t>::Clear();
     releaseSerialMock();
     releaseArduinoMock();
   }
+
+  ScriptedEnvironment env;
+  Preferences preferencesMock;
+
+  void useScriptedEnvironment() {
+    EXPECT_CALL(*arduinoMock, millis())
+        .WillRepeatedly(Invoke(VirtualMillis{&env}));
+    EXPECT_CALL(*arduinoMock, digitalRead(_))
+        .WillRepeatedly(Invoke(VirtualDigitalRead{&env}));
+    EXPECT_CALL(*serialMock, readBytesUntil(_, _, _))
+        .WillRepeatedly(Invoke(VirtualReadLine{&env}));
+    EXPECT_CALL(*serialMock, print(Matcher<const char *>(_)))
+        .WillRepeatedly(Invoke(ScriptedWriteLine{&env}));
+    EXPECT_CALL(*serialMock, println(Matcher<const char *>(_)))
+        .Times(AtLeast(0));
+  }
+
+  size_t countSent(string line) {
+    return std::count(env.tx_lines.begin(), env.tx_lines.end(), line);
+  }
+
+  // Let the FSM consume all pending lines
+  void runUntilIdle(BTTRX_FSM *fsm) {
+    for (int i = 0; i < 64; i++) {
+      fsm->run();
+      if (env.rx_lines.empty()) {
+        break;
+      }
+    }
+    fsm->run();
+  }
+
+  // Pulse the reset of the module and let it print its boot banner
+  void boot(BTTRX_FSM *fsm) {
+    fsm->run();
+    env.now_ms += BT_RESET_PULSE;
+    fsm->run();
+    env.rx_lines.push_back("WRAP THOR AI (6.1.0 build 1119)");
+    env.rx_lines.push_back("Copyright (c) 2003-2016 Silicon Labs Inc.");
+    env.rx_lines.push_back("READY.");
+    runUntilIdle(fsm);
+  }
+
+  // Bring the FSM up to the end of the configuration
+  void configure(BTTRX_FSM *fsm, std::vector<string> peers) {
+    ON_CALL(preferencesMock, getBytes(_, _, _))
+        .WillByDefault(Invoke(StoredPeers{peers}));
+    *fsm->getPeerList() = PeerList(&preferencesMock);
+    boot(fsm);
+    // Settings read back, the differences get written and verified
+    env.rx_lines.push_back("SET BT BDADDR 00:07:80:12:34:56");
+    env.rx_lines.push_back("SET");
+    env.rx_lines.push_back("SET");
+    runUntilIdle(fsm);
+  }
+
+  // Bring the FSM up and establish HFP-AG links 0 (Primary) and 1 (Backup)
+  void connectTwoLinks(BTTRX_FSM *fsm) {
+    configure(fsm, {});
+    ASSERT_EQ(BTTRX_FSM::STATE_INQUIRY, fsm->getCurrentState());
+
+    env.rx_lines.push_back("HFP-AG 0 READY");
+    env.rx_lines.push_back("LIST 0 CONNECTED HFP-AG 667 0 0 7 8d 8d "
+                           "de:ad:be:ef:00:01 3 INCOMING ACTIVE MASTER "
+                           "ENCRYPTED 0");
+    env.rx_lines.push_back("NAME de:ad:be:ef:00:01 \"Primary\"");
+    env.rx_lines.push_back("HFP-AG 1 READY");
+    env.rx_lines.push_back("LIST 1 CONNECTED HFP-AG 667 0 0 7 8d 8d "
+                           "de:ad:be:ef:00:02 3 INCOMING ACTIVE MASTER "
+                           "ENCRYPTED 0");
+    env.rx_lines.push_back("NAME de:ad:be:ef:00:02 \"Backup\"");
+    runUntilIdle(fsm);
+  }
+
+  // Bring the FSM up and establish a single HFP-AG link 0
+  void connectOneLink(BTTRX_FSM *fsm) {
+    configure(fsm, {});
+    env.rx_lines.push_back("HFP-AG 0 READY");
+    env.rx_lines.push_back("LIST 0 CONNECTED HFP-AG 667 0 0 7 8d 8d "
+                           "de:ad:be:ef:00:01 3 INCOMING ACTIVE MASTER "
+                           "ENCRYPTED 0");
+    runUntilIdle(fsm);
+    ASSERT_EQ(BTTRX_FSM::STATE_CONNECTED, fsm->getCurrentState());
+  }
+
+  // Play DTMF digits of 100 ms, 50 ms apart, into the tone detector
+  void sendDTMF(BTTRX_FSM *fsm, string digits) {
+    const double rows[4] = {697, 770, 852, 941};
+    const double columns[4] = {1209, 1336, 1477, 1633};
+    const char *keys = "123A456B789C*0#D";
+    for (char key : digits) {
+      int index = strchr(keys, key) - keys;
+      for (int t = 0; t < VOX_SAMPLE_RATE / 10; t++) {
+        double time = (double)t / VOX_SAMPLE_RATE;
+        fsm->getToneDetector()->process(
+            lround(500 * sin(2 * M_PI * rows[index / 4] * time) +
+                   500 * sin(2 * M_PI * columns[index % 4] * time)));
+      }
+      for (int t = 0; t < VOX_SAMPLE_RATE / 20; t++) {
+        fsm->getToneDetector()->process(0);
+      }
+    }
+  }
+
+  void pressHelperButton(BTTRX_FSM *fsm, ulong duration) {
+    env.setPressed(PIN_BTN_0, true);
+    fsm->run();
+    env.now_ms += 100; // debounce
+    fsm->run();
+    env.now_ms += duration;
+    env.setPressed(PIN_BTN_0, false);
+    fsm->run();
+    env.now_ms += 100;
+    fsm->run();
+  }
 };
 
 TEST_F(BTTRX_FSMTest, Run_StateInit_Success1) {
@@ -59,4 +245,751 @@ TEST_F(BTTRX_FSMTest, Run_StateInit_Success1) {
 
   ASSERT_EQ(BTTRX_FSM::state_t::STATE_INIT, bttrx_fsm.getCurrentState());
 }
-} // namespace
\ No newline at end of file
+
+TEST_F(BTTRX_FSMTest, Run_MultiLink_FirstLinkIsActive) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  connectTwoLinks(&bttrx_fsm);
+
+  string status;
+  bttrx_fsm.bttrx_control_.get("statusmessage", &status);
+  ASSERT_EQ(BTTRX_FSM::STATE_CONNECTED, bttrx_fsm.getCurrentState());
+  ASSERT_EQ(2, bttrx_fsm.getConnectedLinkCount());
+  ASSERT_EQ(0, bttrx_fsm.getActiveLink());
+  ASSERT_EQ("Connected to Primary (+1)", status);
+}
+
+TEST_F(BTTRX_FSMTest, Run_CallRunning_DTMFHangup) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  connectOneLink(&bttrx_fsm);
+  env.now_ms += 100; // Debounce the released helper button
+  bttrx_fsm.run();
+  env.rx_lines.push_back("HFP-AG 0 CALLING");
+  env.rx_lines.push_back("HFP-AG 0 CONNECT");
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_EQ(BTTRX_FSM::STATE_CALL_RUNNING, bttrx_fsm.getCurrentState());
+
+  sendDTMF(&bttrx_fsm, "*1#");
+  bttrx_fsm.run();
+  ASSERT_EQ(0u, countSent("HANGUP"));
+
+  sendDTMF(&bttrx_fsm, "*73#");
+  bttrx_fsm.run();
+  ASSERT_EQ(1u, countSent("HANGUP"));
+}
+
+TEST_F(BTTRX_FSMTest, Run_MultiLink_LongPressSwitchesLink) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  connectTwoLinks(&bttrx_fsm);
+
+  pressHelperButton(&bttrx_fsm, LINK_SWITCH_PRESS_DURATION + 200);
+  ASSERT_EQ(1, bttrx_fsm.getActiveLink());
+
+  pressHelperButton(&bttrx_fsm, LINK_SWITCH_PRESS_DURATION + 200);
+  ASSERT_EQ(0, bttrx_fsm.getActiveLink());
+  ASSERT_EQ(BTTRX_FSM::STATE_CONNECTED, bttrx_fsm.getCurrentState());
+}
+
+TEST_F(BTTRX_FSMTest, Run_MultiLink_CallingLinkBecomesActive) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  connectTwoLinks(&bttrx_fsm);
+
+  env.rx_lines.push_back("HFP-AG 1 CALLING");
+  env.rx_lines.push_back("HFP-AG 1 CONNECT");
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_EQ(BTTRX_FSM::STATE_CALL_RUNNING, bttrx_fsm.getCurrentState());
+  ASSERT_EQ(1, bttrx_fsm.getActiveLink());
+
+  env.rx_lines.push_back("HFP-AG 1 NO CARRIER");
+  env.rx_lines.push_back("NO CARRIER 2 ERROR 0");
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_EQ(BTTRX_FSM::STATE_CONNECTED, bttrx_fsm.getCurrentState());
+  ASSERT_EQ(2, bttrx_fsm.getConnectedLinkCount());
+}
+
+TEST_F(BTTRX_FSMTest, Run_MultiLink_CommandsAddressTheLink) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  connectTwoLinks(&bttrx_fsm);
+  env.now_ms += 100; // Debounce the released helper button
+  bttrx_fsm.run();
+
+  env.rx_lines.push_back("HFP-AG 1 CALLING");
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_EQ(1u, countSent("CONNECT 1"));
+
+  env.rx_lines.push_back("CONNECT 2 SCO");
+  env.rx_lines.push_back("HFP-AG 1 CONNECT");
+  runUntilIdle(&bttrx_fsm);
+  pressHelperButton(&bttrx_fsm, 100);
+  ASSERT_EQ(1u, countSent("HANGUP 1"));
+
+  env.rx_lines.push_back("HFP-AG 1 NO CARRIER");
+  env.rx_lines.push_back("NO CARRIER 2 ERROR 0");
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_EQ(BTTRX_FSM::STATE_CONNECTED, bttrx_fsm.getCurrentState());
+  pressHelperButton(&bttrx_fsm, 100);
+  ASSERT_EQ(1u, countSent("DIALING 1"));
+}
+
+TEST_F(BTTRX_FSMTest, Run_MultiLink_SwitchMovesCall) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  connectTwoLinks(&bttrx_fsm);
+  env.now_ms += 100;
+  bttrx_fsm.run();
+
+  env.rx_lines.push_back("HFP-AG 0 CALLING");
+  env.rx_lines.push_back("CONNECT 2 SCO");
+  env.rx_lines.push_back("HFP-AG 0 CONNECT");
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_EQ(BTTRX_FSM::STATE_CALL_RUNNING, bttrx_fsm.getCurrentState());
+
+  pressHelperButton(&bttrx_fsm, LINK_SWITCH_PRESS_DURATION + 200);
+  ASSERT_EQ(1, bttrx_fsm.getActiveLink());
+  ASSERT_EQ(1u, countSent("CLOSE 2"));
+  ASSERT_EQ(1u, countSent("SCO OPEN 1"));
+
+  // The call runs on link 1 now
+  pressHelperButton(&bttrx_fsm, 100);
+  ASSERT_EQ(1u, countSent("HANGUP 1"));
+  ASSERT_EQ(0u, countSent("HANGUP 0"));
+}
+
+TEST_F(BTTRX_FSMTest, Run_SingleLink_HelperButtonDialsOnPress) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  connectOneLink(&bttrx_fsm);
+  env.now_ms += 100;
+  bttrx_fsm.run();
+
+  env.setPressed(PIN_BTN_0, true);
+  bttrx_fsm.run();
+  env.now_ms += 100; // debounce
+  bttrx_fsm.run();
+  ASSERT_EQ(1u, countSent("DIALING"));
+}
+
+TEST_F(BTTRX_FSMTest, Run_MultiLink_LinkLossFallsBackToRemainingLink) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  connectTwoLinks(&bttrx_fsm);
+
+  env.rx_lines.push_back("NO CARRIER 0 ERROR 0");
+  runUntilIdle(&bttrx_fsm);
+
+  string status;
+  bttrx_fsm.bttrx_control_.get("statusmessage", &status);
+  ASSERT_EQ(BTTRX_FSM::STATE_CONNECTED, bttrx_fsm.getCurrentState());
+  ASSERT_EQ(1, bttrx_fsm.getActiveLink());
+  ASSERT_EQ("Connected to Backup", status);
+
+  env.rx_lines.push_back("NO CARRIER 1 ERROR 0");
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_EQ(BTTRX_FSM::STATE_INQUIRY, bttrx_fsm.getCurrentState());
+  ASSERT_EQ(-1, bttrx_fsm.getActiveLink());
+  ASSERT_EQ(0, bttrx_fsm.getConnectedLinkCount());
+}
+
+TEST_F(BTTRX_FSMTest, Run_Paging_NoKnownDevices) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  configure(&bttrx_fsm, {});
+
+  ASSERT_EQ(BTTRX_FSM::STATE_INQUIRY, bttrx_fsm.getCurrentState());
+}
+
+TEST_F(BTTRX_FSMTest, Run_Paging_ConnectsToSecondDevice) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  configure(&bttrx_fsm, {"de:ad:be:ef:00:01", "de:ad:be:ef:00:02"});
+
+  string status;
+  bttrx_fsm.bttrx_control_.get("statusmessage", &status);
+  ASSERT_EQ(BTTRX_FSM::STATE_PAGING, bttrx_fsm.getCurrentState());
+  ASSERT_EQ("Reconnecting to de:ad:be:ef:00:01", status);
+
+  // First device does not answer
+  env.rx_lines.push_back("CALL 0");
+  env.rx_lines.push_back("NO CARRIER 0 ERROR 0");
+  runUntilIdle(&bttrx_fsm);
+  bttrx_fsm.bttrx_control_.get("statusmessage", &status);
+  ASSERT_EQ(BTTRX_FSM::STATE_PAGING, bttrx_fsm.getCurrentState());
+  ASSERT_EQ("Reconnecting to de:ad:be:ef:00:02", status);
+
+  env.rx_lines.push_back("CALL 0");
+  env.rx_lines.push_back("HFP-AG 0 READY");
+  runUntilIdle(&bttrx_fsm);
+  bttrx_fsm.bttrx_control_.get("statusmessage", &status);
+  ASSERT_EQ(BTTRX_FSM::STATE_CONNECTED, bttrx_fsm.getCurrentState());
+  ASSERT_EQ("Connected to de:ad:be:ef:00:02", status);
+  ASSERT_EQ("de:ad:be:ef:00:02", bttrx_fsm.getPeerList()->at(0));
+}
+
+TEST_F(BTTRX_FSMTest, Run_Paging_IncomingLinkLearnsItsAddress) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  configure(&bttrx_fsm, {"de:ad:be:ef:00:01"});
+  ASSERT_EQ(BTTRX_FSM::STATE_PAGING, bttrx_fsm.getCurrentState());
+
+  // Another device connects while the page is outstanding
+  env.rx_lines.push_back("HFP-AG 1 READY");
+  env.rx_lines.push_back("LIST 1 CONNECTED HFP-AG 667 0 0 7 8d 8d "
+                         "de:ad:be:ef:00:05 3 INCOMING ACTIVE MASTER "
+                         "ENCRYPTED 0");
+  runUntilIdle(&bttrx_fsm);
+
+  string status;
+  bttrx_fsm.bttrx_control_.get("statusmessage", &status);
+  ASSERT_EQ(BTTRX_FSM::STATE_CONNECTED, bttrx_fsm.getCurrentState());
+  ASSERT_EQ("Connected to de:ad:be:ef:00:05", status);
+  ASSERT_EQ("de:ad:be:ef:00:05", bttrx_fsm.getPeerList()->at(0));
+}
+
+TEST_F(BTTRX_FSMTest, Run_Paging_TimeoutFallsBackToInquiry) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  configure(&bttrx_fsm, {"de:ad:be:ef:00:01", "de:ad:be:ef:00:02"});
+
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(BTTRX_FSM::STATE_PAGING, bttrx_fsm.getCurrentState());
+    env.now_ms += PAGE_TIMEOUT + 1;
+    runUntilIdle(&bttrx_fsm);
+  }
+  ASSERT_EQ(BTTRX_FSM::STATE_INQUIRY, bttrx_fsm.getCurrentState());
+}
+
+TEST_F(BTTRX_FSMTest, Run_Paging_TimeoutClosesUnansweredPage) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  configure(&bttrx_fsm, {"de:ad:be:ef:00:01", "de:ad:be:ef:00:02"});
+  size_t lists = countSent("LIST");
+
+  // No CALL reply, the link id of the page is unknown
+  env.now_ms += PAGE_TIMEOUT + 1;
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_EQ(lists + 1, countSent("LIST"));
+
+  env.rx_lines.push_back("LIST 1");
+  env.rx_lines.push_back("LIST 0 CONNECTED HFP-AG 667 0 0 7 8d 8d "
+                         "de:ad:be:ef:00:01 3 OUTGOING ACTIVE MASTER "
+                         "ENCRYPTED 0");
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_EQ(1u, countSent("CLOSE 0"));
+  ASSERT_EQ(BTTRX_FSM::STATE_PAGING, bttrx_fsm.getCurrentState());
+}
+
+TEST_F(BTTRX_FSMTest, Run_MultiLink_ListPollDoesNotWritePeers) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  // Each link is stored once, when its address is learned
+  EXPECT_CALL(preferencesMock, putBytes(_, _, _)).Times(2);
+  connectTwoLinks(&bttrx_fsm);
+
+  for (int i = 0; i < 3; i++) {
+    env.rx_lines.push_back("LIST 2");
+    env.rx_lines.push_back("LIST 0 CONNECTED HFP-AG 667 0 0 7 8d 8d "
+                           "de:ad:be:ef:00:01 3 INCOMING ACTIVE MASTER "
+                           "ENCRYPTED 0");
+    env.rx_lines.push_back("LIST 1 CONNECTED HFP-AG 667 0 0 7 8d 8d "
+                           "de:ad:be:ef:00:02 3 INCOMING ACTIVE MASTER "
+                           "ENCRYPTED 0");
+    runUntilIdle(&bttrx_fsm);
+  }
+  ASSERT_EQ("de:ad:be:ef:00:02", bttrx_fsm.getPeerList()->at(0));
+}
+
+TEST_F(BTTRX_FSMTest, Run_Inquiry_ConnectsToBestScoredDevice) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  configure(&bttrx_fsm, {});
+
+  env.rx_lines.push_back("INQUIRY_PARTIAL de:ad:be:ef:00:01 5a020c \"\" -30");
+  env.rx_lines.push_back("INQUIRY_PARTIAL de:ad:be:ef:00:02 240404 \"\" -75");
+  env.rx_lines.push_back("INQUIRY_PARTIAL de:ad:be:ef:00:03 240404 \"\" -50");
+  env.rx_lines.push_back("INQUIRY 3");
+  env.rx_lines.push_back("INQUIRY de:ad:be:ef:00:01 5a020c");
+  env.rx_lines.push_back("INQUIRY de:ad:be:ef:00:02 240404");
+  env.rx_lines.push_back("INQUIRY de:ad:be:ef:00:03 240404");
+  runUntilIdle(&bttrx_fsm);
+
+  string status;
+  bttrx_fsm.bttrx_control_.get("statusmessage", &status);
+  ASSERT_EQ(BTTRX_FSM::STATE_CONNECTING, bttrx_fsm.getCurrentState());
+  ASSERT_EQ("Connecting to de:ad:be:ef:00:03", status);
+}
+
+TEST_F(BTTRX_FSMTest, Run_Inquiry_DeadlineEndsLostInquiry) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  configure(&bttrx_fsm, {});
+  ASSERT_TRUE(bttrx_fsm.getWT32i()->inquiryRunning());
+
+  // "INQUIRY <num_devices>" never arrives
+  env.rx_lines.push_back("INQUIRY_PARTIAL de:ad:be:ef:00:03 240404 \"\" -50");
+  runUntilIdle(&bttrx_fsm);
+  env.now_ms += INQUIRY_DURATION * INQUIRY_UNIT + INQUIRY_TIMEOUT_MARGIN;
+  runUntilIdle(&bttrx_fsm);
+
+  string status;
+  bttrx_fsm.bttrx_control_.get("statusmessage", &status);
+  ASSERT_FALSE(bttrx_fsm.getWT32i()->inquiryRunning());
+  ASSERT_EQ(1u, countSent("IC"));
+  ASSERT_EQ(BTTRX_FSM::STATE_CONNECTING, bttrx_fsm.getCurrentState());
+  ASSERT_EQ("Connecting to de:ad:be:ef:00:03", status);
+}
+
+TEST_F(BTTRX_FSMTest, Run_Inquiry_ErrorEndsInquiry) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  configure(&bttrx_fsm, {});
+  ASSERT_TRUE(bttrx_fsm.getWT32i()->inquiryRunning());
+
+  env.rx_lines.push_back("INQUIRY ERROR 0x0c");
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_FALSE(bttrx_fsm.getWT32i()->inquiryRunning());
+  ASSERT_EQ(BTTRX_FSM::STATE_INQUIRY, bttrx_fsm.getCurrentState());
+}
+
+TEST_F(BTTRX_FSMTest, Run_HandlesAllPendingMessages) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  configure(&bttrx_fsm, {});
+
+  env.rx_lines.push_back("INQUIRY_PARTIAL de:ad:be:ef:00:01 5a020c \"\" -30");
+  env.rx_lines.push_back("INQUIRY_PARTIAL de:ad:be:ef:00:02 240404 \"\" -75");
+  env.rx_lines.push_back("INQUIRY_PARTIAL de:ad:be:ef:00:03 240404 \"\" -50");
+  bttrx_fsm.run();
+
+  ASSERT_TRUE(env.rx_lines.empty());
+  ASSERT_EQ(3u, bttrx_fsm.getInquiryCache()->size());
+}
+
+TEST_F(BTTRX_FSMTest, Run_Recovery_ReconnectsLostDevice) {
+  // All settings read from the preferences, incl. recovery window: 30 s
+  ::testing::DefaultValue<uint16_t>::Set(30);
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  connectOneLink(&bttrx_fsm);
+
+  env.rx_lines.push_back("NO CARRIER 0 ERROR c0c RFC_L2CAP_LINK_LOSS");
+  runUntilIdle(&bttrx_fsm);
+
+  string status;
+  bttrx_fsm.bttrx_control_.get("statusmessage", &status);
+  ASSERT_EQ(BTTRX_FSM::STATE_RECOVERING, bttrx_fsm.getCurrentState());
+  ASSERT_EQ("Connection lost, reconnecting to de:ad:be:ef:00:01", status);
+
+  // First page fails, the second one succeeds
+  env.rx_lines.push_back("CALL 0");
+  env.rx_lines.push_back("NO CARRIER 0 ERROR 0");
+  runUntilIdle(&bttrx_fsm);
+  env.now_ms += RECOVERY_RETRY_INTERVAL;
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_EQ(BTTRX_FSM::STATE_RECOVERING, bttrx_fsm.getCurrentState());
+
+  env.rx_lines.push_back("CALL 0");
+  env.rx_lines.push_back("HFP-AG 0 READY");
+  runUntilIdle(&bttrx_fsm);
+
+  string stats;
+  bttrx_fsm.bttrx_control_.get("recovery_stats", &stats);
+  ASSERT_EQ(BTTRX_FSM::STATE_CONNECTED, bttrx_fsm.getCurrentState());
+  ASSERT_EQ(1, bttrx_fsm.getConnectedLinkCount());
+  ASSERT_EQ(0u, stats.find("1/1 recovered, avg "));
+}
+
+TEST_F(BTTRX_FSMTest, Run_Recovery_OtherDeviceEndsRecovery) {
+  ::testing::DefaultValue<uint16_t>::Set(30);
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  connectOneLink(&bttrx_fsm);
+
+  env.rx_lines.push_back("NO CARRIER 0 ERROR c0c RFC_L2CAP_LINK_LOSS");
+  runUntilIdle(&bttrx_fsm);
+  env.rx_lines.push_back("CALL 0");
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_EQ(BTTRX_FSM::STATE_RECOVERING, bttrx_fsm.getCurrentState());
+
+  // Another device connects, its address is not known yet
+  env.rx_lines.push_back("HFP-AG 1 READY");
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_EQ(BTTRX_FSM::STATE_RECOVERING, bttrx_fsm.getCurrentState());
+
+  env.rx_lines.push_back("LIST 1 CONNECTED HFP-AG 667 0 0 7 8d 8d "
+                         "de:ad:be:ef:00:05 3 INCOMING ACTIVE MASTER "
+                         "ENCRYPTED 0");
+  runUntilIdle(&bttrx_fsm);
+
+  string stats;
+  bttrx_fsm.bttrx_control_.get("recovery_stats", &stats);
+  ASSERT_EQ(BTTRX_FSM::STATE_CONNECTED, bttrx_fsm.getCurrentState());
+  ASSERT_EQ(1u, countSent("CLOSE 0")); // Page to the lost device
+  ASSERT_EQ("0/1 recovered", stats);
+}
+
+TEST_F(BTTRX_FSMTest, Run_Recovery_EscalatesToInquiry) {
+  ::testing::DefaultValue<uint16_t>::Set(30);
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  connectOneLink(&bttrx_fsm);
+
+  env.rx_lines.push_back("NO CARRIER 0 ERROR c0c RFC_L2CAP_LINK_LOSS");
+  runUntilIdle(&bttrx_fsm);
+
+  // Pages time out until the recovery window has passed
+  ulong lost = env.now_ms;
+  int pages = 0;
+  while (bttrx_fsm.getCurrentState() == BTTRX_FSM::STATE_RECOVERING &&
+         pages++ < 100) {
+    env.now_ms += PAGE_TIMEOUT;
+    runUntilIdle(&bttrx_fsm);
+  }
+  ASSERT_GE(env.now_ms - lost, 30000u);
+
+  string stats;
+  bttrx_fsm.bttrx_control_.get("recovery_stats", &stats);
+  ASSERT_EQ(BTTRX_FSM::STATE_INQUIRY, bttrx_fsm.getCurrentState());
+  ASSERT_EQ("0/1 recovered", stats);
+}
+
+TEST_F(BTTRX_FSMTest, Run_Recovery_Disabled) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  connectOneLink(&bttrx_fsm); // Recovery window read as 0
+
+  env.rx_lines.push_back("NO CARRIER 0 ERROR c0c RFC_L2CAP_LINK_LOSS");
+  runUntilIdle(&bttrx_fsm);
+
+  ASSERT_EQ(BTTRX_FSM::STATE_INQUIRY, bttrx_fsm.getCurrentState());
+}
+} // namespace
+TEST_F(BTTRX_FSMTest, Run_Configure_WritesOnlyDifferences) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  boot(&bttrx_fsm);
+  ASSERT_EQ(BTTRX_FSM::STATE_CONFIGURE, bttrx_fsm.getCurrentState());
+  ASSERT_EQ(1u, countSent("SET"));
+
+  env.rx_lines.push_back("SET BT BDADDR 00:07:80:12:34:56");
+  env.rx_lines.push_back("SET BT NAME bt-trx_123456");
+  env.rx_lines.push_back("SET BT CLASS 400204");
+  env.rx_lines.push_back("SET BT AUTH * 0000");
+  env.rx_lines.push_back("SET BT SSP 1 0");
+  env.rx_lines.push_back("SET BT FILTER 200400 200400");
+  env.rx_lines.push_back("SET PROFILE HFP-AG ON");
+  env.rx_lines.push_back("SET CONTROL CONFIG 0001 0000 00a0 1101");
+  env.rx_lines.push_back("SET CONTROL ECHO 7");
+  env.rx_lines.push_back("SET");
+  runUntilIdle(&bttrx_fsm);
+
+  // Only the echo mode differs, verification is pending
+  ASSERT_EQ(BTTRX_FSM::STATE_CONFIGURE, bttrx_fsm.getCurrentState());
+  ASSERT_EQ(1u, countSent("SET CONTROL ECHO 5"));
+  ASSERT_EQ(0u, countSent("SET BT CLASS 400204"));
+  ASSERT_EQ(0u, countSent("SET BT NAME bt-trx_123456"));
+  ASSERT_EQ(2u, countSent("SET"));
+
+  env.rx_lines.push_back("SET CONTROL ECHO 5");
+  env.rx_lines.push_back("SET");
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_EQ(BTTRX_FSM::STATE_INQUIRY, bttrx_fsm.getCurrentState());
+  ASSERT_EQ(1u, countSent("SET CONTROL ECHO 5"));
+}
+
+TEST_F(BTTRX_FSMTest, Run_Configure_MatchingConfigurationSkipsWrites) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  boot(&bttrx_fsm);
+
+  env.rx_lines.push_back("SET BT BDADDR 00:07:80:12:34:56");
+  env.rx_lines.push_back("SET BT NAME bt-trx_123456");
+  env.rx_lines.push_back("SET BT CLASS 400204");
+  env.rx_lines.push_back("SET BT AUTH * 0000");
+  env.rx_lines.push_back("SET BT SSP 1 0");
+  env.rx_lines.push_back("SET BT FILTER 200400 200400");
+  env.rx_lines.push_back("SET PROFILE HFP-AG ON");
+  env.rx_lines.push_back("SET CONTROL CONFIG 0001 0000 00A0 1101");
+  env.rx_lines.push_back("SET CONTROL ECHO 5");
+  env.rx_lines.push_back("SET");
+  runUntilIdle(&bttrx_fsm);
+
+  ASSERT_EQ(BTTRX_FSM::STATE_INQUIRY, bttrx_fsm.getCurrentState());
+  ASSERT_EQ(1u, countSent("SET"));
+}
+
+TEST_F(BTTRX_FSMTest, Run_Configure_NoDumpWritesEverything) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  boot(&bttrx_fsm);
+
+  // Module does not answer, both read backs time out
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(BTTRX_FSM::STATE_CONFIGURE, bttrx_fsm.getCurrentState());
+    env.now_ms += CONFIG_READ_TIMEOUT + 1;
+    runUntilIdle(&bttrx_fsm);
+  }
+  ASSERT_EQ(BTTRX_FSM::STATE_INQUIRY, bttrx_fsm.getCurrentState());
+  ASSERT_EQ(1u, countSent("SET BT CLASS 400204"));
+  ASSERT_EQ(1u, countSent("SET CONTROL ECHO 5"));
+  // BD address unknown, keep the name
+  ASSERT_EQ(0u, countSent("SET BT NAME bt-trx_1"));
+}
+
+TEST_F(BTTRX_FSMTest, Run_Init_BootBanner) {
+  useScriptedEnvironment();
+  EXPECT_CALL(*arduinoMock, digitalWrite(_, _)).Times(AtLeast(0));
+  EXPECT_CALL(*arduinoMock, digitalWrite(PIN_BT_RESET, LOW));
+  EXPECT_CALL(*arduinoMock, digitalWrite(PIN_BT_RESET, HIGH));
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  boot(&bttrx_fsm);
+
+  string firmware;
+  bttrx_fsm.bttrx_control_.get("bt_firmware", &firmware);
+  ASSERT_EQ(BTTRX_FSM::STATE_CONFIGURE, bttrx_fsm.getCurrentState());
+  ASSERT_EQ("6.1.0", bttrx_fsm.getWT32i()->getFirmwareVersion());
+  ASSERT_EQ(0u, firmware.find("6.1.0 build 1119, ready after "));
+  ASSERT_EQ(0u, countSent("AT"));
+}
+
+TEST_F(BTTRX_FSMTest, Run_Init_ProbeWithoutBanner) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  bttrx_fsm.run();
+  env.now_ms += BT_RESET_PULSE;
+  bttrx_fsm.run();
+
+  // No banner, e.g. the reset line is not connected
+  env.now_ms += BT_READY_TIMEOUT;
+  bttrx_fsm.run();
+  ASSERT_EQ(1u, countSent("AT"));
+  ASSERT_EQ(BTTRX_FSM::STATE_INIT, bttrx_fsm.getCurrentState());
+
+  env.rx_lines.push_back("OK");
+  runUntilIdle(&bttrx_fsm);
+  string firmware;
+  bttrx_fsm.bttrx_control_.get("bt_firmware", &firmware);
+  ASSERT_EQ(BTTRX_FSM::STATE_CONFIGURE, bttrx_fsm.getCurrentState());
+  ASSERT_EQ(0u, firmware.find("unknown, ready after "));
+}
+
+TEST_F(BTTRX_FSMTest, Run_Init_ResetAgainWithoutAnswer) {
+  useScriptedEnvironment();
+  EXPECT_CALL(*arduinoMock, digitalWrite(_, _)).Times(AtLeast(0));
+  EXPECT_CALL(*arduinoMock, digitalWrite(PIN_BT_RESET, LOW)).Times(2);
+  EXPECT_CALL(*arduinoMock, digitalWrite(PIN_BT_RESET, HIGH));
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  bttrx_fsm.run();
+  env.now_ms += BT_RESET_PULSE;
+  bttrx_fsm.run();
+  env.now_ms += BT_READY_TIMEOUT;
+  bttrx_fsm.run();
+  env.now_ms += BT_PROBE_TIMEOUT;
+  bttrx_fsm.run();
+  bttrx_fsm.run();
+
+  ASSERT_EQ(BTTRX_FSM::STATE_INIT, bttrx_fsm.getCurrentState());
+}
+
+TEST_F(BTTRX_FSMTest, Run_Init_SwitchBaudRate) {
+  useScriptedEnvironment();
+  baud_rates.clear();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  bttrx_fsm.setBaudRateCallback(recordBaudRate);
+  boot(&bttrx_fsm);
+
+  ASSERT_EQ(1u, countSent("SET CONTROL BAUD 921600,8n1"));
+  ASSERT_EQ(std::vector<uint32_t>({SERIAL_BT_FAST_RATE}), baud_rates);
+  ASSERT_EQ(1u, countSent("AT"));
+  ASSERT_EQ(BTTRX_FSM::STATE_INIT, bttrx_fsm.getCurrentState());
+
+  env.rx_lines.push_back("OK");
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_EQ(BTTRX_FSM::STATE_CONFIGURE, bttrx_fsm.getCurrentState());
+
+  env.rx_lines.push_back("SET BT BDADDR 00:07:80:12:34:56");
+  env.rx_lines.push_back("SET");
+  env.rx_lines.push_back("SET");
+  runUntilIdle(&bttrx_fsm);
+  string link;
+  bttrx_fsm.bttrx_control_.get("bt_link", &link);
+  ASSERT_EQ(0u, link.find("921600 baud, boot "));
+  ASSERT_NE(string::npos, link.find(" ms, config "));
+}
+
+TEST_F(BTTRX_FSMTest, Run_Init_PublishesUARTStats) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  bttrx_fsm.startUARTReader(&Serial);
+  string uart = "WRAP THOR AI (6.1.0 build 1119)\r\nREADY.\r\n";
+  size_t position = 0;
+  EXPECT_CALL(*serialMock, available()).WillRepeatedly(Invoke([&]() {
+    return (int)(uart.size() - position);
+  }));
+  EXPECT_CALL(*serialMock, read()).WillRepeatedly(Invoke([&]() {
+    return position < uart.size() ? (int)(unsigned char)uart[position++] : -1;
+  }));
+  bttrx_fsm.run();
+  env.now_ms += BT_RESET_PULSE;
+  bttrx_fsm.run();
+
+  // Done by the reader task on the target
+  bttrx_fsm.getUARTReader()->poll();
+  runUntilIdle(&bttrx_fsm);
+  string stats;
+  bttrx_fsm.bttrx_control_.get("uart_stats", &stats);
+  ASSERT_EQ("high water 2/" + to_string(UART_QUEUE_SIZE) + ", stalls 0", stats);
+}
+
+TEST_F(BTTRX_FSMTest, Run_Init_BaudRateFallback) {
+  useScriptedEnvironment();
+  baud_rates.clear();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  bttrx_fsm.setBaudRateCallback(recordBaudRate);
+  boot(&bttrx_fsm);
+
+  // No answer at the fast rate
+  env.now_ms += BT_PROBE_TIMEOUT;
+  bttrx_fsm.run();
+  ASSERT_EQ(std::vector<uint32_t>({SERIAL_BT_FAST_RATE, SERIAL_BT_RATE}),
+            baud_rates);
+  ASSERT_EQ(2u, countSent("AT"));
+
+  env.rx_lines.push_back("OK");
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_EQ(BTTRX_FSM::STATE_CONFIGURE, bttrx_fsm.getCurrentState());
+
+  env.rx_lines.push_back("SET");
+  env.rx_lines.push_back("SET");
+  runUntilIdle(&bttrx_fsm);
+  string link;
+  bttrx_fsm.bttrx_control_.get("bt_link", &link);
+  ASSERT_EQ(0u, link.find("115200 baud, boot "));
+}
+
+TEST_F(BTTRX_FSMTest, Run_Init_ToggleBaudRateWithoutAnswer) {
+  useScriptedEnvironment();
+  EXPECT_CALL(*arduinoMock, digitalWrite(_, _)).Times(AtLeast(0));
+  baud_rates.clear();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  bttrx_fsm.setBaudRateCallback(recordBaudRate);
+  bttrx_fsm.run();
+  env.now_ms += BT_RESET_PULSE;
+  bttrx_fsm.run();
+  env.now_ms += BT_READY_TIMEOUT;
+  bttrx_fsm.run();
+  env.now_ms += BT_PROBE_TIMEOUT;
+  bttrx_fsm.run();
+
+  // The module may still run with the rate stored before
+  ASSERT_EQ(std::vector<uint32_t>({SERIAL_BT_FAST_RATE}), baud_rates);
+  ASSERT_EQ(BTTRX_FSM::STATE_INIT, bttrx_fsm.getCurrentState());
+}
+
+TEST_F(BTTRX_FSMTest, Run_Init_FastRateDisabledFindsStoredRate) {
+  useScriptedEnvironment();
+  EXPECT_CALL(*arduinoMock, digitalWrite(_, _)).Times(AtLeast(0));
+  baud_rates.clear();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  bttrx_fsm.setBaudRateCallback(recordBaudRate, 0);
+  bttrx_fsm.run();
+  env.now_ms += BT_RESET_PULSE;
+  bttrx_fsm.run();
+  env.now_ms += BT_READY_TIMEOUT;
+  bttrx_fsm.run();
+  env.now_ms += BT_PROBE_TIMEOUT;
+  bttrx_fsm.run();
+
+  // No answer at SERIAL_BT_RATE, the module still has the fast rate stored
+  ASSERT_EQ(std::vector<uint32_t>({SERIAL_BT_PROBE_RATE}), baud_rates);
+  boot(&bttrx_fsm);
+
+  // Switched back to the rate of a factory reset
+  ASSERT_EQ(1u, countSent("SET CONTROL BAUD 115200,8n1"));
+  ASSERT_EQ(std::vector<uint32_t>({SERIAL_BT_PROBE_RATE, SERIAL_BT_RATE}),
+            baud_rates);
+  env.rx_lines.push_back("OK");
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_EQ(BTTRX_FSM::STATE_CONFIGURE, bttrx_fsm.getCurrentState());
+}
+
+TEST_F(BTTRX_FSMTest, Run_Configure_CachesBDAddress) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  *bttrx_fsm.getBDAddressCache() = BDAddressCache(&preferencesMock);
+  EXPECT_CALL(preferencesMock, getBytes(StrEq("bt_bdaddr"), _, _))
+      .WillOnce(Return(0));
+  EXPECT_CALL(preferencesMock, putBytes(StrEq("bt_bdaddr"), _, 6));
+  boot(&bttrx_fsm);
+
+  env.rx_lines.push_back("SET BT BDADDR 00:07:80:12:34:56");
+  env.rx_lines.push_back("SET");
+  runUntilIdle(&bttrx_fsm);
+
+  ASSERT_EQ("00:07:80:12:34:56", bttrx_fsm.getBDAddressCache()->get());
+  ASSERT_EQ(1u, countSent("SET BT NAME bt-trx_123456"));
+}
+
+TEST_F(BTTRX_FSMTest, Run_Configure_CachedBDAddressWithoutDump) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  *bttrx_fsm.getBDAddressCache() = BDAddressCache(&preferencesMock);
+  EXPECT_CALL(preferencesMock, getBytes(StrEq("bt_bdaddr"), _, _))
+      .WillOnce(Invoke(StoredBDAddress{"00:07:80:ab:cd:ef"}));
+  EXPECT_CALL(preferencesMock, putBytes(StrEq("bt_bdaddr"), _, _)).Times(0);
+  boot(&bttrx_fsm);
+
+  // Module does not answer the read back
+  env.now_ms += CONFIG_READ_TIMEOUT + 1;
+  runUntilIdle(&bttrx_fsm);
+
+  ASSERT_EQ(1u, countSent("SET BT NAME bt-trx_abcdef"));
+}
+
+TEST_F(BTTRX_FSMTest, Run_Indicators_OperatorRepeatedOnOldFirmware) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  connectOneLink(&bttrx_fsm);
+
+  // iWrap 6.1.0 does not forward AT+COPS?, the operator is sent in a single
+  // write together with the indicators
+  string batch = "STATUS service 1\r\nSTATUS signal 5\r\n"
+                 "+COPS: 0,0,\"BTTRX\"\r\nOK\r\n";
+  ASSERT_EQ(1, std::count(env.tx_writes.begin(), env.tx_writes.end(), batch));
+
+  // The operator is repeated while connected, the unchanged indicators are
+  // not
+  for (int i = 0; i < 3; i++) {
+    env.now_ms += HFP_COPS_INTERVAL;
+    runUntilIdle(&bttrx_fsm);
+  }
+  ASSERT_EQ(4u, countSent("+COPS: 0,0,\"BTTRX\""));
+  ASSERT_EQ(1u, countSent("STATUS service 1"));
+}
+
+TEST_F(BTTRX_FSMTest, Run_Indicators_HFPInitOnNewFirmware) {
+  useScriptedEnvironment();
+  BTTRX_FSM bttrx_fsm(&Serial, &Serial);
+  bttrx_fsm.run();
+  env.now_ms += BT_RESET_PULSE;
+  bttrx_fsm.run();
+  env.rx_lines.push_back("WRAP THOR AI (6.2.0 build 1122)");
+  env.rx_lines.push_back("READY.");
+  runUntilIdle(&bttrx_fsm);
+  env.now_ms += CONFIG_READ_TIMEOUT + 1;
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_EQ(1u, countSent("SET CONTROL HFPINIT SERVICE 1 SIGNAL 5"));
+
+  env.now_ms += CONFIG_READ_TIMEOUT + 1;
+  runUntilIdle(&bttrx_fsm);
+  env.rx_lines.push_back("HFP-AG 0 READY");
+  runUntilIdle(&bttrx_fsm);
+  ASSERT_EQ(BTTRX_FSM::STATE_CONNECTED, bttrx_fsm.getCurrentState());
+  for (string line : env.tx_lines) {
+    ASSERT_EQ(string::npos, line.find("+COPS"));
+    ASSERT_EQ(string::npos, line.find("STATUS service"));
+  }
+}
@@ -0,0 +1,116 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gtest/gtest.h"
+
+#include "arduino-mock/Arduino.h"
+
+#include "../src/button_ble_group.h"
+
+#include <string.h>
+
+using ::testing::AtLeast;
+using ::testing::Return;
+
+namespace {
+class ButtonBLEGroupTest : public ::testing::Test {
+protected:
+  ArduinoMock *arduinoMock;
+  ButtonBLEGroup group;
+
+  virtual void SetUp() {
+    arduinoMock = arduinoMockInstance();
+    EXPECT_CALL(*arduinoMock, millis())
+        .Times(AtLeast(0))
+        .WillRepeatedly(Return(1000));
+    for (size_t i = 0; i < group.size(); i++) {
+      group.getButton(i)->setConnected(true);
+    }
+  }
+
+  virtual void TearDown() { releaseArduinoMock(); }
+
+  void notify(size_t index, const char *payload, ulong time) {
+    group.getButton(index)->handleNotification((const uint8_t *)payload,
+                                               strlen(payload), time);
+  }
+};
+
+TEST_F(ButtonBLEGroupTest, update_pressedWhileAnyPressed) {
+  notify(0, "ELET1", 990);
+  group.update();
+  ASSERT_TRUE(group.isPressedEdge());
+  ASSERT_EQ(0, group.getEdgeSource());
+  ASSERT_EQ(990u, group.getEdgeTime());
+
+  // Second button pressed and first one released: PTT stays on
+  notify(1, "ELET1", 995);
+  group.update();
+  ASSERT_FALSE(group.isPressedEdge());
+  notify(0, "ELET2", 996);
+  group.update();
+  ASSERT_TRUE(group.isPressed());
+  ASSERT_FALSE(group.isReleasedEdge());
+
+  notify(1, "ELET2", 998);
+  group.update();
+  ASSERT_TRUE(group.isReleasedEdge());
+  ASSERT_EQ(1, group.getEdgeSource());
+}
+
+TEST_F(ButtonBLEGroupTest, update_lostButtonReleases) {
+  notify(1, "ELET1", 990);
+  group.update();
+  ASSERT_TRUE(group.isPressed());
+
+  group.getButton(1)->setConnected(false);
+  group.update();
+  ASSERT_FALSE(group.isPressed());
+  ASSERT_EQ(-1, group.getEdgeSource());
+  ASSERT_EQ(1u, group.getConnectedCount());
+}
+
+TEST_F(ButtonBLEGroupTest, getStats_perButton) {
+  notify(0, "ELET1", 997);
+  notify(1, "BATT4", 997);
+  group.update();
+  group.getButton(1)->setConnected(false);
+
+  ASSERT_EQ("1: connected, 1 edges, latency avg 3 ms, max 3 ms; "
+            "2: not connected, battery 4",
+            group.getStats());
+}
+
+TEST_F(ButtonBLEGroupTest, getRevision_changesWithStats) {
+  group.update();
+  uint32_t revision = group.getRevision();
+  group.update();
+  ASSERT_EQ(revision, group.getRevision());
+
+  notify(1, "BATT7", 999);
+  group.update();
+  ASSERT_NE(revision, group.getRevision());
+}
+
+TEST_F(ButtonBLEGroupTest, getButton_outOfRange) {
+  ASSERT_EQ(NULL, group.getButton(BLE_MAX_BUTTONS));
+}
+
+} // namespace
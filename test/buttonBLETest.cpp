@@ -0,0 +1,123 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gtest/gtest.h"
+
+#include "../src/button_ble.h"
+
+#include <string.h>
+
+namespace {
+class ButtonBLETest : public ::testing::Test {
+protected:
+  ButtonBLE button;
+
+  BLENotification notify(const char *payload, ulong time) {
+    return button.handleNotification((const uint8_t *)payload,
+                                     strlen(payload), time);
+  }
+};
+
+TEST_F(ButtonBLETest, parseNotification_usesLength) {
+  const uint8_t press[] = {'E', 'L', 'E', 'T', '1', 'x', 'y'};
+  ASSERT_EQ(kBLENotifyPressed, ButtonBLE::parseNotification(press, 5));
+  ASSERT_EQ(kBLENotifyUnknown, ButtonBLE::parseNotification(press, 7));
+  ASSERT_EQ(kBLENotifyUnknown, ButtonBLE::parseNotification(press, 4));
+
+  const uint8_t release[] = {'E', 'L', 'E', 'T', '2', 0};
+  ASSERT_EQ(kBLENotifyReleased, ButtonBLE::parseNotification(release, 6));
+
+  const uint8_t battery[] = {'B', 'A', 'T', 'T', '4'};
+  ASSERT_EQ(kBLENotifyBattery, ButtonBLE::parseNotification(battery, 5));
+  ASSERT_EQ(kBLENotifyUnknown, ButtonBLE::parseNotification(NULL, 5));
+}
+
+TEST_F(ButtonBLETest, parseBatteryLevel_digits) {
+  const uint8_t level[] = {'B', 'A', 'T', 'T', '8', '0'};
+  ASSERT_EQ(80, ButtonBLE::parseBatteryLevel(level, 6));
+  ASSERT_EQ(8, ButtonBLE::parseBatteryLevel(level, 5));
+  ASSERT_EQ(-1, ButtonBLE::parseBatteryLevel(level, 4));
+
+  const uint8_t garbage[] = {'B', 'A', 'T', 'T', 'x'};
+  ASSERT_EQ(-1, ButtonBLE::parseBatteryLevel(garbage, 5));
+}
+
+TEST_F(ButtonBLETest, handleNotification_battery) {
+  ASSERT_EQ(-1, button.getBatteryLevel());
+  ASSERT_EQ(kBLENotifyBattery, notify("BATT3", 100));
+  ASSERT_EQ(3, button.getBatteryLevel());
+
+  button.update();
+  ASSERT_FALSE(button.isPressedEdge());
+  ASSERT_FALSE(button.isReleasedEdge());
+}
+
+TEST_F(ButtonBLETest, recordLatency_averageAndMax) {
+  ASSERT_EQ(0u, button.getLatencyAverage());
+  button.recordLatency(2);
+  button.recordLatency(10);
+  button.recordLatency(3);
+  ASSERT_EQ(3u, button.getEdges());
+  ASSERT_EQ(5u, button.getLatencyAverage());
+  ASSERT_EQ(10u, button.getLatencyMax());
+}
+
+TEST_F(ButtonBLETest, update_edgeWithTimestamp) {
+  ASSERT_EQ(kBLENotifyPressed, notify("ELET1", 1234));
+  button.update();
+  ASSERT_TRUE(button.isPressedEdge());
+  ASSERT_EQ(1234u, button.getEdgeTime());
+
+  button.update();
+  ASSERT_TRUE(button.isPressed());
+  ASSERT_FALSE(button.isPressedEdge());
+}
+
+TEST_F(ButtonBLETest, update_shortPressKeepsBothEdges) {
+  notify("ELET1", 100);
+  notify("ELET2", 130);
+
+  button.update();
+  ASSERT_TRUE(button.isPressedEdge());
+  button.update();
+  ASSERT_TRUE(button.isReleasedEdge());
+  ASSERT_EQ(130u, button.getEdgeTime());
+}
+
+TEST_F(ButtonBLETest, update_repeatedStateIsNoEdge) {
+  notify("ELET1", 100);
+  notify("ELET1", 200);
+  notify("BATT3", 300);
+
+  button.update();
+  ASSERT_TRUE(button.isPressedEdge());
+  button.update();
+  ASSERT_FALSE(button.isPressedEdge());
+  ASSERT_EQ(100u, button.getEdgeTime());
+}
+
+TEST_F(ButtonBLETest, handleNotification_fullQueueDrops) {
+  for (int i = 0; i < BLE_BUTTON_QUEUE_SIZE + 2; i++) {
+    notify(i % 2 == 0 ? "ELET1" : "ELET2", i);
+  }
+  ASSERT_EQ(2u, button.getDropped());
+}
+
+} // namespace
@@ -0,0 +1,63 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gtest/gtest.h"
+
+#include "../src/coexstats.h"
+
+namespace {
+class CoexStatsTest : public ::testing::Test {
+protected:
+  CoexStats stats;
+};
+
+TEST_F(CoexStatsTest, stackStarted_recordsHeap) {
+  stats.stackStarted(kCoexWiFi, 200000, 150000);
+  stats.stackStarted(kCoexBLE, 150000, 160000); // Heap got freed meanwhile
+
+  ASSERT_EQ(50000u, stats.getStackHeap(kCoexWiFi));
+  ASSERT_EQ(0u, stats.getStackHeap(kCoexBLE));
+}
+
+TEST_F(CoexStatsTest, countRequest_averageAndMax) {
+  ASSERT_EQ(0u, stats.getRequestTimeAverage());
+
+  stats.countRequest(1000, 300);
+  stats.countRequest(1200, 900);
+
+  ASSERT_EQ(2u, stats.getRequests());
+  ASSERT_EQ(600u, stats.getRequestTimeAverage());
+  ASSERT_EQ(900u, stats.getRequestTimeMax());
+  ASSERT_EQ("heap 90000 free, 70000 min; wifi 0 bytes, ble 0 bytes; "
+            "2 requests, avg 600 us, max 900 us",
+            stats.getStats(90000, 70000));
+}
+
+TEST_F(CoexStatsTest, isWebBusy_holdsAfterRequest) {
+  ASSERT_FALSE(stats.isWebBusy(0));
+
+  stats.countRequest(1000, 300);
+
+  ASSERT_TRUE(stats.isWebBusy(1000));
+  ASSERT_TRUE(stats.isWebBusy(1000 + WIFI_TRAFFIC_HOLD - 1));
+  ASSERT_FALSE(stats.isWebBusy(1000 + WIFI_TRAFFIC_HOLD));
+}
+
+} // namespace
@@ -10,4 +10,6 @@ class Preferences {
   MOCK_METHOD2(putBool, size_t(const char*, bool));
   MOCK_METHOD2(getString, string(const char*, const char*));
   MOCK_METHOD2(putString, size_t(const char*, const char*));
+  MOCK_METHOD3(getBytes, size_t(const char*, void*, size_t));
+  MOCK_METHOD3(putBytes, size_t(const char*, const void*, size_t));
 };
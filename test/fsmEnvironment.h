@@ -0,0 +1,84 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#pragma once
+
+#include "arduino-mock/Arduino.h"
+
+#include "../src/pins.h"
+
+#include <deque>
+#include <set>
+#include <string>
+using namespace std;
+
+/**
+ * @brief Virtual environment of the FSM: clock, lines sent by the WT32i
+ * module and the buttons held down
+ */
+struct FSMEnvironment {
+  ulong now_ms = 0;
+  std::deque<string> rx_lines;
+  std::set<int> pressed_pins;
+
+  void setPressed(int pin, bool pressed) {
+    if (pressed) {
+      pressed_pins.insert(pin);
+    } else {
+      pressed_pins.erase(pin);
+    }
+  }
+  bool isPressed(int pin) { return pressed_pins.count(pin) > 0; }
+};
+
+/**
+ * @brief millis(): every read of the clock takes 1 ms
+ */
+struct VirtualMillis {
+  FSMEnvironment *env;
+  unsigned long operator()() { return ++env->now_ms; }
+};
+
+/**
+ * @brief Serial::readBytesUntil(): deliver the next line of the WT32i module
+ */
+struct VirtualReadLine {
+  FSMEnvironment *env;
+  template <typename Delimiter, typename Length>
+  size_t operator()(Delimiter, char *buffer, Length length) {
+    if (env->rx_lines.empty()) {
+      return 0;
+    }
+    string line = env->rx_lines.front();
+    env->rx_lines.pop_front();
+    return line.copy(buffer, length);
+  }
+};
+
+/**
+ * @brief digitalRead(): pressed buttons read LOW (active low), all other
+ * inputs are idle
+ */
+struct VirtualDigitalRead {
+  FSMEnvironment *env;
+  template <typename Pin> int operator()(Pin pin) {
+    return env->isPressed(pin) ? LOW : HIGH;
+  }
+};
@@ -0,0 +1,104 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gtest/gtest.h"
+
+#include "../src/gaincalibration.h"
+
+#include <math.h>
+
+namespace {
+class GainCalibrationTest : public ::testing::Test {
+protected:
+  GainCalibration calibration;
+  int gain_ = -1;
+
+  // Peak of a steady tone, 3 dB per gain step, reaching the target at
+  // target_gain. The ADC clips at full scale
+  uint16_t peak(int target_gain) {
+    double level = GAIN_CALIBRATION_TARGET + 3.0 * (gain_ - target_gain);
+    double counts = 2048 * pow(10, level / 20);
+    return counts > 2047 ? 2047 : lround(counts);
+  }
+
+  void run(int target_gain, bool silent = false) {
+    calibration.start();
+    for (ulong now = 0; now < 60000 && calibration.isRunning(); now += 10) {
+      uint16_t level = silent || gain_ < 0 ? 0 : peak(target_gain);
+      int gain = calibration.update(now, level);
+      if (gain >= 0) {
+        gain_ = gain;
+      }
+    }
+  }
+};
+
+TEST_F(GainCalibrationTest, update_startsInTheMiddle) {
+  calibration.start();
+
+  ASSERT_EQ(GAIN_MAX / 2, calibration.update(1000, 0));
+  ASSERT_EQ(-1, calibration.update(1010, 0));
+}
+
+TEST_F(GainCalibrationTest, update_findsTargetGain) {
+  run(15);
+
+  ASSERT_EQ(kGainCalibrationDone, calibration.getState());
+  ASSERT_EQ(15, calibration.getGain());
+  ASSERT_EQ(15, gain_);
+  ASSERT_EQ(0, calibration.getError());
+  ASSERT_LE(calibration.getSteps(), 5);
+  ASSERT_EQ(calibration.getSteps() *
+                (GAIN_CALIBRATION_SETTLE + GAIN_CALIBRATION_MEASURE),
+            calibration.getDuration());
+}
+
+TEST_F(GainCalibrationTest, update_findsLowestGainForLoudSignal) {
+  run(-1); // Even gain 0 is 3 dB above the target
+
+  ASSERT_EQ(kGainCalibrationDone, calibration.getState());
+  ASSERT_EQ(0, calibration.getGain());
+  ASSERT_EQ(3, calibration.getError());
+}
+
+TEST_F(GainCalibrationTest, update_failsWithoutSignal) {
+  run(0, true);
+
+  ASSERT_EQ(kGainCalibrationFailed, calibration.getState());
+  ASSERT_EQ("failed, no usable signal, 5 steps, 3000 ms",
+            calibration.getResult());
+}
+
+TEST_F(GainCalibrationTest, getResult) {
+  ASSERT_EQ("", calibration.getResult());
+
+  run(12);
+
+  ASSERT_EQ("gain c, peak -6 dBFS (0 dB off), 4 steps, 2400 ms",
+            calibration.getResult());
+}
+
+TEST_F(GainCalibrationTest, toGainString) {
+  ASSERT_EQ("0", GainCalibration::toGainString(0));
+  ASSERT_EQ("c", GainCalibration::toGainString(12));
+  ASSERT_EQ("16", GainCalibration::toGainString(GAIN_MAX));
+}
+
+} // namespace
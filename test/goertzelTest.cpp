@@ -0,0 +1,71 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gtest/gtest.h"
+
+#include "../src/goertzel.h"
+
+#include <math.h>
+
+namespace {
+class GoertzelTest : public ::testing::Test {
+protected:
+  Goertzel goertzel;
+
+  // Power after N samples of a sine, frequency in 0.1 Hz
+  int64_t measure(uint32_t frequency, int amplitude, int samples,
+                  uint32_t sample_rate = 8000) {
+    goertzel.reset();
+    for (int i = 0; i < samples; i++) {
+      goertzel.process(lround(
+          amplitude * sin(2 * M_PI * frequency * i / (10.0 * sample_rate))));
+    }
+    return goertzel.getPower();
+  }
+};
+
+TEST_F(GoertzelTest, getPower_matchesTone) {
+  goertzel.begin(6970, 8000);
+
+  double expected = pow(1000.0 * 205 / 2, 2);
+  double power = measure(6970, 1000, 205);
+
+  ASSERT_NEAR(1.0, power / expected, 0.05);
+}
+
+TEST_F(GoertzelTest, getPower_rejectsNeighbour) {
+  goertzel.begin(6970, 8000);
+
+  int64_t on_bin = measure(6970, 1000, 205);
+  int64_t next_row = measure(7700, 1000, 205);
+
+  ASSERT_LT(next_row * 20, on_bin);
+}
+
+TEST_F(GoertzelTest, getPower_fullScaleDoesNotOverflow) {
+  goertzel.begin(1000, 500);
+
+  double expected = pow(2047.0 * 500 / 2, 2);
+  double power = measure(1000, 2047, 500, 500);
+
+  ASSERT_NEAR(1.0, power / expected, 0.05);
+}
+
+} // namespace
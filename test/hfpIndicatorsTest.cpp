@@ -0,0 +1,133 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gtest/gtest.h"
+
+#include "../src/hfpindicators.h"
+#include "serialwrapperMock.h"
+
+using ::testing::_;
+using ::testing::InSequence;
+using ::testing::Matcher;
+using ::testing::StrEq;
+
+namespace {
+class HFPIndicatorManagerTest : public ::testing::Test {
+protected:
+  SerialWrapperMock serialWrapperMock;
+  WT32i wt32i;
+  HFPIndicatorManager indicators;
+
+  HFPIndicatorManagerTest() : wt32i(&serialWrapperMock) {}
+
+  virtual ~HFPIndicatorManagerTest() {}
+};
+
+TEST_F(HFPIndicatorManagerTest, flush_batchesChangedValues) {
+  indicators.acknowledge(0);
+  indicators.set(kHFPService, 1);
+  indicators.set(kHFPSignal, 5);
+  ASSERT_TRUE(indicators.pending());
+
+  InSequence batch;
+  EXPECT_CALL(serialWrapperMock, beginBatch());
+  EXPECT_CALL(serialWrapperMock,
+              println(Matcher<const char *>(StrEq("STATUS service 1"))));
+  EXPECT_CALL(serialWrapperMock,
+              println(Matcher<const char *>(StrEq("STATUS signal 5"))));
+  EXPECT_CALL(serialWrapperMock, endBatch());
+  ASSERT_EQ(2u, indicators.flush(&wt32i));
+  ASSERT_FALSE(indicators.pending());
+}
+
+TEST_F(HFPIndicatorManagerTest, set_unchangedValueNotSent) {
+  indicators.acknowledge(0);
+  indicators.set(kHFPSignal, 5);
+  EXPECT_CALL(serialWrapperMock, beginBatch());
+  EXPECT_CALL(serialWrapperMock, println(Matcher<const char *>(_))).Times(1);
+  EXPECT_CALL(serialWrapperMock, endBatch());
+  indicators.flush(&wt32i);
+
+  indicators.set(kHFPSignal, 5);
+  ASSERT_FALSE(indicators.pending());
+  ASSERT_EQ(0u, indicators.flush(&wt32i));
+}
+
+TEST_F(HFPIndicatorManagerTest, resend_allKnownValues) {
+  indicators.acknowledge(0);
+  indicators.set(kHFPService, 1);
+  indicators.set(kHFPBattChg, 3);
+  EXPECT_CALL(serialWrapperMock, beginBatch()).Times(2);
+  EXPECT_CALL(serialWrapperMock, endBatch()).Times(2);
+  EXPECT_CALL(serialWrapperMock,
+              println(Matcher<const char *>(StrEq("STATUS service 1"))))
+      .Times(2);
+  EXPECT_CALL(serialWrapperMock,
+              println(Matcher<const char *>(StrEq("STATUS battchg 3"))))
+      .Times(2);
+  EXPECT_CALL(serialWrapperMock,
+              println(Matcher<const char *>(StrEq("+COPS: 0,0,\"BTTRX\""))));
+  EXPECT_CALL(serialWrapperMock,
+              println(Matcher<const char *>(StrEq("OK"))));
+  indicators.flush(&wt32i);
+
+  indicators.resend(0);
+  indicators.requestOperator(0);
+  ASSERT_EQ(4u, indicators.flush(&wt32i));
+}
+
+TEST_F(HFPIndicatorManagerTest, acknowledge_nothingSent) {
+  indicators.set(kHFPService, 1);
+  indicators.acknowledge(0);
+
+  ASSERT_FALSE(indicators.pending());
+  ASSERT_EQ(0u, indicators.flush(&wt32i));
+}
+
+TEST_F(HFPIndicatorManagerTest, acknowledge_otherLinkStillPending) {
+  indicators.set(kHFPService, 1);
+  indicators.resend(0);
+  indicators.acknowledge(1);
+  ASSERT_TRUE(indicators.pending());
+
+  EXPECT_CALL(serialWrapperMock, beginBatch());
+  EXPECT_CALL(serialWrapperMock,
+              println(Matcher<const char *>(StrEq("STATUS service 1"))));
+  EXPECT_CALL(serialWrapperMock, endBatch());
+  ASSERT_EQ(1u, indicators.flush(&wt32i));
+}
+
+TEST_F(HFPIndicatorManagerTest, disconnect_dropsPendingValues) {
+  indicators.set(kHFPService, 1);
+  indicators.resend(0);
+  indicators.requestOperator(0);
+  indicators.disconnect(0);
+  ASSERT_FALSE(indicators.pending());
+
+  // Values changed later are not pending for the closed link
+  indicators.set(kHFPService, 0);
+  ASSERT_FALSE(indicators.pending());
+}
+
+TEST_F(HFPIndicatorManagerTest, set_unknownIndicator) {
+  indicators.set(kHFPUnknownIndicator, 1);
+  ASSERT_FALSE(indicators.pending());
+}
+} // namespace
@@ -0,0 +1,140 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gtest/gtest.h"
+
+#include "../src/inquirycache.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using ::testing::_;
+using ::testing::Return;
+
+namespace {
+class InquiryCacheTest : public ::testing::Test {
+protected:
+  Preferences preferencesMock;
+  PeerList known_peers;
+
+  InquiryCacheTest() : known_peers(&preferencesMock) {}
+
+  virtual ~InquiryCacheTest() {}
+
+  virtual void SetUp() {
+    ON_CALL(preferencesMock, putBytes(_, _, _)).WillByDefault(Return(0));
+  }
+
+  virtual void TearDown() {}
+};
+
+TEST_F(InquiryCacheTest, update_success_partial_with_name_and_rssi) {
+  InquiryCache cache;
+
+  ASSERT_EQ(ResultType::kSuccess,
+            cache.update("INQUIRY_PARTIAL 00:07:80:12:34:56 240404 "
+                         "\"My Headset\" -57",
+                         1000));
+
+  const InquiryEntry *entry = cache.find("00:07:80:12:34:56");
+  ASSERT_NE(nullptr, entry);
+  ASSERT_EQ(0x240404u, entry->class_of_device);
+  ASSERT_EQ(-57, entry->rssi);
+  ASSERT_STREQ("My Headset", entry->name);
+  ASSERT_EQ(1000u, entry->last_seen);
+}
+
+TEST_F(InquiryCacheTest, update_success_no_duplicates) {
+  InquiryCache cache;
+
+  cache.update("INQUIRY_PARTIAL 00:07:80:12:34:56 240404 \"\" -70", 1000);
+  cache.update("INQUIRY 00:07:80:12:34:56 240404", 2000);
+
+  const InquiryEntry *entry = cache.find("00:07:80:12:34:56");
+  ASSERT_EQ(1u, cache.size());
+  ASSERT_EQ(-70, entry->rssi); // Not overwritten by a result without RSSI
+  ASSERT_STREQ("", entry->name);
+  ASSERT_EQ(2000u, entry->last_seen);
+}
+
+TEST_F(InquiryCacheTest, update_fail_invalid) {
+  InquiryCache cache;
+
+  ASSERT_EQ(ResultType::kError, cache.update("INQUIRY 2", 0));
+  ASSERT_EQ(ResultType::kError, cache.update("INQUIRY foo 240404", 0));
+  ASSERT_EQ(ResultType::kError,
+            cache.update("INQUIRY 00:07:80:12:34:56 xyz", 0));
+  ASSERT_EQ(0u, cache.size());
+}
+
+TEST_F(InquiryCacheTest, update_success_replaces_least_recently_seen) {
+  InquiryCache cache;
+  char address[18];
+
+  for (int i = 0; i <= INQUIRY_CACHE_SIZE; i++) {
+    snprintf(address, sizeof(address), "00:00:00:00:00:%02x", i);
+    cache.update(string("INQUIRY ") + address + " 240404", 100 + i);
+  }
+
+  ASSERT_EQ((size_t)INQUIRY_CACHE_SIZE, cache.size());
+  ASSERT_EQ(nullptr, cache.find("00:00:00:00:00:00"));
+  ASSERT_NE(nullptr, cache.find(address));
+}
+
+TEST_F(InquiryCacheTest, setName_success) {
+  InquiryCache cache;
+  cache.update("INQUIRY 00:07:80:12:34:56 240404", 0);
+
+  cache.setName("00:07:80:12:34:56",
+                "A very long friendly name which does not fit");
+  cache.setName("00:07:80:00:00:00", "Unknown");
+
+  const InquiryEntry *entry = cache.find("00:07:80:12:34:56");
+  ASSERT_EQ((size_t)INQUIRY_NAME_LENGTH - 1, strlen(entry->name));
+  ASSERT_EQ(1u, cache.size());
+}
+
+TEST_F(InquiryCacheTest, selectBest_success_strongest_audio_device) {
+  InquiryCache cache;
+  cache.update("INQUIRY_PARTIAL 00:00:00:00:00:01 240404 \"\" -80", 10);
+  cache.update("INQUIRY_PARTIAL 00:00:00:00:00:02 240404 \"\" -40", 10);
+  // Phone: strongest signal, but not an audio device
+  cache.update("INQUIRY_PARTIAL 00:00:00:00:00:03 5a020c \"\" -30", 10);
+
+  ASSERT_EQ("00:00:00:00:00:02", cache.selectBest(0, &known_peers));
+}
+
+TEST_F(InquiryCacheTest, selectBest_success_known_peer_first) {
+  InquiryCache cache;
+  cache.update("INQUIRY_PARTIAL 00:00:00:00:00:01 240404 \"\" -80", 10);
+  cache.update("INQUIRY_PARTIAL 00:00:00:00:00:02 240404 \"\" -40", 10);
+  known_peers.touch("00:00:00:00:00:01");
+
+  ASSERT_EQ("00:00:00:00:00:01", cache.selectBest(0, &known_peers));
+}
+
+TEST_F(InquiryCacheTest, selectBest_fail_only_old_or_unsuitable_devices) {
+  InquiryCache cache;
+  cache.update("INQUIRY_PARTIAL 00:00:00:00:00:01 240404 \"\" -40", 10);
+  cache.update("INQUIRY_PARTIAL 00:00:00:00:00:02 5a020c \"\" -40", 30);
+
+  ASSERT_EQ("", cache.selectBest(20, &known_peers));
+}
+} // namespace
@@ -0,0 +1,154 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gtest/gtest.h"
+
+#include "../src/inquiryscheduler.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+const ulong kSecond = 1000;
+const ulong kMinute = 60 * kSecond;
+
+/**
+ * @brief Radio activity of one inquiry
+ */
+struct InquiryRun {
+  ulong start;
+  ulong duration;
+};
+
+class InquirySchedulerTest : public ::testing::Test {
+protected:
+  InquiryScheduler scheduler;
+  std::vector<InquiryRun> runs;
+
+  InquirySchedulerTest() {}
+
+  virtual ~InquirySchedulerTest() {}
+
+  virtual void SetUp() {}
+
+  virtual void TearDown() {}
+
+  // Poll the scheduler like the FSM does, without any connection coming up
+  void simulate(ulong from, ulong to) {
+    for (ulong now = from; now < to; now += 100) {
+      bool running = !runs.empty() &&
+                     now < runs.back().start + runs.back().duration;
+      if (!running && scheduler.isDue(now)) {
+        runs.push_back({now, scheduler.start(now) * 1280ul});
+      }
+    }
+  }
+
+  // Share of the time in [from, to) the radio was busy with inquiries
+  double dutyCycle(ulong from, ulong to) {
+    ulong busy = 0;
+    for (InquiryRun run : runs) {
+      ulong start = std::max(run.start, from);
+      ulong stop = std::min(run.start + run.duration, to);
+      if (stop > start) {
+        busy += stop - start;
+      }
+    }
+    return (double)busy / (to - from);
+  }
+};
+
+TEST_F(InquirySchedulerTest, start_success_burst_then_backoff) {
+  scheduler.setPolicy(10, 600);
+  scheduler.reset(0);
+
+  ASSERT_TRUE(scheduler.isDue(0));
+  for (int i = 0; i < INQUIRY_BURST_COUNT; i++) {
+    ASSERT_EQ(INQUIRY_SHORT_DURATION, scheduler.start(0));
+    ASSERT_EQ((ulong)INQUIRY_MIN_INTERVAL, scheduler.getInterval());
+  }
+  ASSERT_FALSE(scheduler.isDue(INQUIRY_MIN_INTERVAL - 1));
+  ASSERT_TRUE(scheduler.isDue(INQUIRY_MIN_INTERVAL));
+
+  // Budget of 10 % for 6.4 s inquiries: at least 64 s between them
+  ASSERT_EQ(INQUIRY_DURATION, scheduler.start(0));
+  ASSERT_EQ(64 * kSecond, scheduler.getInterval());
+
+  ulong last_interval = 0;
+  for (int i = 0; i < 20; i++) {
+    scheduler.start(0);
+    ASSERT_GE(scheduler.getInterval(), last_interval);
+    last_interval = scheduler.getInterval();
+  }
+  ASSERT_EQ(600 * kSecond, last_interval);
+}
+
+TEST_F(InquirySchedulerTest, reset_success_restarts_burst) {
+  scheduler.setPolicy(10, 60);
+  scheduler.reset(0);
+  for (int i = 0; i < 10; i++) {
+    scheduler.start(0);
+  }
+  ASSERT_FALSE(scheduler.isDue(kSecond));
+
+  scheduler.reset(kSecond);
+
+  ASSERT_TRUE(scheduler.isDue(kSecond));
+  ASSERT_EQ(INQUIRY_SHORT_DURATION, scheduler.start(kSecond));
+}
+
+TEST_F(InquirySchedulerTest, setPolicy_success_invalid_duty_cycle) {
+  scheduler.setPolicy(0, 0);
+  scheduler.reset(0);
+  for (int i = 0; i <= INQUIRY_BURST_COUNT; i++) {
+    scheduler.start(0);
+  }
+
+  // Treated as 1 %
+  ASSERT_EQ(100ul * INQUIRY_DURATION * 1280, scheduler.getInterval());
+}
+
+TEST_F(InquirySchedulerTest, simulation_duty_cycle_over_time) {
+  const uint16_t kDutyCycle = 10; // %
+  scheduler.setPolicy(kDutyCycle, 120);
+
+  // Link loss at t = 0, button press after 40 minutes
+  scheduler.reset(0);
+  simulate(0, 40 * kMinute);
+  scheduler.reset(40 * kMinute);
+  simulate(40 * kMinute, 60 * kMinute);
+
+  // Right after the link loss and the button press the radio searches hard
+  ASSERT_GT(dutyCycle(0, 15 * kSecond), 0.3);
+  ASSERT_GT(dutyCycle(40 * kMinute, 40 * kMinute + 15 * kSecond), 0.3);
+  // The first minute uses more than twice the budget, the button press
+  // restarts the same pattern
+  ASSERT_GT(dutyCycle(0, kMinute), 2 * kDutyCycle / 100.0);
+  ASSERT_NEAR(dutyCycle(0, kMinute), dutyCycle(40 * kMinute, 41 * kMinute),
+              0.001);
+  ASSERT_NEAR(dutyCycle(kMinute, 5 * kMinute),
+              dutyCycle(41 * kMinute, 45 * kMinute), 0.001);
+  // In the long run the budget is kept
+  ASSERT_LE(dutyCycle(5 * kMinute, 40 * kMinute), kDutyCycle / 100.0);
+  ASSERT_LE(dutyCycle(45 * kMinute, 60 * kMinute), kDutyCycle / 100.0);
+  // The former fixed schedule (6.4 s every 10 s) used 64 %
+  ASSERT_LT(dutyCycle(0, 60 * kMinute), 0.64);
+}
+} // namespace
@@ -0,0 +1,75 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gtest/gtest.h"
+
+#include "../src/levelmeter.h"
+
+#include <math.h>
+
+namespace {
+class LevelMeterTest : public ::testing::Test {
+protected:
+  LevelMeter meter;
+
+  void feedTone(int amplitude, int samples) {
+    for (int i = 0; i < samples; i++) {
+      meter.process(lround(amplitude * sin(2 * M_PI * 1000 * i / 8000.0)));
+    }
+  }
+};
+
+TEST_F(LevelMeterTest, process_measuresPeakAndRMS) {
+  feedTone(1024, LEVEL_METER_BLOCK_SIZE);
+
+  ASSERT_EQ(1024, meter.readPeak());
+  ASSERT_NEAR(724, meter.getRMS(), 2);
+}
+
+TEST_F(LevelMeterTest, process_publishesPerBlock) {
+  feedTone(1024, LEVEL_METER_BLOCK_SIZE - 1);
+
+  ASSERT_EQ(0, meter.readPeak());
+  ASSERT_EQ(0, meter.getRMS());
+}
+
+TEST_F(LevelMeterTest, readPeak_holdsUntilRead) {
+  feedTone(1024, LEVEL_METER_BLOCK_SIZE);
+  feedTone(100, LEVEL_METER_BLOCK_SIZE);
+
+  ASSERT_EQ(1024, meter.readPeak());
+  ASSERT_EQ(0, meter.readPeak());
+  ASSERT_NEAR(71, meter.getRMS(), 1);
+}
+
+TEST_F(LevelMeterTest, toDBFS) {
+  ASSERT_EQ(0, LevelMeter::toDBFS(2048));
+  ASSERT_EQ(-6, LevelMeter::toDBFS(1024));
+  ASSERT_EQ(-40, LevelMeter::toDBFS(20));
+  ASSERT_EQ(LEVEL_METER_FLOOR, LevelMeter::toDBFS(1));
+  ASSERT_EQ(LEVEL_METER_FLOOR, LevelMeter::toDBFS(0));
+}
+
+TEST_F(LevelMeterTest, formatLevel) {
+  ASSERT_EQ("-6,-9", LevelMeter::formatLevel(1024, 724));
+  ASSERT_EQ("-60,-60", LevelMeter::formatLevel(0, 0));
+}
+
+} // namespace
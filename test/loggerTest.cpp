@@ -0,0 +1,135 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "arduino-mock/Serial.h"
+#include "gtest/gtest.h"
+
+#include "../src/logger.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using ::testing::_;
+using ::testing::InSequence;
+using ::testing::Matcher;
+using ::testing::StrEq;
+
+namespace {
+class LoggerTest : public ::testing::Test {
+protected:
+  SerialMock *serialMock;
+
+  virtual void SetUp() { serialMock = serialMockInstance(); }
+
+  virtual void TearDown() { releaseSerialMock(); }
+};
+
+TEST_F(LoggerTest, log_withoutStreamIgnored) {
+  Logger test_logger;
+
+  test_logger.log(LOG_LEVEL_INFO, "foo");
+  ASSERT_EQ(0u, test_logger.getLogged());
+  ASSERT_EQ(0u, test_logger.getDropped());
+}
+
+TEST_F(LoggerTest, drain_inOrder) {
+  Logger test_logger;
+  test_logger.begin(&Serial);
+
+  test_logger.log(LOG_LEVEL_INFO, "link %d", 3);
+  test_logger.log(LOG_LEVEL_ERROR, "%s", "failed");
+
+  InSequence order;
+  EXPECT_CALL(*serialMock, println(Matcher<const char *>(StrEq("link 3"))));
+  EXPECT_CALL(*serialMock, println(Matcher<const char *>(StrEq("failed"))));
+  ASSERT_EQ(2u, test_logger.drain());
+  ASSERT_EQ(0u, test_logger.drain());
+}
+
+TEST_F(LoggerTest, drain_limited) {
+  Logger test_logger;
+  test_logger.begin(&Serial);
+  for (int i = 0; i < 3; i++) {
+    test_logger.log(LOG_LEVEL_DEBUG, "%d", i);
+  }
+
+  EXPECT_CALL(*serialMock, println(Matcher<const char *>(_))).Times(3);
+  ASSERT_EQ(2u, test_logger.drain(2));
+  ASSERT_EQ(1u, test_logger.drain(2));
+}
+
+TEST_F(LoggerTest, log_fullQueueDropsAndReports) {
+  Logger test_logger;
+  test_logger.begin(&Serial);
+  for (int i = 0; i < LOG_QUEUE_SIZE + 5; i++) {
+    test_logger.log(LOG_LEVEL_DEBUG, "%d", i);
+  }
+  ASSERT_EQ((uint32_t)LOG_QUEUE_SIZE, test_logger.getLogged());
+  ASSERT_EQ(5u, test_logger.getDropped());
+
+  EXPECT_CALL(*serialMock, println(Matcher<const char *>(_)))
+      .Times(LOG_QUEUE_SIZE);
+  EXPECT_CALL(*serialMock,
+              println(Matcher<const char *>(
+                  StrEq("WARNING: 5 log messages dropped"))));
+  test_logger.drain();
+}
+
+TEST_F(LoggerTest, log_longMessageTruncated) {
+  Logger test_logger;
+  test_logger.begin(&Serial);
+  std::string text(2 * LOG_LINE_LENGTH, 'A');
+  test_logger.log(LOG_LEVEL_INFO, "%s", text.c_str());
+
+  EXPECT_CALL(*serialMock,
+              println(Matcher<const char *>(
+                  StrEq(text.substr(0, LOG_LINE_LENGTH - 1)))));
+  test_logger.drain();
+}
+
+TEST_F(LoggerTest, log_severalTasks) {
+  Logger test_logger;
+  test_logger.begin(&Serial);
+  const int kTasks = 4;
+
+  // e.g. main loop and web server logging at the same time
+  std::vector<std::thread> tasks;
+  for (int task = 0; task < kTasks; task++) {
+    tasks.push_back(std::thread([&test_logger, task]() {
+      for (int i = 0; i < LOG_QUEUE_SIZE; i++) {
+        test_logger.log(LOG_LEVEL_INFO, "task %d message %d", task, i);
+      }
+    }));
+  }
+  for (std::thread &task : tasks) {
+    task.join();
+  }
+  ASSERT_EQ((uint32_t)LOG_QUEUE_SIZE, test_logger.getLogged());
+  ASSERT_EQ((uint32_t)(kTasks - 1) * LOG_QUEUE_SIZE, test_logger.getDropped());
+
+  EXPECT_CALL(*serialMock, println(Matcher<const char *>(
+                               ::testing::StartsWith("task "))))
+      .Times(LOG_QUEUE_SIZE);
+  EXPECT_CALL(*serialMock,
+              println(Matcher<const char *>(::testing::HasSubstr("dropped"))));
+  ASSERT_EQ((size_t)LOG_QUEUE_SIZE, test_logger.drain());
+}
+} // namespace
@@ -0,0 +1,166 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gtest/gtest.h"
+
+#include "../src/peerlist.h"
+
+#include <algorithm>
+#include <string.h>
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+using ::testing::StrEq;
+
+namespace {
+/**
+ * @brief Fake storage for getBytes()/putBytes() of the preferences mock
+ */
+struct StoredBytes {
+  uint8_t data[PEER_LIST_SIZE * BD_ADDRESS_SIZE];
+  size_t length = 0;
+};
+
+struct GetBytes {
+  StoredBytes *storage;
+  size_t operator()(const char *, void *buffer, size_t max_length) {
+    size_t length = std::min(storage->length, max_length);
+    memcpy(buffer, storage->data, length);
+    return length;
+  }
+};
+
+struct PutBytes {
+  StoredBytes *storage;
+  size_t operator()(const char *, const void *buffer, size_t length) {
+    memcpy(storage->data, buffer, length);
+    storage->length = length;
+    return length;
+  }
+};
+
+class PeerListTest : public ::testing::Test {
+protected:
+  Preferences preferencesMock;
+  StoredBytes storage;
+
+  PeerListTest() {}
+
+  virtual ~PeerListTest() {}
+
+  virtual void SetUp() {
+    ON_CALL(preferencesMock, getBytes(_, _, _))
+        .WillByDefault(Invoke(GetBytes{&storage}));
+    ON_CALL(preferencesMock, putBytes(_, _, _))
+        .WillByDefault(Invoke(PutBytes{&storage}));
+  }
+
+  virtual void TearDown() {}
+};
+
+TEST_F(PeerListTest, packAddress_success) {
+  uint8_t packed[BD_ADDRESS_SIZE];
+  const uint8_t expected[BD_ADDRESS_SIZE] = {0x00, 0x07, 0x80,
+                                             0x12, 0xab, 0xCD};
+
+  ASSERT_EQ(ResultType::kSuccess,
+            PeerList::packAddress("00:07:80:12:ab:CD", packed));
+  ASSERT_EQ(0, memcmp(expected, packed, BD_ADDRESS_SIZE));
+  ASSERT_EQ("00:07:80:12:ab:cd", PeerList::unpackAddress(packed));
+}
+
+TEST_F(PeerListTest, packAddress_fail_invalid) {
+  uint8_t packed[BD_ADDRESS_SIZE];
+
+  ASSERT_EQ(ResultType::kError, PeerList::packAddress("", packed));
+  ASSERT_EQ(ResultType::kError,
+            PeerList::packAddress("00:07:80:12:34", packed));
+  ASSERT_EQ(ResultType::kError,
+            PeerList::packAddress("00-07-80-12-34-56", packed));
+  ASSERT_EQ(ResultType::kError,
+            PeerList::packAddress("00:07:80:12:34:xy", packed));
+}
+
+TEST_F(PeerListTest, touch_success_most_recent_first) {
+  PeerList peer_list(&preferencesMock);
+
+  EXPECT_CALL(preferencesMock, putBytes(StrEq("bt_peers"), _, _)).Times(3);
+
+  peer_list.touch("00:00:00:00:00:01");
+  peer_list.touch("00:00:00:00:00:02");
+  peer_list.touch("00:00:00:00:00:01");
+
+  ASSERT_EQ(2u, peer_list.size());
+  ASSERT_EQ("00:00:00:00:00:01", peer_list.at(0));
+  ASSERT_EQ("00:00:00:00:00:02", peer_list.at(1));
+  ASSERT_EQ("", peer_list.at(2));
+}
+
+TEST_F(PeerListTest, touch_success_no_write_if_unchanged) {
+  PeerList peer_list(&preferencesMock);
+
+  EXPECT_CALL(preferencesMock, putBytes(_, _, _)).Times(1);
+
+  peer_list.touch("00:00:00:00:00:01");
+  peer_list.touch("00:00:00:00:00:01");
+  peer_list.touch("invalid");
+}
+
+TEST_F(PeerListTest, touch_success_drop_least_recently_used) {
+  PeerList peer_list(&preferencesMock);
+
+  EXPECT_CALL(preferencesMock, putBytes(_, _, _)).Times(PEER_LIST_SIZE + 1);
+
+  for (int i = 0; i <= PEER_LIST_SIZE; i++) {
+    peer_list.touch("00:00:00:00:00:0" + to_string(i));
+  }
+
+  ASSERT_EQ((size_t)PEER_LIST_SIZE, peer_list.size());
+  ASSERT_EQ("00:00:00:00:00:0" + to_string(PEER_LIST_SIZE), peer_list.at(0));
+  ASSERT_FALSE(peer_list.contains("00:00:00:00:00:00"));
+  ASSERT_TRUE(peer_list.contains("00:00:00:00:00:01"));
+}
+
+TEST_F(PeerListTest, load_success) {
+  PeerList stored_list(&preferencesMock);
+  stored_list.touch("00:00:00:00:00:01");
+  stored_list.touch("00:00:00:00:00:02");
+
+  EXPECT_CALL(preferencesMock, getBytes(StrEq("bt_peers"), _, _));
+
+  PeerList peer_list(&preferencesMock);
+  peer_list.load();
+
+  ASSERT_EQ(2u, peer_list.size());
+  ASSERT_EQ("00:00:00:00:00:02", peer_list.at(0));
+  ASSERT_EQ("00:00:00:00:00:01", peer_list.at(1));
+}
+
+TEST_F(PeerListTest, load_success_empty) {
+  PeerList peer_list(&preferencesMock);
+
+  EXPECT_CALL(preferencesMock, getBytes(_, _, _)).WillOnce(Return(0));
+
+  peer_list.load();
+
+  ASSERT_EQ(0u, peer_list.size());
+}
+} // namespace
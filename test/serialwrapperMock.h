@@ -30,4 +30,6 @@ public:
   MOCK_METHOD1(dbg_println, size_t(string));
   MOCK_METHOD3(waitForInputBlocking, ResultType(string, string *, uint32_t));
   MOCK_METHOD0(readLineToString, string());
+  MOCK_METHOD0(beginBatch, void());
+  MOCK_METHOD0(endBatch, void());
 };
@@ -23,9 +23,11 @@ Contact: bt-trx.com, mail@bt-trx.com
 #include "arduino-mock/Arduino.h"
 #include "arduino-mock/Serial.h"
 
+#include "../src/logger.h"
 #include "../src/serialwrapper.h"
 
 using ::testing::_;
+using ::testing::Matcher;
 using ::testing::Return;
 using ::testing::SetArrayArgument;
 using ::testing::StrEq;
@@ -52,7 +54,7 @@ protected:
 };
 
 TEST_F(SerialWrapperTest, waitForInputBlocking_success_shortAnswer) {
-  SerialWrapper serialwrapper = SerialWrapper(&Serial);
+  SerialWrapper serialwrapper(&Serial);
 
   EXPECT_CALL(*arduinoMock, millis()).WillOnce(Return(0)).WillOnce(Return(1));
   char output[] = "FOO";
@@ -63,7 +65,7 @@ TEST_F(SerialWrapperTest, waitForInputBlocking_success_shortAnswer) {
 }
 
 TEST_F(SerialWrapperTest, waitForInputBlocking_success_longAnswer) {
-  SerialWrapper serialwrapper = SerialWrapper(&Serial);
+  SerialWrapper serialwrapper(&Serial);
 
   EXPECT_CALL(*arduinoMock, millis()).WillOnce(Return(0)).WillOnce(Return(1));
   char output[] = "FOO BAR";
@@ -77,7 +79,7 @@ TEST_F(SerialWrapperTest, waitForInputBlocking_success_longAnswer) {
 }
 
 TEST_F(SerialWrapperTest, waitForInputBlocking_timeout) {
-  SerialWrapper serialwrapper = SerialWrapper(&Serial);
+  SerialWrapper serialwrapper(&Serial);
 
   EXPECT_CALL(*arduinoMock, millis())
       .WillOnce(Return(0))
@@ -93,8 +95,25 @@ TEST_F(SerialWrapperTest, waitForInputBlocking_timeout) {
             serialwrapper.waitForInputBlocking("FOO"));
 }
 
+TEST_F(SerialWrapperTest, waitForInputBlocking_keepsOtherLines) {
+  SerialWrapper serialwrapper(&Serial);
+
+  EXPECT_CALL(*arduinoMock, millis()).WillRepeatedly(Return(0));
+  char ring[] = "RING 0 00:07:80:12:34:56 1 HFP";
+  char output[] = "FOO";
+  EXPECT_CALL(*serialMock, readBytesUntil(_, _, _))
+      .WillOnce(DoAll(SetArrayArgument<1>(ring, ring + sizeof(ring)),
+                      Return(sizeof(ring) - 1)))
+      .WillOnce(DoAll(SetArrayArgument<1>(output, output + 4), Return(3)))
+      .WillOnce(Return(0));
+
+  ASSERT_EQ(ResultType::kSuccess, serialwrapper.waitForInputBlocking("FOO"));
+  ASSERT_EQ(ring, serialwrapper.readLineToString());
+  ASSERT_EQ("", serialwrapper.readLineToString());
+}
+
 TEST_F(SerialWrapperTest, readLineToString_success) {
-  SerialWrapper serialwrapper_ = SerialWrapper(&Serial);
+  SerialWrapper serialwrapper_(&Serial);
 
   char output[] = "FOO BAR";
   EXPECT_CALL(*serialMock, readBytesUntil(_, _, _))
@@ -104,10 +123,93 @@ TEST_F(SerialWrapperTest, readLineToString_success) {
 }
 
 TEST_F(SerialWrapperTest, readLineToString_success_emptyString) {
-  SerialWrapper serialwrapper_ = SerialWrapper(&Serial);
+  SerialWrapper serialwrapper_(&Serial);
 
   EXPECT_CALL(*serialMock, readBytesUntil(_, _, _));
 
   ASSERT_EQ("", serialwrapper_.readLineToString());
 }
-} // namespace
\ No newline at end of file
+
+TEST_F(SerialWrapperTest, readLineToString_fromReader) {
+  SerialWrapper serialwrapper_(&Serial);
+  UARTReader reader;
+  reader.begin(&Serial);
+  serialwrapper_.setReader(&reader);
+
+  EXPECT_CALL(*serialMock, readBytesUntil(_, _, _)).Times(0);
+  ASSERT_EQ("", serialwrapper_.readLineToString());
+
+  const char input[] = "OK\r\n";
+  EXPECT_CALL(*serialMock, available())
+      .WillOnce(Return(4))
+      .WillOnce(Return(3))
+      .WillOnce(Return(2))
+      .WillOnce(Return(1))
+      .WillOnce(Return(0));
+  EXPECT_CALL(*serialMock, read())
+      .WillOnce(Return(input[0]))
+      .WillOnce(Return(input[1]))
+      .WillOnce(Return(input[2]))
+      .WillOnce(Return(input[3]));
+  reader.poll();
+  ASSERT_EQ("OK", serialwrapper_.readLineToString());
+}
+
+TEST_F(SerialWrapperTest, println_singleWrite) {
+  SerialWrapper serialwrapper_(&Serial);
+
+  EXPECT_CALL(*serialMock, print(Matcher<const char *>(StrEq("AT\r\n"))))
+      .WillOnce(Return(4));
+  EXPECT_CALL(*serialMock, println(Matcher<const char *>(_))).Times(0);
+
+  ASSERT_EQ(4u, serialwrapper_.println("AT"));
+}
+
+TEST_F(SerialWrapperTest, println_batch) {
+  SerialWrapper serialwrapper_(&Serial);
+
+  EXPECT_CALL(*serialMock,
+              print(Matcher<const char *>(StrEq("+CREG: 1,1\r\nOK\r\n"))));
+
+  serialwrapper_.beginBatch();
+  ASSERT_EQ(0u, serialwrapper_.println("+CREG: 1,1"));
+  ASSERT_EQ(0u, serialwrapper_.println(string("OK")));
+  serialwrapper_.endBatch();
+}
+
+TEST_F(SerialWrapperTest, println_batchFlushedWhenFull) {
+  SerialWrapper serialwrapper_(&Serial);
+  string line(SERIAL_TX_BUFFER_SIZE / 2, 'A');
+
+  EXPECT_CALL(*serialMock, print(Matcher<const char *>(_))).Times(2);
+
+  serialwrapper_.beginBatch();
+  serialwrapper_.println(line);
+  serialwrapper_.println(line);
+  serialwrapper_.endBatch();
+}
+
+TEST_F(SerialWrapperTest, println_longLinePassedThrough) {
+  SerialWrapper serialwrapper_(&Serial);
+  string line(SERIAL_TX_BUFFER_SIZE, 'A');
+
+  EXPECT_CALL(*serialMock, println(Matcher<const char *>(StrEq(line))));
+
+  serialwrapper_.println(line);
+}
+
+TEST_F(SerialWrapperTest, println_debugCopyLogged) {
+  SerialWrapper serialwrapper_(&Serial, &Serial);
+  logger.begin(&Serial);
+
+  // Only the command is written synchronously
+  EXPECT_CALL(*serialMock, print(Matcher<const char *>(StrEq("AT\r\n"))));
+  EXPECT_CALL(*serialMock, println(Matcher<const char *>(_))).Times(0);
+  serialwrapper_.println("AT");
+  ::testing::Mock::VerifyAndClearExpectations(serialMock);
+
+  EXPECT_CALL(*serialMock, println(Matcher<const char *>(StrEq("> AT"))));
+  ASSERT_EQ(1u, logger.drain());
+  logger.begin(NULL);
+}
+} // namespace
@@ -0,0 +1,86 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gtest/gtest.h"
+
+#include "../src/spscqueue.h"
+
+namespace {
+TEST(SPSCQueueTest, pop_empty) {
+  SPSCQueue<int, 4> queue;
+  int value;
+
+  ASSERT_EQ(0u, queue.size());
+  ASSERT_FALSE(queue.pop(&value));
+  ASSERT_EQ(nullptr, queue.peek());
+}
+
+TEST(SPSCQueueTest, push_pop_fifo) {
+  SPSCQueue<int, 4> queue;
+  int value;
+
+  ASSERT_TRUE(queue.push(1));
+  ASSERT_TRUE(queue.push(2));
+  ASSERT_EQ(2u, queue.size());
+  ASSERT_TRUE(queue.pop(&value));
+  ASSERT_EQ(1, value);
+  ASSERT_TRUE(queue.pop(&value));
+  ASSERT_EQ(2, value);
+}
+
+TEST(SPSCQueueTest, push_full) {
+  SPSCQueue<int, 4> queue;
+
+  ASSERT_EQ(3u, queue.capacity());
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(queue.push(i));
+  }
+  ASSERT_FALSE(queue.push(3));
+  ASSERT_EQ(nullptr, queue.reserve());
+}
+
+TEST(SPSCQueueTest, wrapAround) {
+  SPSCQueue<int, 4> queue;
+  int value;
+
+  for (int i = 0; i < 10; i++) {
+    ASSERT_TRUE(queue.push(i));
+    ASSERT_TRUE(queue.pop(&value));
+    ASSERT_EQ(i, value);
+  }
+  ASSERT_EQ(0u, queue.size());
+}
+
+TEST(SPSCQueueTest, reserve_commit_inPlace) {
+  SPSCQueue<int, 4> queue;
+
+  int *slot = queue.reserve();
+  ASSERT_NE(nullptr, slot);
+  *slot = 42;
+  ASSERT_EQ(0u, queue.size());
+  queue.commit();
+
+  const int *front = queue.peek();
+  ASSERT_NE(nullptr, front);
+  ASSERT_EQ(42, *front);
+  queue.release();
+  ASSERT_EQ(0u, queue.size());
+}
+} // namespace
@@ -0,0 +1,162 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gtest/gtest.h"
+
+#include "../src/tonedetector.h"
+
+#include <chrono>
+#include <math.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+namespace {
+// Row and column frequencies of the DTMF digits in Hz
+static const double kRows[4] = {697, 770, 852, 941};
+static const double kColumns[4] = {1209, 1336, 1477, 1633};
+static const char *kKeys = "123A456B789C*0#D";
+
+class ToneDetectorTest : public ::testing::Test {
+protected:
+  ToneDetector detector;
+  uint32_t time_ = 0; // Samples
+  uint32_t noise_ = 12345;
+
+  // Sum of sines in Hz with their amplitudes, plus white noise
+  void feed(vector<pair<double, int>> tones, int ms, int noise = 0) {
+    for (int i = 0; i < VOX_SAMPLE_RATE / 1000 * ms; i++, time_++) {
+      double sample = 0;
+      for (auto tone : tones) {
+        sample += tone.second *
+                  sin(2 * M_PI * tone.first * time_ / VOX_SAMPLE_RATE);
+      }
+      if (noise > 0) {
+        noise_ = noise_ * 1103515245 + 12345;
+        sample += (int)((noise_ >> 16) % (2 * noise + 1)) - noise;
+      }
+      detector.process(lround(sample));
+    }
+  }
+
+  void feedDigit(char key, int ms, int row_level = 500,
+                 int column_level = 500) {
+    int index = strchr(kKeys, key) - kKeys;
+    feed({{kRows[index / 4], row_level}, {kColumns[index % 4], column_level}},
+         ms);
+  }
+
+  string readDigits() {
+    string digits;
+    char digit;
+    while (detector.readDigit(&digit)) {
+      digits += digit;
+    }
+    return digits;
+  }
+};
+
+TEST_F(ToneDetectorTest, process_decodesAllDigits) {
+  for (const char *key = kKeys; *key != 0; key++) {
+    feedDigit(*key, 100);
+    feed({}, 60);
+  }
+
+  ASSERT_EQ(kKeys, readDigits());
+}
+
+TEST_F(ToneDetectorTest, process_decodesDigitsInNoise) {
+  for (char key : string("*73#")) {
+    feedDigit(key, 80);
+    feed({}, 50, 100);
+  }
+
+  ASSERT_EQ("*73#", readDigits());
+}
+
+TEST_F(ToneDetectorTest, process_reportsHeldDigitOnce) {
+  feedDigit('5', 1000);
+  feed({}, 60);
+  feedDigit('5', 100);
+
+  ASSERT_EQ("55", readDigits());
+}
+
+TEST_F(ToneDetectorTest, process_rejectsShortTwistedAndNoise) {
+  feedDigit('1', 20);
+  feed({}, 100);
+  feedDigit('2', 200, 500, 50);
+  feed({}, 100, 400);
+  feed({{1000, 500}}, 200); // Single tone
+
+  ASSERT_EQ("", readDigits());
+}
+
+TEST_F(ToneDetectorTest, process_detectsCTCSS) {
+  ASSERT_EQ(0, detector.getCTCSSTone());
+
+  feed({{88.5, 150}}, 1000);
+  ASSERT_EQ(885, detector.getCTCSSTone());
+
+  feed({}, 1000);
+  ASSERT_EQ(0, detector.getCTCSSTone());
+}
+
+TEST_F(ToneDetectorTest, process_separatesAdjacentCTCSSTones) {
+  feed({{71.9, 150}}, 1000);
+  ASSERT_EQ(719, detector.getCTCSSTone());
+
+  feed({{74.4, 150}}, 1000);
+  ASSERT_EQ(744, detector.getCTCSSTone());
+}
+
+TEST_F(ToneDetectorTest, process_detectsCTCSSUnderVoice) {
+  feed({{123.0, 150}, {700, 500}, {1200, 400}}, 1000, 50);
+
+  ASSERT_EQ(1230, detector.getCTCSSTone());
+}
+
+TEST_F(ToneDetectorTest, isCTCSSTone) {
+  ASSERT_TRUE(ToneDetector::isCTCSSTone(670));
+  ASSERT_TRUE(ToneDetector::isCTCSSTone(2503));
+  ASSERT_FALSE(ToneDetector::isCTCSSTone(0));
+  ASSERT_FALSE(ToneDetector::isCTCSSTone(880));
+}
+
+TEST_F(ToneDetectorTest, process_benchmark) {
+  // 10 s of audio, the kernel has to be far faster than real time
+  vector<int16_t> samples(VOX_SAMPLE_RATE * 10);
+  for (size_t i = 0; i < samples.size(); i++) {
+    samples[i] = 500 * sin(2 * M_PI * 697 * i / VOX_SAMPLE_RATE);
+  }
+
+  auto start = chrono::steady_clock::now();
+  for (int16_t sample : samples) {
+    detector.process(sample);
+  }
+  auto duration = chrono::duration_cast<chrono::nanoseconds>(
+                      chrono::steady_clock::now() - start)
+                      .count();
+
+  RecordProperty("ns_per_sample", to_string(duration / samples.size()));
+  ASSERT_LT(duration, 1000000000);
+}
+
+} // namespace
@@ -0,0 +1,131 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "arduino-mock/Serial.h"
+#include "gtest/gtest.h"
+
+#include "../src/uartreader.h"
+
+#include <string>
+
+using ::testing::Invoke;
+
+namespace {
+/**
+ * @brief Bytes waiting in the UART FIFO
+ */
+struct ScriptedUART {
+  string data;
+  size_t position = 0;
+  int available() { return data.size() - position; }
+  int read() {
+    return position < data.size() ? (unsigned char)data[position++] : -1;
+  }
+};
+
+class UARTReaderTest : public ::testing::Test {
+protected:
+  SerialMock *serialMock;
+  ScriptedUART uart;
+
+  virtual void SetUp() {
+    serialMock = serialMockInstance();
+    EXPECT_CALL(*serialMock, available())
+        .WillRepeatedly(Invoke(&uart, &ScriptedUART::available));
+    EXPECT_CALL(*serialMock, read())
+        .WillRepeatedly(Invoke(&uart, &ScriptedUART::read));
+  }
+
+  virtual void TearDown() { releaseSerialMock(); }
+};
+
+TEST_F(UARTReaderTest, poll_framesLines) {
+  UARTReader reader;
+  reader.begin(&Serial);
+  uart.data = "READY.\r\nHFP-AG 0 READY\r\nRING 0";
+
+  ASSERT_EQ(2u, reader.poll());
+  string line;
+  ASSERT_TRUE(reader.readLine(&line));
+  ASSERT_EQ("READY.", line);
+  ASSERT_TRUE(reader.readLine(&line));
+  ASSERT_EQ("HFP-AG 0 READY", line);
+  ASSERT_FALSE(reader.readLine(&line));
+
+  // The rest of a line arrives with the next poll
+  uart.data += " 1s\r\n";
+  ASSERT_EQ(1u, reader.poll());
+  ASSERT_TRUE(reader.readLine(&line));
+  ASSERT_EQ("RING 0 1s", line);
+}
+
+TEST_F(UARTReaderTest, poll_skipsEmptyLines) {
+  UARTReader reader;
+  reader.begin(&Serial);
+  uart.data = "\r\n\nOK\r\n";
+
+  ASSERT_EQ(1u, reader.poll());
+  ASSERT_EQ(1u, reader.getPending());
+}
+
+TEST_F(UARTReaderTest, poll_splitsLongLines) {
+  UARTReader reader;
+  reader.begin(&Serial);
+  uart.data = string(SERIAL_MAX_LINE_LENGTH + 3, 'x') + "\n";
+
+  ASSERT_EQ(2u, reader.poll());
+  string line;
+  ASSERT_TRUE(reader.readLine(&line));
+  ASSERT_EQ((size_t)SERIAL_MAX_LINE_LENGTH, line.length());
+  ASSERT_TRUE(reader.readLine(&line));
+  ASSERT_EQ("xxx", line);
+}
+
+TEST_F(UARTReaderTest, poll_stopsWhileQueueFull) {
+  UARTReader reader;
+  reader.begin(&Serial);
+  for (int i = 0; i < UART_QUEUE_SIZE + 2; i++) {
+    uart.data += "INQUIRY_PARTIAL 00:07:80:12:34:" + to_string(10 + i) +
+                 " 200404\r\n";
+  }
+
+  reader.poll();
+  ASSERT_EQ((size_t)UART_QUEUE_SIZE, reader.getPending());
+  ASSERT_EQ((size_t)UART_QUEUE_SIZE, reader.getHighWater());
+  ASSERT_EQ(1u, reader.getStalls());
+
+  // The rest waited in the Stream, no line is lost
+  string line;
+  ASSERT_TRUE(reader.readLine(&line));
+  ASSERT_EQ("INQUIRY_PARTIAL 00:07:80:12:34:10 200404", line);
+  ASSERT_EQ(1u, reader.poll());
+  ASSERT_EQ(2u, reader.getStalls());
+  for (int i = 1; i < UART_QUEUE_SIZE + 1; i++) {
+    ASSERT_TRUE(reader.readLine(&line));
+  }
+  ASSERT_EQ(1u, reader.poll());
+  ASSERT_TRUE(reader.readLine(&line));
+  ASSERT_EQ("INQUIRY_PARTIAL 00:07:80:12:34:" +
+                to_string(10 + UART_QUEUE_SIZE + 1) + " 200404",
+            line);
+  ASSERT_EQ((size_t)UART_QUEUE_SIZE, reader.getHighWater());
+}
+
+} // namespace
@@ -0,0 +1,124 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gtest/gtest.h"
+
+#include "../src/vox.h"
+
+#include <math.h>
+#include <vector>
+using namespace std;
+
+namespace {
+class VOXTest : public ::testing::Test {
+protected:
+  VOX vox;
+
+  // 1 kHz tone around the bias of the line
+  void feedTone(int amplitude, int ms) {
+    vector<uint16_t> samples(VOX_SAMPLE_RATE / 1000 * ms);
+    for (size_t i = 0; i < samples.size(); i++) {
+      samples[i] = 2048 + amplitude * sin(2 * M_PI * 1000 * (phase_++) /
+                                          VOX_SAMPLE_RATE);
+    }
+    vox.process(samples.data(), samples.size());
+  }
+
+  // Samples until the detector keys, -1 if it doesn't within the limit
+  int samplesToKey(int amplitude, int limit) {
+    for (int i = 0; i < limit; i++) {
+      uint16_t sample =
+          2048 + amplitude * sin(2 * M_PI * 1000 * (phase_++) /
+                                 VOX_SAMPLE_RATE);
+      vox.process(&sample, 1);
+      if (vox.isKeyed()) {
+        return i + 1;
+      }
+    }
+    return -1;
+  }
+
+private:
+  uint32_t phase_ = 0;
+};
+
+TEST_F(VOXTest, process_keysWithinMilliseconds) {
+  vox.setThreshold(200);
+  feedTone(0, 100);
+  ASSERT_FALSE(vox.isKeyed());
+
+  int samples = samplesToKey(500, VOX_SAMPLE_RATE);
+
+  ASSERT_GT(samples, 0);
+  ASSERT_LE(samples, VOX_SAMPLE_RATE / 1000 * 2); // 2 ms
+}
+
+TEST_F(VOXTest, process_ignoresBiasAndNoise) {
+  vox.setThreshold(200);
+
+  feedTone(0, 100);
+  ASSERT_FALSE(vox.isKeyed());
+  ASSERT_EQ(0, vox.getLevel());
+
+  feedTone(100, 500);
+  ASSERT_FALSE(vox.isKeyed());
+  ASSERT_GT(vox.getLevel(), 0);
+}
+
+TEST_F(VOXTest, process_holdsForHangTime) {
+  vox.setThreshold(200);
+  vox.setHangTime(100);
+  feedTone(500, 100);
+  ASSERT_TRUE(vox.isKeyed());
+
+  // The envelope decays below the threshold first, then the hang time runs
+  feedTone(0, 100);
+  ASSERT_TRUE(vox.isKeyed());
+  feedTone(0, 50);
+  ASSERT_FALSE(vox.isKeyed());
+}
+
+TEST_F(VOXTest, update_reportsEdges) {
+  vox.setThreshold(200);
+  vox.setHangTime(0);
+  vox.update();
+  ASSERT_TRUE(vox.isReleased());
+
+  feedTone(500, 10);
+  vox.update();
+  ASSERT_TRUE(vox.isPressedEdge());
+  vox.update();
+  ASSERT_TRUE(vox.isPressed());
+  ASSERT_FALSE(vox.isPressedEdge());
+
+  feedTone(0, 100);
+  vox.update();
+  ASSERT_TRUE(vox.isReleasedEdge());
+}
+
+TEST_F(VOXTest, process_ignoresChannelBits) {
+  vector<uint16_t> samples(VOX_SAMPLE_RATE / 10, 0x7000 | 2048);
+  vox.process(samples.data(), samples.size());
+
+  ASSERT_FALSE(vox.isKeyed());
+  ASSERT_EQ(0, vox.getLevel());
+}
+
+} // namespace
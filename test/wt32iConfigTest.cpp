@@ -0,0 +1,105 @@
+/*
+This file is part of bt-trx
+
+bt-trx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+bt-trx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Copyright (C) 2019 Christian Obersteiner (DL1COM), Andreas Müller (DC1MIL)
+Contact: bt-trx.com, mail@bt-trx.com
+*/
+
+#include "gtest/gtest.h"
+
+#include "../src/wt32iconfig.h"
+#include "serialwrapperMock.h"
+
+using ::testing::_;
+using ::testing::Matcher;
+using ::testing::StrEq;
+
+namespace {
+class WT32iConfigTest : public ::testing::Test {
+protected:
+  SerialWrapperMock serialWrapperMock;
+  WT32i wt32i;
+  WT32iConfig config;
+
+  WT32iConfigTest() : wt32i(&serialWrapperMock) {}
+
+  virtual ~WT32iConfigTest() {}
+
+  virtual void SetUp() {
+    config.setDesired("BT CLASS", "400204");
+    config.setDesired("BT AUTH *", "0000");
+    config.setDesired("CONTROL CONFIG", "0001 0000 00A0 1101");
+    config.watch("BT BDADDR");
+  }
+};
+
+TEST_F(WT32iConfigTest, readBack_success) {
+  ASSERT_EQ(ResultType::kSuccess, config.readBack("SET BT CLASS 400204"));
+  ASSERT_EQ(ResultType::kSuccess,
+            config.readBack("SET BT BDADDR 00:07:80:12:34:56"));
+  ASSERT_EQ("400204", config.getCurrent("BT CLASS"));
+  ASSERT_EQ("00:07:80:12:34:56", config.getCurrent("BT BDADDR"));
+}
+
+TEST_F(WT32iConfigTest, readBack_unknownSetting) {
+  ASSERT_EQ(ResultType::kError, config.readBack("SET BT NAME bt-trx"));
+  ASSERT_EQ(ResultType::kError, config.readBack("SET BT CLASSIC 1"));
+  ASSERT_EQ(ResultType::kError, config.readBack("HFP-AG 0 READY"));
+  ASSERT_EQ("", config.getCurrent("BT NAME"));
+}
+
+TEST_F(WT32iConfigTest, countDifferences_ignoresCaseAndWatchedSettings) {
+  config.readBack("SET BT CLASS 400204");
+  config.readBack("SET BT AUTH * 0000");
+  config.readBack("SET CONTROL CONFIG 0001 0000 00a0 1101");
+
+  ASSERT_EQ(0u, config.countDifferences());
+  ASSERT_EQ("", config.getDifferences());
+}
+
+TEST_F(WT32iConfigTest, writeDifferences_onlyDiffering) {
+  config.readBack("SET BT CLASS 400204");
+  config.readBack("SET BT AUTH * 1234");
+
+  EXPECT_CALL(serialWrapperMock,
+              println(Matcher<const char *>(StrEq("SET BT AUTH * 0000"))));
+  EXPECT_CALL(serialWrapperMock,
+              println(Matcher<const char *>(
+                  StrEq("SET CONTROL CONFIG 0001 0000 00A0 1101"))));
+
+  ASSERT_EQ("BT AUTH *, CONTROL CONFIG", config.getDifferences());
+  ASSERT_EQ(2u, config.writeDifferences(&wt32i));
+}
+
+TEST_F(WT32iConfigTest, resetReadBack_forgetsValues) {
+  config.readBack("SET BT CLASS 400204");
+  config.resetReadBack();
+
+  ASSERT_EQ("", config.getCurrent("BT CLASS"));
+  ASSERT_EQ(3u, config.countDifferences());
+}
+
+TEST_F(WT32iConfigTest, setDesired_full) {
+  config.clear();
+  for (int i = 0; i < WT32I_CONFIG_SIZE; i++) {
+    ASSERT_EQ(ResultType::kSuccess,
+              config.setDesired("TEST " + to_string(i), "1"));
+  }
+  ASSERT_EQ(ResultType::kError, config.setDesired("TEST FULL", "1"));
+  // Updating an existing setting is still possible
+  ASSERT_EQ(ResultType::kSuccess, config.setDesired("TEST 0", "2"));
+}
+} // namespace
@@ -54,6 +54,15 @@ TEST_F(WT32iTest, reset_success) {
   wt32i.reset();
 }
 
+TEST_F(WT32iTest, setBaudRate_success) {
+  WT32i wt32i(&serialWrapperMock);
+
+  EXPECT_CALL(serialWrapperMock,
+              println(Matcher<string>("SET CONTROL BAUD 921600,8n1")));
+
+  wt32i.setBaudRate(921600);
+}
+
 TEST_F(WT32iTest, set_success) {
   WT32i wt32i(&serialWrapperMock);
 
@@ -131,23 +140,17 @@ TEST_F(WT32iTest, available_success) {
   ASSERT_EQ(ResultType::kSuccess, wt32i.available());
 }
 
-TEST_F(WT32iTest, inquiry_success_1result) {
+TEST_F(WT32iTest, abortInquiry) {
   WT32i wt32i(&serialWrapperMock);
 
   EXPECT_CALL(serialWrapperMock,
               println(Matcher<const char *>(StrEq("INQUIRY 5"))));
+  EXPECT_CALL(serialWrapperMock, println(Matcher<const char *>(StrEq("IC"))));
 
-  EXPECT_CALL(serialWrapperMock, waitForInputBlocking("INQUIRY", _, _))
-      .WillOnce(
-          DoAll(SetArgPointee<1>("INQUIRY 1"), Return(ResultType::kSuccess)))
-      .WillOnce(DoAll(SetArgPointee<1>("INQUIRY de:ad:be:ef:ca:fe 240404"),
-                      Return(ResultType::kSuccess)));
-
-  ASSERT_EQ(ResultType::kSuccess, wt32i.performInquiry());
-
-  vector<string> result = wt32i.getInquiredDevices();
-  ASSERT_EQ(1, result.size());
-  ASSERT_EQ(0, result[0].compare("de:ad:be:ef:ca:fe"));
+  wt32i.startInquiry(5);
+  ASSERT_TRUE(wt32i.inquiryRunning());
+  wt32i.abortInquiry();
+  ASSERT_FALSE(wt32i.inquiryRunning());
 }
 
 TEST_F(WT32iTest, list_success_1result) {
@@ -231,6 +234,92 @@ TEST_F(WT32iTest, getHFPStatus_fail_read) {
   ASSERT_EQ(-1, value);
 }
 
+TEST_F(WT32iTest, sendLines_batch) {
+  WT32i wt32i(&serialWrapperMock);
+
+  ::testing::InSequence batch;
+  EXPECT_CALL(serialWrapperMock, beginBatch());
+  EXPECT_CALL(serialWrapperMock,
+              println(Matcher<const char *>(StrEq("STATUS service 1"))));
+  EXPECT_CALL(serialWrapperMock,
+              println(Matcher<const char *>(StrEq("STATUS signal 5"))));
+  EXPECT_CALL(serialWrapperMock, endBatch());
+
+  wt32i.sendLines({"STATUS service 1", "STATUS signal 5"});
+}
+
+TEST_F(WT32iTest, hfpIndicatorToString_roundTrip) {
+  for (int i = 0; i < kHFPIndicatorCount; i++) {
+    HFPIndicator indicator = static_cast<HFPIndicator>(i);
+    ASSERT_EQ(indicator,
+              WT32i::stringToHFPIndicator(WT32i::hfpIndicatorToString(
+                  indicator)));
+  }
+  ASSERT_EQ("", WT32i::hfpIndicatorToString(kHFPUnknownIndicator));
+}
+
+TEST_F(WT32iTest, storeHFPStatus_success_all_indicators) {
+  WT32i wt32i(&serialWrapperMock);
+  const char *indicators[] = {"service", "call", "callsetup", "callheld",
+                              "signal",  "roam", "battchg"};
+
+  for (int i = 0; i < kHFPIndicatorCount; i++) {
+    string input = string("HFP 1 STATUS \"") + indicators[i] + "\" " +
+                   to_string(i);
+    ASSERT_EQ(ResultType::kSuccess, wt32i.storeHFPStatus(input));
+  }
+  for (int i = 0; i < kHFPIndicatorCount; i++) {
+    int value = -1;
+    ASSERT_EQ(ResultType::kSuccess,
+              wt32i.getHFPStatus(1, (HFPIndicator)i, &value));
+    ASSERT_EQ(i, value);
+  }
+  ASSERT_EQ(kHFPIndicatorCount, wt32i.getHFPStatusCount());
+}
+
+TEST_F(WT32iTest, storeHFPStatus_fail_unknown_indicator) {
+  WT32i wt32i(&serialWrapperMock);
+
+  ASSERT_EQ(ResultType::kError,
+            wt32i.storeHFPStatus("HFP 0 STATUS \"foo\" 1"));
+  ASSERT_EQ(0, wt32i.getHFPStatusCount());
+}
+
+TEST_F(WT32iTest, storeHFPStatus_fail_invalid_link_id) {
+  WT32i wt32i(&serialWrapperMock);
+
+  ASSERT_EQ(ResultType::kError,
+            wt32i.storeHFPStatus("HFP 8 STATUS \"service\" 1"));
+  ASSERT_EQ(ResultType::kError,
+            wt32i.storeHFPStatus("HFP -1 STATUS \"service\" 1"));
+}
+
+TEST_F(WT32iTest, getHFPStatus_miss_does_not_insert) {
+  WT32i wt32i(&serialWrapperMock);
+
+  int value = -1;
+  ASSERT_EQ(ResultType::kError, wt32i.getHFPStatus(0, "service", &value));
+  ASSERT_EQ(ResultType::kError, wt32i.getHFPStatus(3, kHFPSignal, &value));
+  ASSERT_EQ(ResultType::kError, wt32i.getHFPStatus(42, kHFPSignal, &value));
+  ASSERT_EQ(0, wt32i.getHFPStatusCount());
+  ASSERT_EQ(-1, value);
+}
+
+TEST_F(WT32iTest, clearHFPStatus) {
+  WT32i wt32i(&serialWrapperMock);
+
+  ASSERT_EQ(ResultType::kSuccess,
+            wt32i.storeHFPStatus("HFP 0 STATUS \"battchg\" 4"));
+  ASSERT_EQ(ResultType::kSuccess,
+            wt32i.storeHFPStatus("HFP 1 STATUS \"battchg\" 2"));
+  wt32i.clearHFPStatus(0);
+
+  int value = -1;
+  ASSERT_EQ(ResultType::kError, wt32i.getHFPStatus(0, kHFPBattChg, &value));
+  ASSERT_EQ(ResultType::kSuccess, wt32i.getHFPStatus(1, kHFPBattChg, &value));
+  ASSERT_EQ(2, value);
+}
+
 TEST_F(WT32iTest, dial) {
   WT32i wt32i(&serialWrapperMock);
 
@@ -240,6 +329,15 @@ TEST_F(WT32iTest, dial) {
   wt32i.dial();
 }
 
+TEST_F(WT32iTest, dial_link) {
+  WT32i wt32i(&serialWrapperMock);
+
+  EXPECT_CALL(serialWrapperMock,
+              println(Matcher<const char *>(StrEq("DIALING 1"))));
+
+  wt32i.dial(1);
+}
+
 TEST_F(WT32iTest, connect_success) {
   WT32i wt32i(&serialWrapperMock);
 
@@ -257,6 +355,15 @@ TEST_F(WT32iTest, hangup_success) {
   ASSERT_EQ(ResultType::kSuccess, wt32i.hangup());
 }
 
+TEST_F(WT32iTest, hangup_link) {
+  WT32i wt32i(&serialWrapperMock);
+
+  EXPECT_CALL(serialWrapperMock,
+              println(Matcher<const char *>(StrEq("HANGUP 0"))));
+
+  ASSERT_EQ(ResultType::kSuccess, wt32i.hangup(0));
+}
+
 TEST_F(WT32iTest, sendSSPConfirmation_success) {
   WT32i wt32i(&serialWrapperMock);
 
@@ -318,28 +425,7 @@ TEST_F(WT32iTest, handleMessage_HFPAG_UNKNOWN_NREC_success) {
   ASSERT_EQ(ResultType::kSuccess, wt32i.handleMessage_HFPAG_UNKNOWN(msg));
 }
 
-TEST_F(WT32iTest, getBDAddressSuffix_success) {
-  WT32i wt32i(&serialWrapperMock);
-
-  EXPECT_CALL(serialWrapperMock,
-              println(Matcher<const char *>(StrEq("SET BT BDADDR"))));
-
-  EXPECT_CALL(serialWrapperMock, waitForInputBlocking(_, _, _))
-      .WillOnce(DoAll(SetArgPointee<1>("SET BT BDADDR 12:34:56:78:90:11"),
-                      Return(ResultType::kSuccess)));
-
-  ASSERT_EQ(0, wt32i.getBDAddressSuffix().compare("789011"));
-}
-
-TEST_F(WT32iTest, getBDAddressSuffix_fail) {
-  WT32i wt32i(&serialWrapperMock);
-
-  EXPECT_CALL(serialWrapperMock,
-              println(Matcher<const char *>(StrEq("SET BT BDADDR"))));
-
-  EXPECT_CALL(serialWrapperMock, waitForInputBlocking(_, _, _))
-      .WillOnce(DoAll(SetArgPointee<1>(""), Return(ResultType::kTimeoutError)));
-
-  ASSERT_EQ(0, wt32i.getBDAddressSuffix().compare("1"));
+TEST_F(WT32iTest, stripBDAddress) {
+  ASSERT_EQ("789011", WT32i::stripBDAddress("12:34:56:78:90:11"));
 }
 } // namespace
@@ -85,6 +85,50 @@ TEST_F(WT32i_parseMessageString_Test, parseMessageString_success_SET_UNKOWN) {
   ASSERT_EQ(input, msg.msg);
 }
 
+TEST_F(WT32i_parseMessageString_Test, parseMessageString_success_SET_END) {
+  WT32i wt32i(nullptr);
+  iWrapMessage msg;
+
+  ASSERT_EQ(ResultType::kSuccess, wt32i.parseMessageString("SET", &msg));
+  ASSERT_EQ(iWrapMessageType::kSETTING_DUMP_END, msg.msg_type);
+}
+
+TEST_F(WT32i_parseMessageString_Test, parseMessageString_success_BANNER) {
+  WT32i wt32i(nullptr);
+  iWrapMessage msg;
+
+  ASSERT_EQ("", wt32i.getFirmwareVersion());
+  ASSERT_FALSE(wt32i.isFirmwareAtLeast(6, 1));
+  ASSERT_EQ(ResultType::kSuccess,
+            wt32i.parseMessageString("WRAP THOR AI (6.1.0 build 1119)", &msg));
+  ASSERT_EQ(iWrapMessageType::kBOOT_BANNER, msg.msg_type);
+  ASSERT_EQ("6.1.0", wt32i.getFirmwareVersion());
+  ASSERT_EQ(1119, wt32i.getFirmwareBuild());
+  ASSERT_TRUE(wt32i.isFirmwareAtLeast(6, 1));
+  ASSERT_TRUE(wt32i.isFirmwareAtLeast(5, 9));
+  ASSERT_FALSE(wt32i.isFirmwareAtLeast(6, 2));
+}
+
+TEST_F(WT32i_parseMessageString_Test, parseMessageString_error_BANNER) {
+  WT32i wt32i(nullptr);
+  iWrapMessage msg;
+
+  ASSERT_EQ(ResultType::kError,
+            wt32i.parseMessageString("WRAP THOR AI", &msg));
+  ASSERT_EQ(iWrapMessageType::kBOOT_BANNER, msg.msg_type);
+  ASSERT_EQ("", wt32i.getFirmwareVersion());
+}
+
+TEST_F(WT32i_parseMessageString_Test, parseMessageString_success_READY) {
+  WT32i wt32i(nullptr);
+  iWrapMessage msg;
+
+  ASSERT_EQ(ResultType::kSuccess, wt32i.parseMessageString("READY.", &msg));
+  ASSERT_EQ(iWrapMessageType::kBOOT_READY, msg.msg_type);
+  ASSERT_EQ(ResultType::kSuccess, wt32i.parseMessageString("OK", &msg));
+  ASSERT_EQ(iWrapMessageType::kOK, msg.msg_type);
+}
+
 TEST_F(WT32i_parseMessageString_Test, parseMessageString_success_LIST) {
   WT32i wt32i(nullptr);
   iWrapMessage msg;
@@ -96,6 +140,20 @@ TEST_F(WT32i_parseMessageString_Test, parseMessageString_success_LIST) {
   ASSERT_EQ(input, msg.msg);
 }
 
+TEST_F(WT32i_parseMessageString_Test,
+       parseMessageString_success_LIST_replaces_previous_listing) {
+  WT32i wt32i(nullptr);
+  iWrapMessage msg;
+  string result = "LIST 0 CONNECTED HFP-AG 667 0 0 7 8d 8d 25:aa:92:1f:94:a8 3 "
+                  "INCOMING ACTIVE SLAVE ENCRYPTED 0";
+
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(ResultType::kSuccess, wt32i.parseMessageString("LIST 1", &msg));
+    ASSERT_EQ(ResultType::kSuccess, wt32i.parseMessageString(result, &msg));
+  }
+  ASSERT_EQ(1, wt32i.getActiveConnections().size());
+}
+
 TEST_F(WT32i_parseMessageString_Test, parseMessageString_success_INQUIRY) {
   WT32i wt32i(nullptr);
   iWrapMessage msg;
@@ -180,4 +238,132 @@ TEST_F(WT32i_parseMessageString_Test, parseMessageString_success_SSP_CONFIRM) {
   ASSERT_EQ(iWrapMessageType::kSSP_CONFIRM, msg.msg_type);
   ASSERT_EQ(input, msg.msg);
 }
+
+TEST_F(WT32i_parseMessageString_Test,
+       parseMessageString_success_HFPAG_READY_link_id) {
+  WT32i wt32i(nullptr);
+  iWrapMessage msg;
+  string input = "HFP-AG 2 READY";
+
+  ASSERT_EQ(ResultType::kSuccess, wt32i.parseMessageString(input, &msg));
+  ASSERT_EQ(iWrapMessageType::kHFPAG_READY, msg.msg_type);
+  ASSERT_EQ(2, msg.link_id);
+}
+
+TEST_F(WT32i_parseMessageString_Test,
+       parseMessageString_success_NO_CARRIER_link_id) {
+  WT32i wt32i(nullptr);
+  iWrapMessage msg;
+  string input = "NO CARRIER 3 ERROR 0";
+
+  ASSERT_EQ(ResultType::kSuccess, wt32i.parseMessageString(input, &msg));
+  ASSERT_EQ(iWrapMessageType::kNOCARRIER_ERROR_LINK_LOSS, msg.msg_type);
+  ASSERT_EQ(3, msg.link_id);
+}
+
+TEST_F(WT32i_parseMessageString_Test,
+       parseMessageString_success_no_link_id) {
+  WT32i wt32i(nullptr);
+  iWrapMessage msg;
+  msg.link_id = 4;
+
+  ASSERT_EQ(ResultType::kSuccess,
+            wt32i.parseMessageString("SET CONTROL GAIN 8 10", &msg));
+  ASSERT_EQ(-1, msg.link_id);
+}
+
+TEST_F(WT32i_parseMessageString_Test, parseMessageString_success_HFP_STATUS) {
+  WT32i wt32i(nullptr);
+  iWrapMessage msg;
+  string input = "HFP 1 STATUS \"signal\" 4";
+
+  ASSERT_EQ(ResultType::kSuccess, wt32i.parseMessageString(input, &msg));
+  ASSERT_EQ(iWrapMessageType::kHFP_STATUS, msg.msg_type);
+  ASSERT_EQ(1, msg.link_id);
+
+  int value = -1;
+  ASSERT_EQ(ResultType::kSuccess, wt32i.getHFPStatus(1, kHFPSignal, &value));
+  ASSERT_EQ(4, value);
+}
+
+TEST_F(WT32i_parseMessageString_Test, parseMessageString_fail_HFP_STATUS) {
+  WT32i wt32i(nullptr);
+  iWrapMessage msg;
+
+  // Garbled lines, e.g. bytes lost on the UART
+  ASSERT_EQ(ResultType::kError,
+            wt32i.parseMessageString("HFP 1 STATUS \"signal\" 4x", &msg));
+  ASSERT_EQ(ResultType::kError,
+            wt32i.parseMessageString("HFP 1 STATUS \"signal\" \x7f", &msg));
+  ASSERT_EQ(ResultType::kError,
+            wt32i.parseMessageString("HFP x STATUS \"signal\" 4", &msg));
+  ASSERT_EQ(ResultType::kError,
+            wt32i.parseMessageString(
+                "HFP 1 STATUS \"signal\" 99999999999999999999", &msg));
+
+  int value = -1;
+  ASSERT_EQ(ResultType::kError, wt32i.getHFPStatus(1, kHFPSignal, &value));
+}
+
+TEST_F(WT32i_parseMessageString_Test, parseMessageString_success_CALL) {
+  WT32i wt32i(nullptr);
+  iWrapMessage msg;
+  string input = "CALL 3";
+
+  ASSERT_EQ(ResultType::kSuccess, wt32i.parseMessageString(input, &msg));
+  ASSERT_EQ(iWrapMessageType::kCALL_RESULT, msg.msg_type);
+  ASSERT_EQ(3, msg.link_id);
+}
+
+TEST_F(WT32i_parseMessageString_Test,
+       parseMessageString_success_INQUIRY_PARTIAL) {
+  WT32i wt32i(nullptr);
+  iWrapMessage msg;
+  string input = "INQUIRY_PARTIAL 25:aa:92:1f:94:a8 240404 \"\" -62";
+
+  ASSERT_EQ(ResultType::kSuccess, wt32i.parseMessageString(input, &msg));
+  ASSERT_EQ(iWrapMessageType::kINQUIRY_PARTIAL, msg.msg_type);
+  ASSERT_EQ(input, msg.msg);
+}
+
+TEST_F(WT32i_parseMessageString_Test,
+       parseMessageString_success_INQUIRY_FINISHED) {
+  WT32i wt32i(nullptr);
+  iWrapMessage msg;
+
+  ASSERT_EQ(ResultType::kSuccess, wt32i.parseMessageString("INQUIRY 2", &msg));
+  ASSERT_EQ(iWrapMessageType::kINQUIRY_FINISHED, msg.msg_type);
+  ASSERT_TRUE(wt32i.inquiryRunning()); // Results still pending
+
+  ASSERT_EQ(ResultType::kSuccess,
+            wt32i.parseMessageString("INQUIRY 25:aa:92:1f:94:a8 240404", &msg));
+  ASSERT_TRUE(wt32i.inquiryRunning());
+  ASSERT_EQ(ResultType::kSuccess,
+            wt32i.parseMessageString("INQUIRY 25:aa:92:1f:94:a9 240404", &msg));
+  ASSERT_EQ(iWrapMessageType::kINQUIRY_RESULT, msg.msg_type);
+  ASSERT_FALSE(wt32i.inquiryRunning());
+}
+
+TEST_F(WT32i_parseMessageString_Test, parseMessageString_success_SCO_CONNECT) {
+  WT32i wt32i(nullptr);
+  iWrapMessage msg;
+
+  ASSERT_EQ(ResultType::kSuccess,
+            wt32i.parseMessageString("CONNECT 2 SCO", &msg));
+  ASSERT_EQ(iWrapMessageType::kSCO_CONNECT, msg.msg_type);
+  ASSERT_EQ(2, msg.link_id);
+}
+
+TEST_F(WT32i_parseMessageString_Test,
+       parseMessageString_success_INQUIRY_ERROR) {
+  WT32i wt32i(nullptr);
+  iWrapMessage msg;
+
+  ASSERT_EQ(ResultType::kSuccess, wt32i.parseMessageString("INQUIRY 2", &msg));
+  ASSERT_TRUE(wt32i.inquiryRunning());
+  ASSERT_EQ(ResultType::kSuccess,
+            wt32i.parseMessageString("INQUIRY ERROR 0x0c", &msg));
+  ASSERT_EQ(iWrapMessageType::kINQUIRY_ERROR, msg.msg_type);
+  ASSERT_FALSE(wt32i.inquiryRunning());
+}
 } // namespace
@@ -14,12 +14,50 @@ function getAllParameters() {
   getDropdownData("ptt_mode");
   getData("ptt_hang_time");
   getData("ptt_timeout");
+  getData("vox_threshold");
+  getData("vox_hang_time");
+  getData("ctcss_tone");
   getData("pin_code");
+  getData("inquiry_duty_cycle");
+  getData("inquiry_max_interval");
+  getData("recovery_window");
 
   getData("statusmessage");
   setInterval(function(){ getData("statusmessage");}, 5000);
+  getData("gain_calibration");
+  setInterval(function(){
+    getData("gain_calibration");
+    getDropdownData("dac_gain");
+  }, 5000);
+  pollAudioLevel();
 };
 
+// Level of the audio to the TRX. The next request is only sent once the
+// previous one is answered, at most every 250 ms, and not while the page is
+// hidden
+function pollAudioLevel() {
+  if (document.hidden) {
+    setTimeout(pollAudioLevel, 1000);
+    return;
+  }
+  var xhttp = new XMLHttpRequest();
+  xhttp.onreadystatechange = function() {
+    if (this.readyState != 4) {
+      return;
+    }
+    if (this.status == 200) {
+      var levels = this.responseText.split(",");
+      document.getElementById("audio_peak").value = levels[0];
+      document.getElementById("audio_rms").value = levels[1];
+      document.getElementById("audio_level").innerHTML =
+          levels[0] + " / " + levels[1];
+    }
+    setTimeout(pollAudioLevel, 250);
+  };
+  xhttp.open("GET", "get?id=audio_level", true);
+  xhttp.send();
+}
+
 function getData(parameter) {
   var xhttp = new XMLHttpRequest();
   xhttp.onreadystatechange = function() {
@@ -28,7 +66,8 @@ function getData(parameter) {
       x.value = this.responseText;
       if (parameter == "callsign") {
         setCallsignTag(x.value);
-      } else if (parameter == "statusmessage") {
+      } else if (parameter == "statusmessage" ||
+                 parameter == "gain_calibration") {
         x.innerHTML = this.responseText;
       }
     } else if (this.readyState == 4 && this.readyState != 200) {